@@ -2,16 +2,36 @@
 OSPRAY_DIR=$HOME/software/ospray-2.7.0.x86_64.linux
 GLM_DIR=$HOME/software/glm-0.9.9.9
 
+# Optional native HDF5 volume reader
+if pkg-config --exists hdf5; then
+    HDF5_CFLAGS="-DHAVE_HDF5 `pkg-config --cflags hdf5`"
+    HDF5_LIBS=`pkg-config --libs hdf5`
+fi
+
+# Optional JPEG and WebP tile encoding for FrameStreamer
+if pkg-config --exists libturbojpeg; then
+    STREAM_CFLAGS="-DHAVE_TURBOJPEG `pkg-config --cflags libturbojpeg`"
+    STREAM_LIBS=`pkg-config --libs libturbojpeg`
+fi
+if pkg-config --exists libwebp; then
+    STREAM_CFLAGS="$STREAM_CFLAGS -DHAVE_WEBP `pkg-config --cflags libwebp`"
+    STREAM_LIBS="$STREAM_LIBS `pkg-config --libs libwebp`"
+fi
+
 g++ \
     -O3 -W -Wall \
-    -shared -fPIC \
+    -shared -fPIC -pthread \
     -std=c++11 \
     -I $OSPRAY_DIR/include \
     -I $OSPRAY_DIR/include/ospray/ospray_testing \
     -L $OSPRAY_DIR/lib \
     `python -m pybind11 --includes` \
     -I $GLM_DIR/include \
+    $HDF5_CFLAGS \
+    $STREAM_CFLAGS \
     ospray.cpp \
     -o ospray`python3-config --extension-suffix` \
-    -lospray
+    -lospray \
+    $HDF5_LIBS \
+    $STREAM_LIBS
     #-lospray_testing
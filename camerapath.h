@@ -0,0 +1,278 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Keyframed camera paths. A keyframe holds a position, an orientation and
+// a vertical field of view. The orientation rotates the default camera
+// frame, looking along -z with +y up, as for mat4.from_quaternion().
+//
+// With spline interpolation positions, fields of view and orientations
+// follow a (non-uniform) Catmull-Rom spline through the keyframes, for
+// orientations applied to the quaternion components and renormalized.
+// Quaternions are flipped to the same hemisphere as the previous keyframe,
+// so the shortest rotation between keyframes is used.
+
+enum CameraInterpolation
+{
+    CAMERA_LINEAR,
+    CAMERA_SPLINE
+};
+
+inline CameraInterpolation
+camera_interpolation_from_string(const std::string& s)
+{
+    if (s == "linear")
+        return CAMERA_LINEAR;
+    else if (s == "spline")
+        return CAMERA_SPLINE;
+
+    throw std::invalid_argument("unknown interpolation '" + s + "', expected 'linear' or 'spline'");
+}
+
+struct CameraKeyframe
+{
+    float       time;
+    glm::vec3   position;
+    glm::quat   orientation;
+    float       fovy;
+};
+
+struct CameraFrame
+{
+    glm::vec3   position;
+    glm::vec3   direction;
+    glm::vec3   up;
+    float       fovy;
+};
+
+// Orientation of a camera looking along direction, with up projected to
+// be perpendicular to it
+inline glm::quat
+camera_orientation(const glm::vec3& direction, const glm::vec3& up)
+{
+    const float dlen = glm::length(direction);
+    if (dlen == 0.0f)
+        throw std::invalid_argument("camera direction can't be zero");
+
+    const glm::vec3 f = direction / dlen;
+    const glm::vec3 s = glm::cross(f, up);
+    const float slen = glm::length(s);
+    if (slen < 1e-6f * glm::length(up))
+        throw std::invalid_argument("camera up vector can't be parallel to the direction");
+
+    const glm::vec3 r = s / slen;
+    const glm::vec3 u = glm::cross(r, f);
+
+    // Columns are the camera's x, y and z axes
+    return glm::normalize(glm::quat_cast(glm::mat3(r, u, -f)));
+}
+
+inline glm::vec4
+quat_components(const glm::quat& q)
+{
+    return glm::vec4(q.x, q.y, q.z, q.w);
+}
+
+// Cubic Hermite interpolation over an interval of length h, at s in [0, 1]
+template<typename T>
+inline T
+hermite(const T& p0, const T& m0, const T& p1, const T& m1, float h, float s)
+{
+    const float s2 = s*s, s3 = s2*s;
+
+    return (2*s3 - 3*s2 + 1) * p0 + (s3 - 2*s2 + s) * h * m0 +
+        (-2*s3 + 3*s2) * p1 + (s3 - s2) * h * m1;
+}
+
+class CameraPath
+{
+public:
+
+    CameraPath(CameraInterpolation interpolation=CAMERA_SPLINE)
+    :
+        interpolation(interpolation)
+    {
+    }
+
+    // Insert a keyframe, keeping keyframes ordered by time
+    void
+    add(const CameraKeyframe& key)
+    {
+        auto it = std::lower_bound(keys.begin(), keys.end(), key.time,
+            [](const CameraKeyframe& k, float t) { return k.time < t; });
+
+        if (it != keys.end() && it->time == key.time)
+            throw std::invalid_argument("there already is a keyframe at time " + std::to_string(key.time));
+
+        keys.insert(it, key);
+
+        for (size_t i = 1; i < keys.size(); i++)
+        {
+            if (glm::dot(keys[i-1].orientation, keys[i].orientation) < 0.0f)
+                keys[i].orientation = -keys[i].orientation;
+        }
+    }
+
+    void clear() { keys.clear(); }
+
+    size_t size() const { return keys.size(); }
+    const CameraKeyframe& keyframe(size_t i) const { return keys[i]; }
+
+    float start() const { return keys.empty() ? 0.0f : keys.front().time; }
+    float end() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+    CameraInterpolation get_interpolation() const { return interpolation; }
+    void set_interpolation(CameraInterpolation i) { interpolation = i; }
+
+    // Camera at time t, clamped to the time range of the keyframes
+    CameraFrame
+    evaluate(float t) const
+    {
+        if (keys.empty())
+            throw std::runtime_error("camera path has no keyframes");
+
+        glm::vec3 position;
+        glm::vec4 q;
+        float fovy;
+
+        if (keys.size() == 1 || t <= keys.front().time)
+        {
+            position = keys.front().position;
+            q = quat_components(keys.front().orientation);
+            fovy = keys.front().fovy;
+        }
+        else if (t >= keys.back().time)
+        {
+            position = keys.back().position;
+            q = quat_components(keys.back().orientation);
+            fovy = keys.back().fovy;
+        }
+        else
+        {
+            // Segment [i, i+1] containing t
+            const size_t i = std::upper_bound(keys.begin(), keys.end(), t,
+                [](float t, const CameraKeyframe& k) { return t < k.time; }) - keys.begin() - 1;
+
+            const CameraKeyframe& k0 = keys[i];
+            const CameraKeyframe& k1 = keys[i+1];
+            const float h = k1.time - k0.time;
+            const float s = (t - k0.time) / h;
+
+            if (interpolation == CAMERA_LINEAR)
+            {
+                position = glm::mix(k0.position, k1.position, s);
+                q = quat_components(glm::slerp(k0.orientation, k1.orientation, s));
+                fovy = k0.fovy + s * (k1.fovy - k0.fovy);
+            }
+            else
+            {
+                position = hermite(k0.position, tangent(i, &CameraKeyframe::position),
+                    k1.position, tangent(i+1, &CameraKeyframe::position), h, s);
+                q = hermite(quat_components(k0.orientation), quat_tangent(i),
+                    quat_components(k1.orientation), quat_tangent(i+1), h, s);
+                fovy = hermite(k0.fovy, tangent(i, &CameraKeyframe::fovy),
+                    k1.fovy, tangent(i+1, &CameraKeyframe::fovy), h, s);
+            }
+        }
+
+        const glm::quat orientation = glm::normalize(glm::quat(q.w, q.x, q.y, q.z));
+
+        CameraFrame res;
+        res.position = position;
+        res.direction = orientation * glm::vec3(0.0f, 0.0f, -1.0f);
+        res.up = orientation * glm::vec3(0.0f, 1.0f, 0.0f);
+        res.fovy = fovy;
+
+        return res;
+    }
+
+protected:
+
+    // Finite-difference tangent (per unit of time) at keyframe i, one-sided
+    // at the ends
+    template<typename T>
+    T
+    tangent(size_t i, T CameraKeyframe::*member) const
+    {
+        const size_t a = i > 0 ? i - 1 : i;
+        const size_t b = i + 1 < keys.size() ? i + 1 : i;
+
+        return (keys[b].*member - keys[a].*member) / (keys[b].time - keys[a].time);
+    }
+
+    glm::vec4
+    quat_tangent(size_t i) const
+    {
+        const size_t a = i > 0 ? i - 1 : i;
+        const size_t b = i + 1 < keys.size() ? i + 1 : i;
+
+        return (quat_components(keys[b].orientation) - quat_components(keys[a].orientation)) /
+            (keys[b].time - keys[a].time);
+    }
+
+    CameraInterpolation             interpolation;
+    std::vector<CameraKeyframe>     keys;
+};
+
+// Keyframes every at most max_step degrees of a rotation around axis
+// through center, starting at position and looking at center, with axis
+// as up vector, over [0, duration]
+inline void
+camera_orbit(CameraPath& path, const glm::vec3& center, const glm::vec3& position, const glm::vec3& axis,
+    float degrees, float duration, float fovy, float max_step=5.0f)
+{
+    if (duration <= 0.0f)
+        throw std::invalid_argument("duration needs to be positive");
+
+    const glm::vec3 a = glm::normalize(axis);
+    const glm::vec3 offset = position - center;
+    const int steps = std::max(1, (int)std::ceil(std::fabs(degrees) / max_step));
+
+    for (int i = 0; i <= steps; i++)
+    {
+        const float f = (float)i / steps;
+        const glm::quat rotation = glm::angleAxis(glm::radians(f * degrees), a);
+        const glm::vec3 p = center + rotation * offset;
+
+        CameraKeyframe key;
+        key.time = f * duration;
+        key.position = p;
+        key.orientation = camera_orientation(center - p, a);
+        key.fovy = fovy;
+
+        path.add(key);
+    }
+}
+
+// Orbit around the center of a bounding box, at elevation degrees above the
+// plane perpendicular to axis, at a distance where the bounding sphere fits
+// the vertical field of view (times margin). Starts on the -y side for
+// axis z, otherwise the side closest to that.
+inline void
+camera_turntable(CameraPath& path, const glm::vec3& lower, const glm::vec3& upper, const glm::vec3& axis,
+    float elevation, float degrees, float duration, float fovy, float margin)
+{
+    const glm::vec3 a = glm::normalize(axis);
+    const glm::vec3 center = 0.5f * (lower + upper);
+    const float radius = std::max(0.5f * glm::length(upper - lower), 1e-6f);
+    const float distance = margin * radius / std::sin(0.5f * glm::radians(fovy));
+
+    glm::vec3 ref(0.0f, -1.0f, 0.0f);
+    if (std::fabs(glm::dot(ref, a)) > 0.99f)
+        ref = glm::vec3(1.0f, 0.0f, 0.0f);
+    const glm::vec3 e = glm::normalize(ref - glm::dot(ref, a) * a);
+
+    const float el = glm::radians(elevation);
+    const glm::vec3 position = center + distance * (std::cos(el) * e + std::sin(el) * a);
+
+    camera_orbit(path, center, position, a, degrees, duration, fovy);
+}
+
+#endif
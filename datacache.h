@@ -0,0 +1,245 @@
+#ifndef DATACACHE_H
+#define DATACACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "parallel.h"
+
+// Content hashing and a size-bounded LRU cache, for deduplicating array
+// data that gets passed to OSPRay more than once
+
+// The hash is computed per block of CONTENT_HASH_BLOCK_SIZE bytes (in
+// parallel), after which the block hashes are combined in order, so the
+// result doesn't depend on the number of threads used
+const size_t CONTENT_HASH_BLOCK_SIZE = 1 << 20;
+
+// 128-bit (non-cryptographic) content hash
+struct ContentHash
+{
+    uint64_t    lo, hi;
+
+    bool operator==(const ContentHash& other) const { return lo == other.lo && hi == other.hi; }
+};
+
+// Finalizer of MurmurHash3
+inline uint64_t
+hash_fmix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+inline uint64_t
+hash_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// Hash of n bytes, using two lanes over alternating 64-bit words
+inline ContentHash
+hash_block(const unsigned char *p, size_t n, uint64_t seed)
+{
+    const uint64_t K1 = 0x87c37b91114253d5ULL, K2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = seed ^ 0x9e3779b97f4a7c15ULL, h2 = seed ^ 0x6a09e667f3bcc909ULL;
+
+    auto step = [&](const unsigned char *q) {
+        uint64_t a, b;
+        std::memcpy(&a, q, 8);
+        std::memcpy(&b, q + 8, 8);
+        h1 = hash_rotl64(h1 ^ (a * K1), 31) * K2;
+        h2 = hash_rotl64(h2 ^ (b * K2), 33) * K1;
+    };
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        step(p + i);
+
+    if (i < n)
+    {
+        unsigned char tail[16] = { 0 };
+        std::memcpy(tail, p + i, n - i);
+        step(tail);
+    }
+
+    // Length is mixed in, so zero padding of the tail can't collide
+    h1 ^= n;
+    h2 ^= n;
+    h1 += h2;
+    h2 += h1;
+    h1 = hash_fmix64(h1);
+    h2 = hash_fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+
+    return ContentHash { h1, h2 };
+}
+
+inline ContentHash
+content_hash(const void *data, size_t n, unsigned nthreads=0)
+{
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    const size_t nblocks = (n + CONTENT_HASH_BLOCK_SIZE - 1) / CONTENT_HASH_BLOCK_SIZE;
+    std::vector<ContentHash> blocks(nblocks);
+
+    parallel_for(nblocks, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t b = begin; b < end; b++)
+        {
+            const size_t offset = b * CONTENT_HASH_BLOCK_SIZE;
+            blocks[b] = hash_block(p + offset, std::min(CONTENT_HASH_BLOCK_SIZE, n - offset), b);
+        }
+    }, nthreads);
+
+    ContentHash res { n, ~(uint64_t)n };
+    for (const ContentHash& h : blocks)
+    {
+        res.lo = hash_fmix64(res.lo ^ h.lo) + h.hi;
+        res.hi = hash_fmix64(res.hi ^ h.hi) + h.lo;
+    }
+
+    return res;
+}
+
+// Least-recently-used cache of values with a size in bytes, evicting
+// entries so the total size stays within a maximum. Not thread-safe.
+template<typename K, typename V, typename Hash>
+class LRUCache
+{
+public:
+
+    LRUCache(size_t max_bytes=0)
+    :
+        max_bytes(max_bytes), bytes(0)
+    {
+    }
+
+    // Value for key (which becomes the most recently used), or nullptr
+    V*
+    get(const K& key)
+    {
+        auto it = index.find(key);
+        if (it == index.end())
+            return nullptr;
+
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->value;
+    }
+
+    // Add a value, replacing an existing value for key. Values larger than
+    // the maximum size aren't added. Returns the number of evicted entries.
+    size_t
+    put(const K& key, const V& value, size_t size)
+    {
+        remove(key);
+
+        if (size > max_bytes)
+            return 0;
+
+        entries.push_front(Entry { key, value, size });
+        index[key] = entries.begin();
+        bytes += size;
+
+        return evict(max_bytes);
+    }
+
+    bool
+    remove(const K& key)
+    {
+        auto it = index.find(key);
+        if (it == index.end())
+            return false;
+
+        bytes -= it->second->size;
+        entries.erase(it->second);
+        index.erase(it);
+
+        return true;
+    }
+
+    // Remove all entries whose value matches pred, returns the number of
+    // removed entries
+    template<typename P>
+    size_t
+    remove_if(P pred)
+    {
+        size_t n = 0;
+        for (auto it = entries.begin(); it != entries.end(); )
+        {
+            if (pred(it->value))
+            {
+                bytes -= it->size;
+                index.erase(it->key);
+                it = entries.erase(it);
+                n++;
+            }
+            else
+                ++it;
+        }
+        return n;
+    }
+
+    // Evict least recently used entries until at most limit bytes are
+    // used, returns the number of evicted entries
+    size_t
+    evict(size_t limit)
+    {
+        size_t n = 0;
+        while (bytes > limit && !entries.empty())
+        {
+            const Entry& e = entries.back();
+            bytes -= e.size;
+            index.erase(e.key);
+            entries.pop_back();
+            n++;
+        }
+        return n;
+    }
+
+    size_t
+    set_max_bytes(size_t max)
+    {
+        max_bytes = max;
+        return evict(max_bytes);
+    }
+
+    void
+    clear()
+    {
+        index.clear();
+        entries.clear();
+        bytes = 0;
+    }
+
+    size_t get_max_bytes() const { return max_bytes; }
+    size_t get_bytes() const { return bytes; }
+    size_t size() const { return entries.size(); }
+
+    // Doesn't change the order of use
+    bool contains(const K& key) const { return index.count(key) > 0; }
+
+protected:
+
+    struct Entry
+    {
+        K       key;
+        V       value;
+        size_t  size;
+    };
+
+    size_t      max_bytes;
+    size_t      bytes;
+
+    // Most recently used first
+    std::list<Entry>    entries;
+    std::unordered_map<K, typename std::list<Entry>::iterator, Hash>    index;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "parallel.h"
+
+// Triangle mesh decimation by vertex clustering: vertices are snapped to
+// a regular grid, all vertices in a grid cell are replaced by their mean,
+// and triangles that collapse (i.e. have two or more vertices in the same
+// cell) are removed, as are duplicate triangles. This doesn't preserve
+// features as well as quadric-based edge collapses, but it's O(N log N),
+// easily parallelized and robust for any input, which is what is needed
+// for quick preview levels of very large meshes.
+
+const size_t DECIMATE_MIN_PER_THREAD = 1 << 16;
+
+struct DecimatedMesh
+{
+    std::vector<float>      vertices;   // xyz triplets
+    std::vector<uint32_t>   indices;    // Triangles
+
+    size_t num_triangles() const { return indices.size() / 3; }
+};
+
+// Decimate the triangle mesh using a grid of resolution cells along its
+// longest bounding box axis. Cells are cubes, so the other axes get
+// proportionally fewer cells.
+inline void
+cluster_decimate(const float *vertices, size_t nverts, const uint32_t *indices, size_t ntris,
+    unsigned resolution, unsigned nthreads, DecimatedMesh& res)
+{
+    res = DecimatedMesh();
+    if (nverts == 0 || ntris == 0)
+        return;
+
+    // Bounding box
+    const unsigned chunks = num_chunks(nverts, nthreads, DECIMATE_MIN_PER_THREAD);
+    std::vector<float> chunk_bounds(6*chunks);
+
+    parallel_for(nverts, [&](size_t begin, size_t end, unsigned chunk) {
+        float lo[3], hi[3];
+        for (int d = 0; d < 3; d++)
+        {
+            lo[d] = std::numeric_limits<float>::max();
+            hi[d] = -std::numeric_limits<float>::max();
+        }
+        for (size_t i = begin; i < end; i++)
+        {
+            for (int d = 0; d < 3; d++)
+            {
+                lo[d] = std::min(lo[d], vertices[3*i+d]);
+                hi[d] = std::max(hi[d], vertices[3*i+d]);
+            }
+        }
+        std::copy(lo, lo+3, &chunk_bounds[6*chunk]);
+        std::copy(hi, hi+3, &chunk_bounds[6*chunk+3]);
+    }, nthreads, DECIMATE_MIN_PER_THREAD);
+
+    float lo[3], hi[3];
+    for (int d = 0; d < 3; d++)
+    {
+        lo[d] = chunk_bounds[d];
+        hi[d] = chunk_bounds[3+d];
+        for (unsigned c = 1; c < chunks; c++)
+        {
+            lo[d] = std::min(lo[d], chunk_bounds[6*c+d]);
+            hi[d] = std::max(hi[d], chunk_bounds[6*c+3+d]);
+        }
+    }
+
+    const float extent = std::max(hi[0]-lo[0], std::max(hi[1]-lo[1], hi[2]-lo[2]));
+    const float scale = extent > 0.0f ? std::max(resolution, 1u) / extent : 0.0f;
+    uint64_t cells[3];
+    for (int d = 0; d < 3; d++)
+        cells[d] = (uint64_t)((hi[d] - lo[d]) * scale) + 1;
+
+    // (cell, vertex) pairs, sorted by cell, so that the vertices of each
+    // cell end up consecutive
+    std::vector<std::pair<uint64_t, uint32_t>> cell_vertex(nverts);
+
+    parallel_for(nverts, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t i = begin; i < end; i++)
+        {
+            uint64_t c[3];
+            for (int d = 0; d < 3; d++)
+                c[d] = std::min((uint64_t)((vertices[3*i+d] - lo[d]) * scale), cells[d] - 1);
+            cell_vertex[i] = std::make_pair(c[0] + cells[0]*(c[1] + cells[1]*c[2]), (uint32_t)i);
+        }
+    }, nthreads, DECIMATE_MIN_PER_THREAD);
+
+    parallel_sort(cell_vertex.data(), nverts, std::less<std::pair<uint64_t, uint32_t>>(), nthreads);
+
+    // Start of each cell's run in cell_vertex
+    std::vector<size_t> runs;
+    runs.push_back(0);
+    for (size_t i = 1; i < nverts; i++)
+    {
+        if (cell_vertex[i].first != cell_vertex[i-1].first)
+            runs.push_back(i);
+    }
+    const size_t ncells = runs.size();
+    runs.push_back(nverts);
+
+    // Mean position per cell, plus the new index of each original vertex
+    std::vector<uint32_t> remap(nverts);
+    res.vertices.resize(3*ncells);
+
+    parallel_for(ncells, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t c = begin; c < end; c++)
+        {
+            double sum[3] = { 0.0, 0.0, 0.0 };
+            for (size_t i = runs[c]; i < runs[c+1]; i++)
+            {
+                const uint32_t v = cell_vertex[i].second;
+                sum[0] += vertices[3*v+0];
+                sum[1] += vertices[3*v+1];
+                sum[2] += vertices[3*v+2];
+                remap[v] = (uint32_t)c;
+            }
+            const double count = (double)(runs[c+1] - runs[c]);
+            for (int d = 0; d < 3; d++)
+                res.vertices[3*c+d] = (float)(sum[d] / count);
+        }
+    }, nthreads, DECIMATE_MIN_PER_THREAD / 8);
+
+    // Remaining triangles, rotated so the smallest index comes first (which
+    // keeps the orientation), so duplicates can be found by sorting
+    typedef std::pair<uint64_t, uint32_t> TriKey;     // (i0, i1) and i2
+    const unsigned tchunks = num_chunks(ntris, nthreads, DECIMATE_MIN_PER_THREAD);
+    std::vector<std::vector<TriKey>> kept(tchunks);
+
+    parallel_for(ntris, [&](size_t begin, size_t end, unsigned chunk) {
+        std::vector<TriKey>& out = kept[chunk];
+        for (size_t t = begin; t < end; t++)
+        {
+            uint32_t a = remap[indices[3*t+0]], b = remap[indices[3*t+1]], c = remap[indices[3*t+2]];
+            if (a == b || b == c || a == c)
+                continue;
+            while (a > b || a > c)
+            {
+                const uint32_t tmp = a;
+                a = b; b = c; c = tmp;
+            }
+            out.push_back(TriKey(((uint64_t)a << 32) | b, c));
+        }
+    }, nthreads, DECIMATE_MIN_PER_THREAD);
+
+    std::vector<TriKey> tris;
+    for (unsigned c = 0; c < tchunks; c++)
+    {
+        tris.insert(tris.end(), kept[c].begin(), kept[c].end());
+        std::vector<TriKey>().swap(kept[c]);
+    }
+
+    parallel_sort(tris.data(), tris.size(), std::less<TriKey>(), nthreads);
+    tris.erase(std::unique(tris.begin(), tris.end()), tris.end());
+
+    res.indices.resize(3*tris.size());
+    for (size_t t = 0; t < tris.size(); t++)
+    {
+        res.indices[3*t+0] = (uint32_t)(tris[t].first >> 32);
+        res.indices[3*t+1] = (uint32_t)(tris[t].first & 0xffffffff);
+        res.indices[3*t+2] = tris[t].second;
+    }
+}
+
+// Decimate to approximately target triangles. The number of triangles
+// of a clustered surface is roughly proportional to the square of the
+// grid resolution, which is used to refine the resolution estimate.
+inline unsigned
+decimate_to_target(const float *vertices, size_t nverts, const uint32_t *indices, size_t ntris,
+    size_t target, unsigned nthreads, DecimatedMesh& res)
+{
+    target = std::max(target, (size_t)1);
+
+    // Initial guess: a closed surface clustered at resolution r has 
+    // in the order of 2r^2 triangles
+    unsigned resolution = std::max(1u, (unsigned)std::sqrt((double)target / 2.0));
+
+    for (int iter = 0; iter < 3; iter++)
+    {
+        cluster_decimate(vertices, nverts, indices, ntris, resolution, nthreads, res);
+
+        const size_t n = res.num_triangles();
+        if (n == 0 || (n <= target && n >= target*3/4))
+            break;
+
+        const double f = std::sqrt((double)target / n);
+        const unsigned next = std::max(1u, (unsigned)(resolution * f));
+        if (next == resolution)
+            break;
+        resolution = next;
+    }
+
+    // Make sure we end up within the target
+    while (res.num_triangles() > target && resolution > 1)
+    {
+        resolution = resolution * 9 / 10;
+        cluster_decimate(vertices, nverts, indices, ntris, resolution, nthreads, res);
+    }
+
+    return resolution;
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// Decomposition of a structured volume over the ranks of a distributed
+// (data-parallel) device. The cells of the volume are split into a
+// regular grid of bricks, one per rank. As volume values are vertex
+// centered, neighbouring bricks share the voxels on their common boundary,
+// plus optional ghost voxels, so interpolation (and gradients) match
+// across bricks. The region a rank owns, for the World "region"
+// parameter, covers only its own cells.
+
+// Number of bricks along each axis for nranks, picking the factorization
+// nranks = grid[0]*grid[1]*grid[2] with the smallest total area of the
+// cuts between bricks. Throws if the volume has too few cells.
+inline void
+brick_grid(unsigned nranks, const size_t dims[3], unsigned grid[3])
+{
+    if (nranks == 0)
+        throw std::invalid_argument("number of ranks needs to be at least 1");
+
+    size_t cells[3];
+    for (int d = 0; d < 3; d++)
+    {
+        if (dims[d] < 2)
+            throw std::invalid_argument("volume needs at least 2 voxels along each axis");
+        cells[d] = dims[d] - 1;
+    }
+
+    double best = std::numeric_limits<double>::max();
+    grid[0] = grid[1] = grid[2] = 0;
+
+    for (unsigned gx = 1; gx <= nranks; gx++)
+    {
+        if (nranks % gx != 0 || gx > cells[0])
+            continue;
+        for (unsigned gy = 1; gy <= nranks / gx; gy++)
+        {
+            if ((nranks / gx) % gy != 0 || gy > cells[1])
+                continue;
+            const unsigned gz = nranks / gx / gy;
+            if (gz > cells[2])
+                continue;
+
+            const double cost =
+                (gx - 1.0) * cells[1] * cells[2] +
+                (gy - 1.0) * cells[0] * cells[2] +
+                (gz - 1.0) * cells[0] * cells[1];
+
+            if (cost < best)
+            {
+                best = cost;
+                grid[0] = gx; grid[1] = gy; grid[2] = gz;
+            }
+        }
+    }
+
+    if (grid[0] == 0)
+        throw std::invalid_argument("volume too small to split over " + std::to_string(nranks) + " ranks");
+}
+
+struct BrickExtent
+{
+    unsigned    index[3];       // Position of the brick in the grid
+    size_t      cell_lo[3];     // Owned cells [cell_lo, cell_hi)
+    size_t      cell_hi[3];
+    size_t      voxel_lo[3];    // Voxels needed [voxel_lo, voxel_hi), incl. ghosts
+    size_t      voxel_hi[3];
+};
+
+// Extent of the brick of rank, with ranks assigned to bricks in x-fastest
+// order. Cells are distributed as evenly as possible.
+inline void
+brick_extent(unsigned rank, const unsigned grid[3], const size_t dims[3], unsigned ghost, BrickExtent& res)
+{
+    if (rank >= grid[0] * grid[1] * grid[2])
+        throw std::invalid_argument("rank " + std::to_string(rank) + " out of range");
+
+    res.index[0] = rank % grid[0];
+    res.index[1] = (rank / grid[0]) % grid[1];
+    res.index[2] = rank / grid[0] / grid[1];
+
+    for (int d = 0; d < 3; d++)
+    {
+        const size_t cells = dims[d] - 1;
+        const size_t i = res.index[d];
+        res.cell_lo[d] = cells * i / grid[d];
+        res.cell_hi[d] = cells * (i + 1) / grid[d];
+        // Cell c spans voxels c and c+1
+        res.voxel_lo[d] = res.cell_lo[d] >= ghost ? res.cell_lo[d] - ghost : 0;
+        res.voxel_hi[d] = std::min(res.cell_hi[d] + 1 + ghost, dims[d]);
+    }
+}
+
+#endif
@@ -153,6 +153,29 @@ define_enums(py::module& m)
         .value("OSP_TEXTURE_FILTER_NEAREST", OSPTextureFilter::OSP_TEXTURE_FILTER_NEAREST)
         .export_values()            
     ;        
+    
+    py::enum_<OSPVolumeFormat>(m, "OSPVolumeFormat")
+        .value("OSP_VOLUME_FORMAT_TILE", OSPVolumeFormat::OSP_VOLUME_FORMAT_TILE)
+        .value("OSP_VOLUME_FORMAT_DENSE_ZYX", OSPVolumeFormat::OSP_VOLUME_FORMAT_DENSE_ZYX)
+        .value("OSP_VOLUME_FORMAT_INVALID", OSPVolumeFormat::OSP_VOLUME_FORMAT_INVALID)
+        .export_values()            
+    ;        
+    
+    py::enum_<OSPAMRMethod>(m, "OSPAMRMethod")
+        .value("OSP_AMR_CURRENT", OSPAMRMethod::OSP_AMR_CURRENT)
+        .value("OSP_AMR_FINEST", OSPAMRMethod::OSP_AMR_FINEST)
+        .value("OSP_AMR_OCTANT", OSPAMRMethod::OSP_AMR_OCTANT)
+        .export_values()            
+    ;        
+    
+    py::enum_<OSPUnstructuredCellType>(m, "OSPUnstructuredCellType")
+        .value("OSP_TETRAHEDRON", OSPUnstructuredCellType::OSP_TETRAHEDRON)
+        .value("OSP_HEXAHEDRON", OSPUnstructuredCellType::OSP_HEXAHEDRON)
+        .value("OSP_WEDGE", OSPUnstructuredCellType::OSP_WEDGE)
+        .value("OSP_PYRAMID", OSPUnstructuredCellType::OSP_PYRAMID)
+        .value("OSP_UNKNOWN_CELL_TYPE", OSPUnstructuredCellType::OSP_UNKNOWN_CELL_TYPE)
+        .export_values()            
+    ;        
 }
 
 #endif
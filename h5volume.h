@@ -0,0 +1,235 @@
+#ifndef H5VOLUME_H
+#define H5VOLUME_H
+
+// Reading (part of) a 3D HDF5 dataset directly into a volume array.
+// Only available when building with -DHAVE_HDF5.
+
+#ifdef HAVE_HDF5
+
+#include <hdf5.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// Target size of the slabs read with a single H5Dread()
+const size_t H5VOLUME_SLAB_BYTES = 64 << 20;
+
+// Closes an HDF5 handle when going out of scope
+class H5Handle
+{
+public:
+
+    H5Handle(hid_t id, herr_t (*close)(hid_t)): id(id), close(close) {}
+    ~H5Handle() { if (id >= 0) close(id); }
+
+    operator hid_t() const { return id; }
+    bool valid() const { return id >= 0; }
+
+protected:
+    hid_t   id;
+    herr_t  (*close)(hid_t);
+
+    H5Handle(const H5Handle&) = delete;
+    H5Handle& operator=(const H5Handle&) = delete;
+};
+
+// Selection of a volume region, in IJK order (i.e. x, y, z). A zero count
+// means all remaining elements along that axis (taking stride into account).
+struct H5VolumeSelection
+{
+    size_t  start[3];
+    size_t  count[3];
+    size_t  stride[3];
+
+    H5VolumeSelection()
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            start[i] = 0;
+            count[i] = 0;
+            stride[i] = 1;
+        }
+    }
+};
+
+// Information on a 3D dataset, with dimensions in IJK order, i.e.
+// reversed compared to the (C-order) KJI dataspace of the file
+struct H5VolumeInfo
+{
+    size_t      dims[3];
+    size_t      chunk[3];       // All zero when not chunked
+    H5T_class_t type_class;
+    size_t      type_size;
+    bool        type_signed;
+};
+
+static void
+h5volume_open(const std::string& fname, const std::string& dataset, H5VolumeInfo& info, hid_t& file, hid_t& dset)
+{
+    file = H5Fopen(fname.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file < 0)
+        throw std::runtime_error("Could not open HDF5 file '" + fname + "'");
+
+    dset = H5Dopen2(file, dataset.c_str(), H5P_DEFAULT);
+    if (dset < 0)
+    {
+        H5Fclose(file);
+        throw std::runtime_error("Could not open dataset '" + dataset + "' in HDF5 file '" + fname + "'");
+    }
+
+    H5Handle space(H5Dget_space(dset), H5Sclose);
+    H5Handle type(H5Dget_type(dset), H5Tclose);
+    H5Handle dcpl(H5Dget_create_plist(dset), H5Pclose);
+
+    if (H5Sget_simple_extent_ndims(space) != 3)
+    {
+        H5Dclose(dset);
+        H5Fclose(file);
+        throw std::runtime_error("Dataset '" + dataset + "' is not 3-dimensional");
+    }
+
+    hsize_t dims[3], chunk[3] = { 0, 0, 0 };
+    H5Sget_simple_extent_dims(space, dims, nullptr);
+    if (H5Pget_layout(dcpl) == H5D_CHUNKED)
+        H5Pget_chunk(dcpl, 3, chunk);
+
+    for (int i = 0; i < 3; i++)
+    {
+        info.dims[i] = dims[2-i];
+        info.chunk[i] = chunk[2-i];
+    }
+
+    info.type_class = H5Tget_class(type);
+    info.type_size = H5Tget_size(type);
+    info.type_signed = info.type_class == H5T_INTEGER && H5Tget_sign(type) == H5T_SGN_2;
+}
+
+// Dataset information, without reading any values
+void
+h5volume_info(const std::string& fname, const std::string& dataset, H5VolumeInfo& info)
+{
+    hid_t file, dset;
+
+    h5volume_open(fname, dataset, info, file, dset);
+
+    H5Dclose(dset);
+    H5Fclose(file);
+}
+
+// Fill in the defaults of a selection and check it against the dataset
+// dimensions. Returns the dimensions of the selected region (IJK).
+void
+h5volume_resolve_selection(const H5VolumeInfo& info, H5VolumeSelection& sel, size_t res_dims[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (sel.stride[i] == 0)
+            throw std::invalid_argument("HDF5 selection stride needs to be at least 1");
+        if (sel.start[i] >= info.dims[i])
+            throw std::invalid_argument("HDF5 selection start outside of the dataset");
+
+        const size_t available = (info.dims[i] - sel.start[i] + sel.stride[i] - 1) / sel.stride[i];
+
+        if (sel.count[i] == 0)
+            sel.count[i] = available;
+        else if (sel.count[i] > available)
+            throw std::invalid_argument("HDF5 selection extends outside of the dataset");
+
+        res_dims[i] = sel.count[i];
+    }
+}
+
+static void
+h5volume_read_slabs(hid_t dset, const H5VolumeSelection& sel, const size_t dims[3], size_t slab,
+    hid_t memtype, size_t elem_size, void *dst)
+{
+    H5Handle filespace(H5Dget_space(dset), H5Sclose);
+    char *out = static_cast<char*>(dst);
+
+    for (size_t z = 0; z < dims[2]; z += slab)
+    {
+        const size_t nz = std::min(slab, dims[2] - z);
+
+        // File dataspace is KJI
+        const hsize_t start[3] = { sel.start[2] + z*sel.stride[2], sel.start[1], sel.start[0] };
+        const hsize_t stride[3] = { sel.stride[2], sel.stride[1], sel.stride[0] };
+        const hsize_t count[3] = { nz, dims[1], dims[0] };
+
+        if (H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, stride, count, nullptr) < 0)
+            throw std::runtime_error("Could not select HDF5 hyperslab");
+
+        H5Handle memspace(H5Screate_simple(3, count, nullptr), H5Sclose);
+
+        if (H5Dread(dset, memtype, memspace, filespace, H5P_DEFAULT, out) < 0)
+            throw std::runtime_error("Could not read HDF5 dataset values");
+
+        out += nz * dims[1] * dims[0] * elem_size;
+    }
+}
+
+// Read the selected region of a 3D dataset into dst, which must have room
+// for count[0]*count[1]*count[2] values of memory type memtype (e.g.
+// H5T_NATIVE_FLOAT), stored with x varying fastest. HDF5 converts values
+// to memtype while reading.
+//
+// A KJI dataset in the file is IJK in memory when x is fastest, so the
+// region is read directly into dst, as a series of z slabs. Slabs are
+// aligned to the dataset chunking (when chunked) and the chunk cache
+// is sized to hold one slab's worth of chunks, so each chunk gets
+// read and decompressed only once. Peak memory use is therefore dst,
+// plus a slab of chunks.
+void
+h5volume_read(const std::string& fname, const std::string& dataset, const H5VolumeSelection& selection,
+    hid_t memtype, void *dst)
+{
+    H5VolumeInfo info;
+    H5VolumeSelection sel = selection;
+    size_t dims[3];
+    hid_t file_id, dset_id;
+
+    h5volume_open(fname, dataset, info, file_id, dset_id);
+
+    H5Handle file(file_id, H5Fclose);
+    H5Handle dset(dset_id, H5Dclose);
+
+    h5volume_resolve_selection(info, sel, dims);
+
+    const size_t elem_size = H5Tget_size(memtype);
+    const size_t slice_bytes = dims[0] * dims[1] * elem_size;
+    const size_t slice_z = sel.stride[2];
+
+    // Number of z slices (in the selection) per slab
+    size_t slab = std::max((size_t)1, H5VOLUME_SLAB_BYTES / std::max(slice_bytes, (size_t)1));
+
+    if (info.chunk[2] > 0)
+    {
+        // Whole number of chunk layers
+        const size_t per_chunk = std::max((size_t)1, info.chunk[2] / slice_z);
+        slab = std::max(per_chunk, slab / per_chunk * per_chunk);
+
+        // Chunk cache large enough for all chunks overlapping one slab
+        const size_t chunks_x = (info.dims[0] + info.chunk[0] - 1) / info.chunk[0];
+        const size_t chunks_y = (info.dims[1] + info.chunk[1] - 1) / info.chunk[1];
+        const size_t chunks_z = (slab*slice_z + info.chunk[2] - 1) / info.chunk[2] + 1;
+        const size_t nchunks = chunks_x * chunks_y * chunks_z;
+        const size_t chunk_bytes = info.chunk[0] * info.chunk[1] * info.chunk[2] * info.type_size;
+
+        H5Handle dapl(H5Pcreate(H5P_DATASET_ACCESS), H5Pclose);
+        H5Pset_chunk_cache(dapl, nchunks*10+1, nchunks*chunk_bytes, 1.0);
+
+        // Reopen with the enlarged cache
+        const hid_t reopened = H5Dopen2(file, dataset.c_str(), dapl);
+        if (reopened < 0)
+            throw std::runtime_error("Could not reopen dataset '" + dataset + "'");
+        H5Handle cached(reopened, H5Dclose);
+
+        h5volume_read_slabs(cached, sel, dims, slab, memtype, elem_size, dst);
+        return;
+    }
+
+    h5volume_read_slabs(dset, sel, dims, slab, memtype, elem_size, dst);
+}
+
+#endif
+
+#endif
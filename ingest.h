@@ -0,0 +1,192 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "parallel.h"
+
+// Conversion of array values to types OSPRay can handle
+
+const size_t INGEST_MIN_PER_THREAD = 1 << 16;
+
+// IEEE 754 half-precision value (numpy.float16), stored as raw bits.
+// There's no OSPRay equivalent, so these always get converted to float.
+struct float16_t
+{
+    uint16_t    bits;
+};
+
+inline float
+half_to_float(uint16_t h)
+{
+    const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+            bits = sign;
+        else
+        {
+            // Subnormal, renormalize as float
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400) == 0)
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            mantissa &= 0x3ff;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 31)
+        bits = sign | 0x7f800000u | (mantissa << 13);     // Inf/NaN
+    else
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+
+    float f;
+    memcpy(&f, &bits, sizeof(float));
+
+    return f;
+}
+
+template<typename D, typename S>
+inline D
+convert_value(S v)
+{
+    return static_cast<D>(v);
+}
+
+template<typename D>
+inline D
+convert_value(float16_t v)
+{
+    return static_cast<D>(half_to_float(v.bits));
+}
+
+// Convert n values of type S to type D, in parallel
+template<typename S, typename D>
+void
+convert_values(const S *src, size_t n, D *dst, unsigned nthreads=0)
+{
+    parallel_for(n, [=](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t i = begin; i < end; i++)
+            dst[i] = convert_value<D>(src[i]);
+    }, nthreads, INGEST_MIN_PER_THREAD);
+}
+
+// Concatenate (and convert) the arrays srcs[i] into dst, where array i
+// has offsets[i+1] - offsets[i] values and is stored from dst + offsets[i].
+// Work is split evenly over all values, not over arrays, so that large
+// and small arrays can be mixed.
+template<typename S, typename D>
+void
+gather_values(const S* const *srcs, const size_t *offsets, size_t narrays, D *dst, unsigned nthreads=0)
+{
+    if (narrays == 0)
+        return;
+
+    parallel_for(offsets[narrays], [=](size_t begin, size_t end, unsigned /*chunk*/) {
+        // Array containing value begin
+        size_t a = std::upper_bound(offsets, offsets + narrays + 1, begin) - offsets - 1;
+        size_t i = begin;
+
+        while (i < end)
+        {
+            const size_t last = std::min(end, offsets[a+1]);
+            const S *src = srcs[a] - offsets[a];
+            for (; i < last; i++)
+                dst[i] = convert_value<D>(src[i]);
+            a++;
+        }
+    }, nthreads, INGEST_MIN_PER_THREAD);
+}
+
+// Block size (per axis) for the cache-blocked transpose in permute_values()
+const size_t INGEST_BLOCK_SIZE = 16;
+
+// Copy a (possibly strided) 3D array of values of type S into the 
+// contiguous array dst of dimensions dims, with x varying fastest, 
+// converting values to type D on the way. Element (x, y, z) is read
+// from byte offset x*strides[0] + y*strides[1] + z*strides[2] in src,
+// so any axis permutation of the source (e.g. KJI -> IJK) is handled 
+// by passing permuted strides.
+//
+// When x is the fastest varying source axis rows are copied as is, 
+// otherwise the volume is processed in small 3D blocks so that both 
+// the source and destination cache lines get reused.
+template<typename S, typename D>
+void
+permute_values(const void *src, const ptrdiff_t strides[3], const size_t dims[3], 
+    D *dst, unsigned nthreads=0)
+{
+    const char *base = static_cast<const char*>(src);
+    const size_t nx = dims[0], ny = dims[1], nz = dims[2];
+    const ptrdiff_t sx = strides[0], sy = strides[1], sz = strides[2];
+    
+    auto abs_stride = [](ptrdiff_t s) { return s < 0 ? -s : s; };
+
+    if (abs_stride(sx) <= abs_stride(sy) && abs_stride(sx) <= abs_stride(sz))
+    {
+        // Rows along x, parallel over all (y, z) rows
+        const size_t min_rows = nx > 0 ? INGEST_MIN_PER_THREAD / nx + 1 : 1;
+
+        parallel_for(ny*nz, [=](size_t begin, size_t end, unsigned /*chunk*/) {
+            for (size_t r = begin; r < end; r++)
+            {
+                const size_t y = r % ny, z = r / ny;
+                const char *row = base + y*sy + z*sz;
+                D *out = dst + r*nx;
+
+                if (sx == (ptrdiff_t)sizeof(S))
+                {
+                    const S *in = reinterpret_cast<const S*>(row);
+                    for (size_t x = 0; x < nx; x++)
+                        out[x] = convert_value<D>(in[x]);
+                }
+                else
+                {
+                    for (size_t x = 0; x < nx; x++)
+                        out[x] = convert_value<D>(*reinterpret_cast<const S*>(row + x*sx));
+                }
+            }
+        }, nthreads, min_rows);
+
+        return;
+    }
+
+    const size_t B = INGEST_BLOCK_SIZE;
+    const size_t bx = (nx + B - 1) / B, by = (ny + B - 1) / B, bz = (nz + B - 1) / B;
+    const size_t min_blocks = INGEST_MIN_PER_THREAD / (B*B*B) + 1;
+
+    // Blocks write disjoint parts of dst, so no synchronization needed
+    parallel_for(bx*by*bz, [=](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t b = begin; b < end; b++)
+        {
+            const size_t x0 = (b % bx) * B;
+            const size_t y0 = ((b / bx) % by) * B;
+            const size_t z0 = (b / (bx*by)) * B;
+            const size_t x1 = std::min(x0 + B, nx);
+            const size_t y1 = std::min(y0 + B, ny);
+            const size_t z1 = std::min(z0 + B, nz);
+
+            for (size_t z = z0; z < z1; z++)
+            {
+                for (size_t y = y0; y < y1; y++)
+                {
+                    const char *row = base + y*sy + z*sz;
+                    D *out = dst + (z*ny + y)*nx;
+
+                    for (size_t x = x0; x < x1; x++)
+                        out[x] = convert_value<D>(*reinterpret_cast<const S*>(row + x*sx));
+                }
+            }
+        }
+    }, nthreads, min_blocks);
+}
+
+#endif
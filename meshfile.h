@@ -0,0 +1,414 @@
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Native readers for PLY (ascii and binary) and binary STL mesh files, so
+// many files can be loaded in parallel without holding the GIL. Only the
+// vertex positions, normals and colors plus the faces are read, other
+// elements and properties are skipped. Errors are reported by throwing
+// std::runtime_error.
+
+struct MeshFile
+{
+    std::vector<float>      vertices;       // xyz
+    std::vector<float>      normals;        // xyz per vertex, or empty
+    std::vector<float>      colors;         // rgba per vertex, or empty
+    std::vector<uint32_t>   indices;        // Vertex indices of all faces,
+    std::vector<uint32_t>   loop_lengths;   // with the number of vertices per face
+
+    size_t num_vertices() const { return vertices.size() / 3; }
+    size_t num_faces() const { return loop_lengths.size(); }
+};
+
+// Whole file, followed by a 0 byte (so ascii values can be parsed in place)
+inline void
+read_whole_file(const std::string& fname, std::vector<char>& buf)
+{
+    std::ifstream f(fname, std::ios::in | std::ios::binary);
+    if (!f)
+        throw std::runtime_error(fname + ": can't open file");
+
+    f.seekg(0, std::ios::end);
+    const std::streamoff size = f.tellg();
+    f.seekg(0, std::ios::beg);
+
+    buf.resize((size_t)size + 1);
+    if (size > 0 && !f.read(buf.data(), size))
+        throw std::runtime_error(fname + ": read error");
+    buf[size] = 0;
+}
+
+enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+inline PlyType
+ply_type(const std::string& name)
+{
+    if (name == "char" || name == "int8") return PLY_INT8;
+    if (name == "uchar" || name == "uint8") return PLY_UINT8;
+    if (name == "short" || name == "int16") return PLY_INT16;
+    if (name == "ushort" || name == "uint16") return PLY_UINT16;
+    if (name == "int" || name == "int32") return PLY_INT32;
+    if (name == "uint" || name == "uint32") return PLY_UINT32;
+    if (name == "float" || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    throw std::runtime_error("unknown PLY property type '" + name + "'");
+}
+
+inline size_t
+ply_type_size(PlyType type)
+{
+    static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+    return sizes[type];
+}
+
+struct PlyProperty
+{
+    std::string     name;
+    PlyType         type;
+    bool            is_list;
+    PlyType         count_type;
+};
+
+struct PlyElement
+{
+    std::string                 name;
+    size_t                      count;
+    std::vector<PlyProperty>    properties;
+
+    // Index of the named property, or -1
+    int
+    find(const char *prop) const
+    {
+        for (size_t i = 0; i < properties.size(); i++)
+            if (properties[i].name == prop)
+                return (int)i;
+        return -1;
+    }
+};
+
+// Sequential reader of the values in the body of a PLY file
+class PlyReader
+{
+public:
+
+    PlyReader(const char *begin, const char *end, bool ascii, bool swap)
+    :
+        p(begin), end(end), ascii(ascii), swap(swap)
+    {
+    }
+
+    double
+    next(PlyType type)
+    {
+        if (ascii)
+        {
+            while (p < end && std::isspace((unsigned char)*p))
+                p++;
+            if (p >= end)
+                throw std::runtime_error("unexpected end of file");
+
+            char *q;
+            const double v = std::strtod(p, &q);
+            if (q == p)
+                throw std::runtime_error("invalid value in ascii data");
+            p = q;
+            return v;
+        }
+
+        const size_t size = ply_type_size(type);
+        if (p + size > end)
+            throw std::runtime_error("unexpected end of file");
+
+        unsigned char b[8];
+        std::memcpy(b, p, size);
+        if (swap)
+            std::reverse(b, b + size);
+        p += size;
+
+        switch (type)
+        {
+          case PLY_INT8     : { int8_t v; std::memcpy(&v, b, 1); return v; }
+          case PLY_UINT8    : { uint8_t v; std::memcpy(&v, b, 1); return v; }
+          case PLY_INT16    : { int16_t v; std::memcpy(&v, b, 2); return v; }
+          case PLY_UINT16   : { uint16_t v; std::memcpy(&v, b, 2); return v; }
+          case PLY_INT32    : { int32_t v; std::memcpy(&v, b, 4); return v; }
+          case PLY_UINT32   : { uint32_t v; std::memcpy(&v, b, 4); return v; }
+          case PLY_FLOAT32  : { float v; std::memcpy(&v, b, 4); return v; }
+          default           : { double v; std::memcpy(&v, b, 8); return v; }
+        }
+    }
+
+protected:
+    const char  *p, *end;
+    bool        ascii, swap;
+};
+
+inline bool
+host_is_little_endian()
+{
+    const uint16_t v = 1;
+    unsigned char b;
+    std::memcpy(&b, &v, 1);
+    return b == 1;
+}
+
+inline void
+read_ply_file(const std::string& fname, MeshFile& mesh)
+{
+    mesh = MeshFile();
+
+    std::vector<char> buf;
+    read_whole_file(fname, buf);
+
+    const char *data = buf.data();
+    const char *end = data + buf.size() - 1;
+
+    if (buf.size() < 4 || std::strncmp(data, "ply", 3) != 0)
+        throw std::runtime_error(fname + ": not a PLY file");
+
+    // The header never contains 0 bytes, so strstr() stays within it
+    const char *header_end = std::strstr(data, "end_header");
+    if (header_end == nullptr)
+        throw std::runtime_error(fname + ": no end_header in PLY header");
+    const char *body = std::strchr(header_end, '\n');
+    body = body != nullptr ? body + 1 : end;
+
+    // Header
+    std::istringstream header(std::string(data, header_end));
+    std::vector<PlyElement> elements;
+    std::string line, format;
+
+    while (std::getline(header, line))
+    {
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+
+        if (keyword == "format")
+            tokens >> format;
+        else if (keyword == "element")
+        {
+            PlyElement el;
+            tokens >> el.name >> el.count;
+            if (!tokens)
+                throw std::runtime_error(fname + ": invalid element line '" + line + "'");
+            elements.push_back(el);
+        }
+        else if (keyword == "property")
+        {
+            if (elements.empty())
+                throw std::runtime_error(fname + ": property before first element");
+
+            PlyProperty prop;
+            std::string type;
+            tokens >> type;
+            prop.is_list = type == "list";
+            try
+            {
+                if (prop.is_list)
+                {
+                    std::string count_type;
+                    tokens >> count_type >> type;
+                    prop.count_type = ply_type(count_type);
+                }
+                prop.type = ply_type(type);
+            }
+            catch (const std::exception& e)
+            {
+                throw std::runtime_error(fname + ": " + e.what());
+            }
+            tokens >> prop.name;
+            elements.back().properties.push_back(prop);
+        }
+    }
+
+    bool ascii = false, little_endian = true;
+    if (format == "ascii")
+        ascii = true;
+    else if (format == "binary_big_endian")
+        little_endian = false;
+    else if (format != "binary_little_endian")
+        throw std::runtime_error(fname + ": unsupported PLY format '" + format + "'");
+
+    PlyReader reader(body, end, ascii, little_endian != host_is_little_endian());
+    std::vector<double> values;
+
+    try
+    {
+        for (const PlyElement& el : elements)
+        {
+            const size_t nprops = el.properties.size();
+            values.assign(nprops, 0.0);
+
+            const bool is_vertex = el.name == "vertex";
+            const bool is_face = el.name == "face";
+
+            int pos[3] = { el.find("x"), el.find("y"), el.find("z") };
+            int normal[3] = { el.find("nx"), el.find("ny"), el.find("nz") };
+            int color[4] = { el.find("red"), el.find("green"), el.find("blue"), el.find("alpha") };
+            int face = el.find("vertex_indices");
+            if (face < 0)
+                face = el.find("vertex_index");
+
+            bool have_normals = false, have_colors = false;
+
+            if (is_vertex)
+            {
+                if (pos[0] < 0 || pos[1] < 0 || pos[2] < 0)
+                    throw std::runtime_error("vertex element without x, y and z");
+                have_normals = normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0;
+                have_colors = color[0] >= 0 && color[1] >= 0 && color[2] >= 0;
+
+                mesh.vertices.reserve(3*el.count);
+                if (have_normals)
+                    mesh.normals.reserve(3*el.count);
+                if (have_colors)
+                    mesh.colors.reserve(4*el.count);
+            }
+
+            for (size_t i = 0; i < el.count; i++)
+            {
+                for (size_t k = 0; k < nprops; k++)
+                {
+                    const PlyProperty& prop = el.properties[k];
+
+                    if (!prop.is_list)
+                    {
+                        values[k] = reader.next(prop.type);
+                        continue;
+                    }
+
+                    const double n = reader.next(prop.count_type);
+                    if (n < 0)
+                        throw std::runtime_error("negative list length");
+
+                    const bool keep = is_face && (int)k == face && n >= 3;
+                    for (size_t j = 0; j < (size_t)n; j++)
+                    {
+                        const double v = reader.next(prop.type);
+                        if (keep)
+                        {
+                            if (v < 0)
+                                throw std::runtime_error("negative vertex index");
+                            mesh.indices.push_back((uint32_t)v);
+                        }
+                    }
+                    if (keep)
+                        mesh.loop_lengths.push_back((uint32_t)n);
+                }
+
+                if (!is_vertex)
+                    continue;
+
+                for (int d = 0; d < 3; d++)
+                    mesh.vertices.push_back((float)values[pos[d]]);
+                if (have_normals)
+                {
+                    for (int d = 0; d < 3; d++)
+                        mesh.normals.push_back((float)values[normal[d]]);
+                }
+                if (have_colors)
+                {
+                    // 8-bit colors map to [0, 1], other types are used as is
+                    for (int d = 0; d < 4; d++)
+                    {
+                        if (color[d] < 0)
+                            mesh.colors.push_back(1.0f);
+                        else
+                        {
+                            const float scale = el.properties[color[d]].type == PLY_UINT8 ? 1.0f/255 : 1.0f;
+                            mesh.colors.push_back((float)values[color[d]] * scale);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(fname + ": " + e.what());
+    }
+}
+
+// Binary STL, which stores separate vertices per triangle, with a
+// normal per triangle (which is used for each of its vertices)
+inline void
+read_stl_file(const std::string& fname, MeshFile& mesh)
+{
+    mesh = MeshFile();
+
+    std::vector<char> buf;
+    read_whole_file(fname, buf);
+
+    const size_t size = buf.size() - 1;
+    uint32_t ntris = 0;
+    if (size >= 84)
+    {
+        unsigned char b[4];
+        std::memcpy(b, &buf[80], 4);
+        ntris = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+    }
+
+    if (size < 84 || size != 84 + 50*(size_t)ntris)
+    {
+        if (std::strncmp(buf.data(), "solid", 5) == 0)
+            throw std::runtime_error(fname + ": ascii STL files are not supported");
+        throw std::runtime_error(fname + ": invalid binary STL file");
+    }
+
+    const bool swap = !host_is_little_endian();
+    mesh.vertices.resize(9*(size_t)ntris);
+    mesh.normals.resize(9*(size_t)ntris);
+    mesh.indices.resize(3*(size_t)ntris);
+    mesh.loop_lengths.assign(ntris, 3);
+
+    for (size_t t = 0; t < ntris; t++)
+    {
+        // Normal plus 3 vertices, 12 floats, followed by 2 attribute bytes
+        float v[12];
+        std::memcpy(v, &buf[84 + 50*t], sizeof(v));
+        if (swap)
+        {
+            for (int i = 0; i < 12; i++)
+            {
+                unsigned char *b = reinterpret_cast<unsigned char*>(&v[i]);
+                std::reverse(b, b + 4);
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            std::copy(v, v + 3, &mesh.normals[9*t + 3*i]);
+            std::copy(v + 3 + 3*i, v + 6 + 3*i, &mesh.vertices[9*t + 3*i]);
+            mesh.indices[3*t + i] = (uint32_t)(3*t + i);
+        }
+    }
+}
+
+// Read a PLY or binary STL file, based on the file extension
+inline void
+read_mesh_file(const std::string& fname, MeshFile& mesh)
+{
+    const size_t dot = fname.rfind('.');
+    std::string ext = dot == std::string::npos ? "" : fname.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+    if (ext == "ply")
+        read_ply_file(fname, mesh);
+    else if (ext == "stl")
+        read_stl_file(fname, mesh);
+    else
+        throw std::runtime_error(fname + ": unsupported mesh file type (only .ply and .stl)");
+}
+
+#endif
@@ -2,6 +2,17 @@
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include <pybind11/operators.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <ospray/ospray.h>
+#include <ospray/ospray_util.h>
+// Needs to come before ospray_cpp.h, see scene.h
+#include "scene.h"
 #include <ospray/ospray_cpp.h>
 #include <ospray/version.h>
 #include <glm/glm.hpp>
@@ -11,6 +22,21 @@
 #include "enums.h"
 #include "conversion.h"
 #include "mat.h"
+#include "tf.h"
+#include "volume.h"
+#include "ingest.h"
+#include "h5volume.h"
+#include "vdb.h"
+#include "unstructured.h"
+#include "partition.h"
+#include "decimate.h"
+#include "polygon.h"
+#include "meshfile.h"
+#include "datacache.h"
+#include "stream.h"
+#include "distributed.h"
+#include "timeseries.h"
+#include "camerapath.h"
 //#include "testing.h"
 
 namespace py = pybind11;
@@ -157,6 +183,102 @@ print_array_info(const py::array &array)
     printf("), dtype kind '%c' itemsize %ld\n", dtype.kind(), dtype.itemsize());
 }
 
+// Native code processes array.data() linearly, so make sure
+// there's no gaps in the array memory
+static py::array
+contiguous_array(const py::array& array)
+{
+    if (array.flags() & (py::array::c_style | py::array::f_style))
+        return array;
+    
+    return py::module::import("numpy").attr("ascontiguousarray")(array);
+}
+
+// Keep patient alive for as long as nurse is. For buffers created in 
+// native code that are shared by the returned object, where 
+// py::keep_alive<> on the binding doesn't apply as the buffer isn't an 
+// argument. The reference is dropped by the callback of a weak 
+// reference to nurse.
+static void
+keep_alive_with(const py::object& nurse, const py::object& patient)
+{
+    py::handle p = patient;
+    p.inc_ref();
+    
+    py::cpp_function release([p](py::handle weakref) {
+        p.dec_ref();
+        weakref.dec_ref();
+    });
+    
+    // Stays alive until nurse goes away, released in the callback
+    py::weakref(nurse, release).release();
+}
+
+// numpy.float16, which has no C++ equivalent for py::array_t<>
+static bool
+is_float16_array(const py::array& array)
+{
+    const py::dtype& dtype = array.dtype();
+    
+    return dtype.kind() == 'f' && dtype.itemsize() == 2;
+}
+
+// Array values converted to type D, for values that OSPRay has no direct 
+// equivalent for: float16 -> float, plus 16-bit integers in vector 
+// and box types -> 32-bit integers
+template<typename D>
+static std::vector<D>
+converted_values(const py::array& array)
+{
+    py::array values = contiguous_array(array);
+    const size_t n = values.size();
+    const void *src = values.data();
+    std::vector<D> res(n);
+    
+    if (is_float16_array(values))
+    {
+        py::gil_scoped_release release;
+        convert_values(static_cast<const float16_t*>(src), n, res.data());
+    }
+    else if (py::isinstance<py::array_t<int16_t>>(values))
+    {
+        py::gil_scoped_release release;
+        convert_values(static_cast<const int16_t*>(src), n, res.data());
+    }
+    else if (py::isinstance<py::array_t<uint16_t>>(values))
+    {
+        py::gil_scoped_release release;
+        convert_values(static_cast<const uint16_t*>(src), n, res.data());
+    }
+    else
+        throw std::invalid_argument("unhandled array data type '" + std::string(py::str(array.dtype())) + "' in converted_values()");
+    
+    return res;
+}
+
+// float16 arrays widened to a float32 array of the same shape and memory
+// order, for native code that only handles the C++ arithmetic types. 
+// Other arrays are returned as is.
+static py::array
+float16_widened(const py::array& array)
+{
+    if (!is_float16_array(array))
+        return array;
+    
+    py::array values = contiguous_array(array);
+    py::array_t<float> res = py::module::import("numpy").attr("empty_like")(values, "float32");
+    const float16_t *src = static_cast<const float16_t*>(values.data());
+    float *dst = res.mutable_data();
+    const size_t n = values.size();
+    
+    {
+        py::gil_scoped_release release;
+        convert_values(src, n, dst);
+    }
+    
+    return res;
+}
+
 ospray::cpp::CopiedData
 copied_data_from_numpy_array(const py::array& array)
 {
@@ -194,10 +316,10 @@ copied_data_from_numpy_array(const py::array& array)
         return ospray::cpp::CopiedData(array.data(), OSP_CHAR, num_items, byte_stride);
     else if (py::isinstance<py::array_t<uint8_t>>(array))
         return ospray::cpp::CopiedData(array.data(), OSP_UCHAR, num_items, byte_stride);
-    /*else if (py::isinstance<py::array_t<int16_t>>(array))
-        return ospray::cpp::CopiedData(array.data(), ???, num_items, byte_stride);
+    else if (py::isinstance<py::array_t<int16_t>>(array))
+        return ospray::cpp::CopiedData(array.data(), OSP_SHORT, num_items, byte_stride);
     else if (py::isinstance<py::array_t<uint16_t>>(array))
-        return ospray::cpp::CopiedData(array.data(), ???, num_items, byte_stride);*/
+        return ospray::cpp::CopiedData(array.data(), OSP_USHORT, num_items, byte_stride);
     else if (py::isinstance<py::array_t<int32_t>>(array))
         return ospray::cpp::CopiedData(array.data(), OSP_INT, num_items, byte_stride);
     else if (py::isinstance<py::array_t<uint32_t>>(array))
@@ -206,6 +328,12 @@ copied_data_from_numpy_array(const py::array& array)
         return ospray::cpp::CopiedData(array.data(), OSP_LONG, num_items, byte_stride);
     else if (py::isinstance<py::array_t<uint64_t>>(array))
         return ospray::cpp::CopiedData(array.data(), OSP_ULONG, num_items, byte_stride);
+    else if (is_float16_array(array))
+    {
+        // No half-float type in OSPRay, convert to float
+        std::vector<float> values = converted_values<float>(array);
+        return ospray::cpp::CopiedData(values.data(), OSP_FLOAT, num_items, byte_stride);
+    }
         
     printf("WARNING: unhandled array in copied_data_from_numpy_array(): ");
     print_array_info(array);
@@ -251,10 +379,10 @@ shared_data_from_numpy_array(const py::array& array)
         return ospray::cpp::SharedData(array.data(), OSP_CHAR, num_items, byte_stride);
     else if (py::isinstance<py::array_t<uint8_t>>(array))
         return ospray::cpp::SharedData(array.data(), OSP_UCHAR, num_items, byte_stride);
-    /*else if (py::isinstance<py::array_t<int16_t>>(array))
-        return ospray::cpp::SharedData(array.data(), ???, num_items, byte_stride);
+    else if (py::isinstance<py::array_t<int16_t>>(array))
+        return ospray::cpp::SharedData(array.data(), OSP_SHORT, num_items, byte_stride);
     else if (py::isinstance<py::array_t<uint16_t>>(array))
-        return ospray::cpp::SharedData(array.data(), ???, num_items, byte_stride);*/
+        return ospray::cpp::SharedData(array.data(), OSP_USHORT, num_items, byte_stride);
     else if (py::isinstance<py::array_t<int32_t>>(array))
         return ospray::cpp::SharedData(array.data(), OSP_INT, num_items, byte_stride);
     else if (py::isinstance<py::array_t<uint32_t>>(array))
@@ -263,6 +391,11 @@ shared_data_from_numpy_array(const py::array& array)
         return ospray::cpp::SharedData(array.data(), OSP_LONG, num_items, byte_stride);
     else if (py::isinstance<py::array_t<uint64_t>>(array))
         return ospray::cpp::SharedData(array.data(), OSP_ULONG, num_items, byte_stride);
+    else if (is_float16_array(array))
+    {
+        printf("ERROR: float16 values can't be shared, as OSPRay has no half-float type, use copied_data_constructor() instead\n");
+        return ospray::cpp::SharedData();
+    }
         
     printf("WARNING: unhandled array in shared_data_from_numpy_array(): ");
     print_array_info(array);
@@ -319,6 +452,26 @@ copied_data_from_numpy_array_vec(const py::array& array)
             num_items.z = array.shape(2);
     }
 
+    // OSPRay has no vector types for 16-bit values, so widen those
+    if (py::isinstance<py::array_t<int16_t>>(array))
+    {
+        const OSPDataType types[] = { OSP_VEC2I, OSP_VEC3I, OSP_VEC4I };
+        std::vector<int32_t> values = converted_values<int32_t>(array);
+        return ospray::cpp::CopiedData(values.data(), types[vecdim-2], num_items, byte_stride);
+    }
+    else if (py::isinstance<py::array_t<uint16_t>>(array))
+    {
+        const OSPDataType types[] = { OSP_VEC2UI, OSP_VEC3UI, OSP_VEC4UI };
+        std::vector<uint32_t> values = converted_values<uint32_t>(array);
+        return ospray::cpp::CopiedData(values.data(), types[vecdim-2], num_items, byte_stride);
+    }
+    else if (is_float16_array(array))
+    {
+        const OSPDataType types[] = { OSP_VEC2F, OSP_VEC3F, OSP_VEC4F };
+        std::vector<float> values = converted_values<float>(array);
+        return ospray::cpp::CopiedData(values.data(), types[vecdim-2], num_items, byte_stride);
+    }
+
     if (vecdim == 2)
     {
         if (py::isinstance<py::array_t<float>>(array))
@@ -417,6 +570,14 @@ shared_data_from_numpy_array_vec(const py::array& array)
     if (ndim > 3)
         num_items.z = array.shape(2);
 
+    if (py::isinstance<py::array_t<int16_t>>(array) || py::isinstance<py::array_t<uint16_t>>(array) || is_float16_array(array))
+    {
+        printf("ERROR: 16-bit vector values can't be shared, as OSPRay has no corresponding types, use copied_data_constructor_vec() instead: ");
+        print_array_info(array);
+        printf("\n");
+        return ospray::cpp::SharedData();
+    }
+
     if (vecdim == 2)
     {
         if (py::isinstance<py::array_t<float>>(array))
@@ -531,109 +692,3375 @@ copied_data_from_numpy_array_box(const py::array& array)
     if (ndim > 3)
         num_items.z = array.shape(2);
     
-    if (vecdim == 2)
+    // OSPRay has no box types for 16-bit values, so widen those
+    if (py::isinstance<py::array_t<int16_t>>(array))
+    {
+        const OSPDataType types[] = { OSP_BOX1I, OSP_BOX2I, OSP_BOX3I, OSP_BOX4I };
+        std::vector<int32_t> values = converted_values<int32_t>(array);
+        return ospray::cpp::CopiedData(values.data(), types[vecdim/2-1], num_items, byte_stride);
+    }
+    else if (is_float16_array(array))
+    {
+        const OSPDataType types[] = { OSP_BOX1F, OSP_BOX2F, OSP_BOX3F, OSP_BOX4F };
+        std::vector<float> values = converted_values<float>(array);
+        return ospray::cpp::CopiedData(values.data(), types[vecdim/2-1], num_items, byte_stride);
+    }
+    
+    if (vecdim == 2)
+    {
+        if (py::isinstance<py::array_t<float>>(array))
+            return ospray::cpp::CopiedData(array.data(), OSP_BOX1F, num_items, byte_stride);
+        else if (py::isinstance<py::array_t<int32_t>>(array))
+            return ospray::cpp::CopiedData(array.data(), OSP_BOX1I, num_items, byte_stride);
+    }       
+    else if (vecdim == 4)
+    {
+        if (py::isinstance<py::array_t<float>>(array))
+            return ospray::cpp::CopiedData(array.data(), OSP_BOX2F, num_items, byte_stride);
+        else if (py::isinstance<py::array_t<int32_t>>(array))
+            return ospray::cpp::CopiedData(array.data(), OSP_BOX2I, num_items, byte_stride);
+    }
+    else if (vecdim == 6)
+    {
+        if (py::isinstance<py::array_t<float>>(array))
+            return ospray::cpp::CopiedData(array.data(), OSP_BOX3F, num_items, byte_stride);
+        else if (py::isinstance<py::array_t<int32_t>>(array))
+            return ospray::cpp::CopiedData(array.data(), OSP_BOX3I, num_items, byte_stride);
+    }
+    else
+    {
+        if (py::isinstance<py::array_t<float>>(array))
+            return ospray::cpp::CopiedData(array.data(), OSP_BOX4F, num_items, byte_stride);
+        else if (py::isinstance<py::array_t<int32_t>>(array))
+            return ospray::cpp::CopiedData(array.data(), OSP_BOX4I, num_items, byte_stride);
+    }
+    
+    printf("WARNING: unhandled array in copied_data_from_numpy_array_box(): ");
+    print_array_info(array);
+    printf("\n");
+        
+    return ospray::cpp::CopiedData();
+}
+
+ospray::cpp::SharedData
+shared_data_from_numpy_array_box(const py::array& array)
+{
+    const int ndim = array.ndim();
+    
+    if (ndim > 3)
+    {
+        printf("ERROR: more than 3 dimensions not supported in shared_data_from_numpy_array_box(): ");
+        print_array_info(array);
+        printf("\n");
+        return ospray::cpp::SharedData();
+    }
+    
+    const int vecdim = array.shape(ndim-1);
+    
+    if (vecdim != 2 && vecdim != 4 && vecdim != 6 && vecdim != 8)
+    {
+        printf("ERROR: last dimension needs to be 2,4,6 or 8 in shared_data_from_numpy_array_box(): ");
+        print_array_info(array);
+        printf("\n");
+        return ospray::cpp::SharedData();
+    }
+    
+    const py::dtype& dtype = array.dtype();
+    vec3ul  num_items { 1, 1, 1 };
+    vec3ul  byte_stride { 0, 0, 0 };
+    
+    num_items.x = array.shape(0);
+    if (ndim > 2)
+        num_items.y = array.shape(1);
+    if (ndim > 3)
+        num_items.z = array.shape(2);
+    
+    if (py::isinstance<py::array_t<int16_t>>(array) || is_float16_array(array))
+    {
+        printf("ERROR: 16-bit box values can't be shared, as OSPRay has no corresponding types, use copied_data_constructor_box() instead: ");
+        print_array_info(array);
+        printf("\n");
+        return ospray::cpp::SharedData();
+    }
+    
+    if (vecdim == 2)
+    {
+        if (py::isinstance<py::array_t<float>>(array))
+            return ospray::cpp::SharedData(array.data(), OSP_BOX1F, num_items, byte_stride);
+        else if (py::isinstance<py::array_t<int32_t>>(array))
+            return ospray::cpp::SharedData(array.data(), OSP_BOX1I, num_items, byte_stride);
+    }       
+    else if (vecdim == 4)
+    {
+        if (py::isinstance<py::array_t<float>>(array))
+            return ospray::cpp::SharedData(array.data(), OSP_BOX2F, num_items, byte_stride);
+        else if (py::isinstance<py::array_t<int32_t>>(array))
+            return ospray::cpp::SharedData(array.data(), OSP_BOX2I, num_items, byte_stride);
+    }
+    else if (vecdim == 6)
+    {
+        if (py::isinstance<py::array_t<float>>(array))
+            return ospray::cpp::SharedData(array.data(), OSP_BOX3F, num_items, byte_stride);
+        else if (py::isinstance<py::array_t<int32_t>>(array))
+            return ospray::cpp::SharedData(array.data(), OSP_BOX3I, num_items, byte_stride);
+    }
+    else
+    {
+        if (py::isinstance<py::array_t<float>>(array))
+            return ospray::cpp::SharedData(array.data(), OSP_BOX4F, num_items, byte_stride);
+        else if (py::isinstance<py::array_t<int32_t>>(array))
+            return ospray::cpp::SharedData(array.data(), OSP_BOX4I, num_items, byte_stride);
+    }
+    
+    printf("WARNING: unhandled array in shared_data_from_numpy_array_box(): ");
+    print_array_info(array);
+    printf("\n");
+        
+    return ospray::cpp::SharedData();
+}
+
+// Record array fields
+
+// Element type for n components of the given numpy type, OSP_UNKNOWN if
+// there is no such type
+static OSPDataType
+field_data_type(const py::dtype& base, size_t n)
+{
+    struct FieldType { char kind; ssize_t size; OSPDataType types[4]; };
+    static const FieldType field_types[] = {
+        { 'f', 4, { OSP_FLOAT, OSP_VEC2F, OSP_VEC3F, OSP_VEC4F } },
+        { 'f', 8, { OSP_DOUBLE, OSP_UNKNOWN, OSP_UNKNOWN, OSP_UNKNOWN } },
+        { 'i', 1, { OSP_CHAR, OSP_UNKNOWN, OSP_UNKNOWN, OSP_UNKNOWN } },
+        { 'u', 1, { OSP_UCHAR, OSP_VEC2UC, OSP_VEC3UC, OSP_VEC4UC } },
+        { 'i', 2, { OSP_SHORT, OSP_UNKNOWN, OSP_UNKNOWN, OSP_UNKNOWN } },
+        { 'u', 2, { OSP_USHORT, OSP_UNKNOWN, OSP_UNKNOWN, OSP_UNKNOWN } },
+        { 'i', 4, { OSP_INT, OSP_VEC2I, OSP_VEC3I, OSP_VEC4I } },
+        { 'u', 4, { OSP_UINT, OSP_VEC2UI, OSP_VEC3UI, OSP_VEC4UI } },
+        { 'i', 8, { OSP_LONG, OSP_VEC2L, OSP_VEC3L, OSP_VEC4L } },
+        { 'u', 8, { OSP_ULONG, OSP_VEC2UL, OSP_VEC3UL, OSP_VEC4UL } },
+    };
+    
+    if (n < 1 || n > 4)
+        return OSP_UNKNOWN;
+    
+    for (const FieldType& ft : field_types)
+    {
+        if (ft.kind == base.kind() && ft.size == base.itemsize())
+            return ft.types[n-1];
+    }
+    
+    return OSP_UNKNOWN;
+}
+
+// Location of one or more fields in the records of a structured array
+struct RecordField
+{
+    size_t      offset;
+    OSPDataType type;
+};
+
+// Fields is either the name of a single field (which may be a subarray 
+// field, e.g. ('pos', 'f4', 3)), or a list of names of scalar fields 
+// of the same type that are consecutive in the record, e.g. 
+// ['x', 'y', 'z'].
+static RecordField
+record_field(const py::array& records, const py::object& fields)
+{
+    py::object dtype_fields = records.dtype().attr("fields");
+    
+    if (dtype_fields.is_none())
+        throw std::invalid_argument("expected a structured (record) array");
+    
+    py::dict field_info = dtype_fields.cast<py::dict>();
+    std::vector<std::string> names;
+    
+    if (py::isinstance<py::str>(fields))
+        names.push_back(fields.cast<std::string>());
+    else
+        names = fields.cast<std::vector<std::string>>();
+    
+    if (names.empty())
+        throw std::invalid_argument("need at least one field name");
+    
+    RecordField res;
+    py::dtype base;
+    size_t n = 0;
+    
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        if (!field_info.contains(names[i]))
+            throw std::invalid_argument("no field '" + names[i] + "' in records");
+        
+        py::tuple info = field_info[py::str(names[i])].cast<py::tuple>();
+        py::dtype fdtype = info[0].cast<py::dtype>();
+        const size_t offset = info[1].cast<size_t>();
+        py::object subdtype = fdtype.attr("subdtype");
+        
+        if (!subdtype.is_none())
+        {
+            // Subarray field
+            if (names.size() > 1)
+                throw std::invalid_argument("subarray field '" + names[i] + "' can only be used on its own");
+            
+            py::tuple sub = subdtype.cast<py::tuple>();
+            base = sub[0].cast<py::dtype>();
+            n = 1;
+            for (auto dim : sub[1].cast<py::tuple>())
+                n *= dim.cast<size_t>();
+            res.offset = offset;
+            break;
+        }
+        
+        if (i == 0)
+        {
+            base = fdtype;
+            res.offset = offset;
+        }
+        else if (!fdtype.equal(base) || offset != res.offset + i*base.itemsize())
+            throw std::invalid_argument("fields need to be of the same type and consecutive in the record, field '" + names[i] + "' isn't");
+        
+        n++;
+    }
+    
+    // Fields are shared as is, so need to be in native byte order
+    if (!base.attr("isnative").cast<bool>())
+        throw std::invalid_argument("field type '" + std::string(py::str(base)) + "' is not in native byte order, "
+            "convert the records first, e.g. with records.astype(records.dtype.newbyteorder('='))");
+    
+    res.type = field_data_type(base, n);
+    if (res.type == OSP_UNKNOWN)
+        throw std::invalid_argument("no OSPRay data type for " + std::to_string(n) + " component(s) of type '" + std::string(py::str(base)) + "'");
+    
+    return res;
+}
+
+// Data for a field of a 1D structured array, using the record size
+// as byte stride, so without de-interleaving the records
+template<typename D>
+static D
+data_from_record_field(const py::array& records, const py::object& fields)
+{
+    if (records.ndim() != 1)
+        throw std::invalid_argument("expected a 1-dimensional record array");
+    if (records.strides(0) <= 0)
+        throw std::invalid_argument("record array needs a positive stride");
+    
+    const RecordField field = record_field(records, fields);
+    const char *data = static_cast<const char*>(records.data()) + field.offset;
+    
+    vec3ul num_items { 1, 1, 1 };
+    vec3ul byte_stride { 0, 0, 0 };
+    
+    num_items.x = records.shape(0);
+    byte_stride.x = records.strides(0);
+    
+    return D(data, field.type, num_items, byte_stride);
+}
+
+// Volume statistics
+
+template<typename T>
+static std::function<void()>
+statistics_job_for(const py::array& array, int bins, bool have_range, double lo, double hi, unsigned threads, VolumeStatistics& stats)
+{
+    const T *data = static_cast<const T*>(array.data());
+    const size_t n = array.size();
+    VolumeStatistics *res = &stats;
+    
+    return [=]() { 
+        compute_statistics<T>(data, n, bins, have_range, lo, hi, threads, *res); 
+    };
+}
+
+// Returns a function that computes statistics over all array values, 
+// which can (and should) be called without holding the GIL. The array
+// needs to be contiguous and stay alive until the job has finished.
+static std::function<void()>
+statistics_job(const py::array& array, int bins, const py::object& value_range, unsigned threads, VolumeStatistics& stats)
+{
+    bool have_range = false;
+    double lo = 0.0, hi = 0.0;
+    
+    if (!value_range.is_none())
+    {
+        py::tuple t = value_range.cast<py::tuple>();
+        if (t.size() != 2)
+            throw std::invalid_argument("value_range needs to be a (min, max) tuple");
+        lo = t[0].cast<double>();
+        hi = t[1].cast<double>();
+        have_range = true;
+    }
+
+    if (py::isinstance<py::array_t<float>>(array))
+        return statistics_job_for<float>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<double>>(array))
+        return statistics_job_for<double>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<int8_t>>(array))
+        return statistics_job_for<int8_t>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<uint8_t>>(array))
+        return statistics_job_for<uint8_t>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<int16_t>>(array))
+        return statistics_job_for<int16_t>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<uint16_t>>(array))
+        return statistics_job_for<uint16_t>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<int32_t>>(array))
+        return statistics_job_for<int32_t>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<uint32_t>>(array))
+        return statistics_job_for<uint32_t>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<int64_t>>(array))
+        return statistics_job_for<int64_t>(array, bins, have_range, lo, hi, threads, stats);
+    else if (py::isinstance<py::array_t<uint64_t>>(array))
+        return statistics_job_for<uint64_t>(array, bins, have_range, lo, hi, threads, stats);
+
+    throw std::invalid_argument("unhandled array data type '" + std::string(py::str(array.dtype())) + "' for computing statistics");
+}
+
+static py::dict
+statistics_to_dict(const VolumeStatistics& stats)
+{
+    const size_t bins = stats.histogram.size();
+    py::array_t<uint64_t> histogram(bins, stats.histogram.data());
+    py::array_t<double> bin_edges(bins + 1);
+    double *edges = bin_edges.mutable_data();
+    
+    for (size_t i = 0; i <= bins; i++)
+        edges[i] = stats.hist_min + (stats.hist_max - stats.hist_min) * i / bins;
+    
+    py::dict percentiles;
+    for (size_t i = 0; i < stats.percentiles.size(); i++)
+        percentiles[py::float_(stats.percentiles[i])] = stats.percentile_values[i];
+    
+    py::dict res;
+    res["min"] = stats.min;
+    res["max"] = stats.max;
+    res["mean"] = stats.mean;
+    res["count"] = stats.count;
+    res["nan_count"] = stats.nan_count;
+    res["value_range"] = py::make_tuple(stats.min, stats.max);
+    res["histogram"] = histogram;
+    res["bin_edges"] = bin_edges;
+    res["percentiles"] = percentiles;
+    
+    return res;
+}
+
+static py::dict
+volume_statistics(const py::array& array, int bins, const py::object& value_range, const std::vector<double>& percentiles, unsigned threads)
+{
+    py::array values = float16_widened(contiguous_array(array));
+    VolumeStatistics stats;
+    stats.percentiles = percentiles;
+    
+    std::function<void()> job = statistics_job(values, bins, value_range, threads, stats);
+    
+    {
+        py::gil_scoped_release release;
+        job();
+    }
+    
+    return statistics_to_dict(stats);
+}
+
+// Create a Data array, with statistics computed on separate threads
+// while the data is being copied/shared. Returns (data, statistics).
+// Non-contiguous input is first made contiguous, before the overlap, 
+// float16 values are widened on the statistics thread.
+template<typename D>
+static py::tuple
+data_with_statistics(const py::array& array, D (*constructor)(const py::array&), 
+    int bins, const py::object& value_range, const std::vector<double>& percentiles, unsigned threads)
+{
+    py::array values = contiguous_array(array);
+    std::function<void()> widen;
+    
+    if (is_float16_array(values))
+    {
+        py::array_t<float> widened = py::module::import("numpy").attr("empty_like")(values, "float32");
+        const float16_t *src = static_cast<const float16_t*>(values.data());
+        float *dst = widened.mutable_data();
+        const size_t n = values.size();
+        
+        widen = [src, n, dst]() { convert_values(src, n, dst); };
+        values = widened;
+    }
+    
+    VolumeStatistics stats;
+    stats.percentiles = percentiles;
+    
+    std::function<void()> job = statistics_job(values, bins, value_range, threads, stats);
+    std::exception_ptr error;
+    
+    std::thread worker([&]() {
+        try 
+        { 
+            if (widen)
+                widen();
+            job(); 
+        } 
+        catch (...) { error = std::current_exception(); }
+    });
+    
+    auto join = [&]() {
+        py::gil_scoped_release release;
+        worker.join();
+    };
+    
+    py::object data;
+    
+    try
+    {
+        data = py::cast(constructor(array));
+    }
+    catch (...)
+    {
+        join();
+        throw;
+    }
+    
+    join();
+    
+    if (error)
+        std::rethrow_exception(error);
+    
+    return py::make_tuple(data, statistics_to_dict(stats));
+}
+
+// Volume pyramid
+
+// Voxel type for structured volumes corresponding to the array's
+// data type, or OSP_UNKNOWN if not supported
+static OSPDataType
+voxel_type_from_numpy_array(const py::array& array)
+{
+    if (py::isinstance<py::array_t<float>>(array))
+        return OSP_FLOAT;
+    else if (py::isinstance<py::array_t<double>>(array))
+        return OSP_DOUBLE;
+    else if (py::isinstance<py::array_t<uint8_t>>(array))
+        return OSP_UCHAR;
+    else if (py::isinstance<py::array_t<int16_t>>(array))
+        return OSP_SHORT;
+    else if (py::isinstance<py::array_t<uint16_t>>(array))
+        return OSP_USHORT;
+    
+    return OSP_UNKNOWN;
+}
+
+static size_t
+voxel_size(OSPDataType type)
+{
+    switch (type)
+    {
+      case OSP_UCHAR  : return 1;
+      case OSP_SHORT  : 
+      case OSP_USHORT : return 2;
+      case OSP_FLOAT  : return 4;
+      case OSP_DOUBLE : return 8;
+      default         : break;
+    }
+    
+    throw std::invalid_argument("unhandled voxel type");
+}
+
+static void
+downsample_voxels(OSPDataType type, const void *src, const vec3ul& dims, void *dst, DownsampleMode mode, unsigned threads)
+{
+    switch (type)
+    {
+      case OSP_UCHAR  : downsample_volume((const uint8_t*)src, dims.x, dims.y, dims.z, (uint8_t*)dst, mode, threads); break;
+      case OSP_SHORT  : downsample_volume((const int16_t*)src, dims.x, dims.y, dims.z, (int16_t*)dst, mode, threads); break;
+      case OSP_USHORT : downsample_volume((const uint16_t*)src, dims.x, dims.y, dims.z, (uint16_t*)dst, mode, threads); break;
+      case OSP_FLOAT  : downsample_volume((const float*)src, dims.x, dims.y, dims.z, (float*)dst, mode, threads); break;
+      case OSP_DOUBLE : downsample_volume((const double*)src, dims.x, dims.y, dims.z, (double*)dst, mode, threads); break;
+      default         : throw std::invalid_argument("unhandled voxel type");
+    }
+}
+
+static void
+subsample_voxels(OSPDataType type, const void *src, const vec3ul& dims, int levels, void *dst)
+{
+    switch (type)
+    {
+      case OSP_UCHAR  : subsample_volume((const uint8_t*)src, dims.x, dims.y, dims.z, levels, (uint8_t*)dst); break;
+      case OSP_SHORT  : subsample_volume((const int16_t*)src, dims.x, dims.y, dims.z, levels, (int16_t*)dst); break;
+      case OSP_USHORT : subsample_volume((const uint16_t*)src, dims.x, dims.y, dims.z, levels, (uint16_t*)dst); break;
+      case OSP_FLOAT  : subsample_volume((const float*)src, dims.x, dims.y, dims.z, levels, (float*)dst); break;
+      case OSP_DOUBLE : subsample_volume((const double*)src, dims.x, dims.y, dims.z, levels, (double*)dst); break;
+      default         : throw std::invalid_argument("unhandled voxel type");
+    }
+}
+
+// Dimensions of a 3D array, using the same interpretation as the data 
+// constructors, i.e. shape (x, y, z) with x varying fastest in memory
+static vec3ul
+volume_dimensions(const py::array& array)
+{
+    if (array.ndim() != 3)
+        throw std::invalid_argument("expected a 3-dimensional array");
+    if (!(array.flags() & (py::array::c_style | py::array::f_style)))
+        throw std::invalid_argument("expected a contiguous array");
+        
+    return vec3ul(array.shape(0), array.shape(1), array.shape(2));
+}
+
+// A new (Fortran-ordered, i.e. x fastest) array of the given dimensions
+static py::array
+new_volume_array(const py::dtype& dtype, const vec3ul& dims)
+{
+    const ssize_t itemsize = dtype.itemsize();
+    
+    return py::array(dtype, 
+        { (ssize_t)dims.x, (ssize_t)dims.y, (ssize_t)dims.z },
+        { itemsize, itemsize*(ssize_t)dims.x, itemsize*(ssize_t)(dims.x*dims.y) });
+}
+
+static py::array
+downsample(const py::array& array, const std::string& mode, unsigned threads)
+{
+    const OSPDataType type = voxel_type_from_numpy_array(array);
+    
+    if (type == OSP_UNKNOWN)
+        throw std::invalid_argument("unhandled array data type '" + std::string(py::str(array.dtype())) + "' for downsampling");
+    
+    const vec3ul dims = volume_dimensions(array);
+    const vec3ul out_dims(downsampled_dimension(dims.x), downsampled_dimension(dims.y), downsampled_dimension(dims.z));
+    const DownsampleMode dmode = downsample_mode_from_string(mode);
+    
+    py::array res = new_volume_array(array.dtype(), out_dims);
+    const void *src = array.data();
+    void *dst = res.mutable_data();
+    
+    {
+        py::gil_scoped_release release;
+        downsample_voxels(type, src, dims, dst, dmode, threads);
+    }
+    
+    return res;
+}
+
+// Multi-resolution pyramid of a structured volume. Level 0 is the source
+// array itself (shared, not copied), each next level is downsampled by a 
+// factor of 2 along each axis. The levels are built on a background
+// thread, coarser levels can be used for rendering as soon as they're ready.
+// Level volumes keep the same extent, i.e. their gridSpacing is adjusted.
+
+class VolumePyramid
+{
+public:
+    
+    VolumePyramid(const py::array& array, int levels, const std::string& mode, 
+        const vec3f& grid_spacing, const vec3f& grid_origin, unsigned threads)
+    :
+        source(array), grid_origin(grid_origin), built(0), stop(false)
+    {
+        type = voxel_type_from_numpy_array(array);
+        if (type == OSP_UNKNOWN)
+            throw std::invalid_argument("unhandled array data type '" + std::string(py::str(array.dtype())) + "' for volume pyramid");
+        
+        DownsampleMode dmode = downsample_mode_from_string(mode);
+        vec3ul dims = volume_dimensions(array);
+        
+        // Automatic number of levels: until the coarsest is at most 64^3
+        if (levels <= 0)
+        {
+            levels = 1;
+            vec3ul d = dims;
+            while (std::max(d.x, std::max(d.y, d.z)) > 64)
+            {
+                d = vec3ul(downsampled_dimension(d.x), downsampled_dimension(d.y), downsampled_dimension(d.z));
+                levels++;
+            }
+        }
+        
+        dimensions.push_back(dims);
+        spacings.push_back(grid_spacing);
+        for (int l = 1; l < levels; l++)
+        {
+            const vec3ul& p = dimensions.back();
+            const vec3ul d(downsampled_dimension(p.x), downsampled_dimension(p.y), downsampled_dimension(p.z));
+            
+            // Keep the same extent as level 0
+            vec3f s;
+            s.x = d.x > 1 ? grid_spacing.x * (dims.x - 1) / (d.x - 1) : grid_spacing.x * dims.x;
+            s.y = d.y > 1 ? grid_spacing.y * (dims.y - 1) / (d.y - 1) : grid_spacing.y * dims.y;
+            s.z = d.z > 1 ? grid_spacing.z * (dims.z - 1) / (d.z - 1) : grid_spacing.z * dims.z;
+            
+            dimensions.push_back(d);
+            spacings.push_back(s);
+        }
+        
+        const size_t vsize = voxel_size(type);
+        buffers.resize(levels);
+        for (int l = 1; l < levels; l++)
+            buffers[l].resize(dimensions[l].x * dimensions[l].y * dimensions[l].z * vsize);
+        volumes.resize(levels);
+        
+        const void *src = array.data();
+        
+        // Levels are built from fine to coarse, so the coarsest level is 
+        // the last one to become available. Point-sampling it directly
+        // from the source is cheap, and gives a preview to start with.
+        if (levels > 1)
+        {
+            const vec3ul& d = dimensions.back();
+            preview_buffer.resize(d.x * d.y * d.z * vsize);
+            subsample_voxels(type, src, dims, levels-1, preview_buffer.data());
+        }
+        
+        builder = std::thread([this, src, dmode, threads]() {
+            try
+            {
+                for (size_t l = 1; l < buffers.size(); l++)
+                {
+                    if (stop)
+                        break;
+                        
+                    const void *prev = l == 1 ? src : buffers[l-1].data();
+                    downsample_voxels(type, prev, dimensions[l-1], buffers[l].data(), dmode, threads);
+                    
+                    std::lock_guard<std::mutex> lock(mutex);
+                    built = l;
+                    ready.notify_all();
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+                ready.notify_all();
+            }
+        });
+    }
+    
+    ~VolumePyramid()
+    {
+        stop = true;
+        if (builder.joinable())
+            builder.join();
+    }
+    
+    int
+    num_levels() const
+    {
+        return dimensions.size();
+    }
+    
+    bool
+    is_ready(int level)
+    {
+        check_level(level);
+        std::lock_guard<std::mutex> lock(mutex);
+        return level <= built;
+    }
+    
+    void
+    wait(int level)
+    {
+        check_level(level);
+        
+        py::gil_scoped_release release;
+        std::unique_lock<std::mutex> lock(mutex);
+        
+        ready.wait(lock, [this, level]() { return level <= built || error; });
+        
+        if (error && level > built)
+            std::rethrow_exception(error);
+    }
+    
+    py::tuple
+    get_dimensions(int level) const
+    {
+        check_level(level);
+        const vec3ul& d = dimensions[level];
+        return py::make_tuple(d.x, d.y, d.z);
+    }
+    
+    py::tuple
+    get_grid_spacing(int level) const
+    {
+        check_level(level);
+        const vec3f& s = spacings[level];
+        return py::make_tuple(s.x, s.y, s.z);
+    }
+    
+    // Committed structuredRegular volume for the given level, waits for
+    // the level to become ready
+    ospray::cpp::Volume
+    volume(int level)
+    {
+        wait(level);
+        
+        if (volumes[level].handle() == nullptr)
+        {
+            const void *data = level == 0 ? source.data() : (const void*)buffers[level].data();
+            volumes[level] = new_volume(data, level);
+        }
+        
+        return volumes[level];
+    }
+    
+    // Point-sampled version of the coarsest level, available immediately
+    ospray::cpp::Volume
+    preview()
+    {
+        if (num_levels() == 1)
+            return volume(0);
+        
+        if (preview_volume.handle() == nullptr)
+            preview_volume = new_volume(preview_buffer.data(), num_levels()-1);
+        
+        return preview_volume;
+    }
+    
+    // Progressive rendering, from coarse levels up to level 0. For each
+    // level the volume of the volumetric model is swapped, after which
+    // the objects in commit (e.g. the group and instance containing the
+    // volumetric model) plus the world are recommitted and accumulation 
+    // is reset. Renders frames_per_level frames for each level, plus 
+    // final_frames at full resolution. If callback is given it is called
+    // after each frame as callback(level, frame), returning False stops 
+    // rendering.
+    // This never waits for the builder: when the coarsest level isn't 
+    // built yet rendering starts with its preview, after which each step
+    // uses the coarsest built level that's finer than the previous one 
+    // (level 0 is always available). Levels still being built get skipped.
+    void
+    render_progressive(ospray::cpp::FrameBuffer& framebuffer, ospray::cpp::Renderer& renderer, 
+        ospray::cpp::Camera& camera, ospray::cpp::World& world, ospray::cpp::VolumetricModel& vmodel, 
+        const py::list& commit, int frames_per_level, int final_frames, const py::object& callback)
+    {
+        int frame = 0;
+        int previous = num_levels();
+        bool use_preview = !is_ready(num_levels()-1);
+        
+        while (previous > 0)
+        {
+            int level;
+            ospray::cpp::Volume vol;
+            
+            if (use_preview)
+            {
+                level = num_levels()-1;
+                vol = preview();
+                use_preview = false;
+            }
+            else
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    level = std::min(previous-1, built);
+                }
+                vol = volume(level);
+            }
+            previous = level;
+            
+            vmodel.setParam("volume", vol);
+            vmodel.commit();
+            for (size_t i = 0; i < commit.size(); i++)
+                commit[i].attr("commit")();
+            world.commit();
+            framebuffer.resetAccumulation();
+            
+            const int frames = level > 0 ? frames_per_level : final_frames;
+            
+            for (int f = 0; f < frames; f++)
+            {
+                ospray::cpp::Future future = framebuffer.renderFrame(renderer, camera, world);
+                {
+                    py::gil_scoped_release release;
+                    future.wait();
+                }
+                
+                if (!callback.is_none())
+                {
+                    py::object res = callback(level, frame);
+                    if (!res.is_none() && !res.cast<bool>())
+                        return;
+                }
+                
+                frame++;
+            }
+        }
+    }
+    
+protected:
+    
+    void
+    check_level(int level) const
+    {
+        if (level < 0 || level >= (int)dimensions.size())
+            throw std::out_of_range("invalid pyramid level " + std::to_string(level));
+    }
+    
+    ospray::cpp::Volume
+    new_volume(const void *data, int level)
+    {
+        vec3ul byte_stride { 0, 0, 0 };
+        
+        ospray::cpp::Volume vol("structuredRegular");
+        vol.setParam("data", ospray::cpp::SharedData(data, type, dimensions[level], byte_stride));
+        vol.setParam("gridOrigin", grid_origin);
+        vol.setParam("gridSpacing", spacings[level]);
+        vol.commit();
+        
+        return vol;
+    }
+    
+    py::array                           source;
+    OSPDataType                         type;
+    vec3f                               grid_origin;
+    
+    std::vector<vec3ul>                 dimensions;
+    std::vector<vec3f>                  spacings;
+    std::vector<std::vector<char>>      buffers;        // Level 0 is unused
+    std::vector<ospray::cpp::Volume>    volumes;
+    std::vector<char>                   preview_buffer; // Of the coarsest level
+    ospray::cpp::Volume                 preview_volume;
+    
+    std::thread                         builder;
+    std::mutex                          mutex;
+    std::condition_variable             ready;
+    int                                 built;          // Levels [0, built] are available
+    std::atomic<bool>                   stop;
+    std::exception_ptr                  error;
+};
+
+// Quantization
+
+template<typename T, typename Q>
+static void
+quantize_array_as(const py::array& array, py::array& res, bool have_range, unsigned threads, QuantizationInfo& info)
+{
+    const T *src = static_cast<const T*>(array.data());
+    Q *dst = static_cast<Q*>(res.mutable_data());
+    const size_t n = array.size();
+    
+    py::gil_scoped_release release;
+    
+    if (!have_range)
+        compute_value_range(src, n, threads, info.lo, info.hi);
+    
+    quantize_values(src, n, dst, threads, info);
+}
+
+template<typename T>
+static void
+quantize_array_from(const py::array& array, py::array& res, int bits, bool have_range, unsigned threads, QuantizationInfo& info)
+{
+    if (bits == 8)
+        quantize_array_as<T, uint8_t>(array, res, have_range, threads, info);
+    else
+        quantize_array_as<T, uint16_t>(array, res, have_range, threads, info);
+}
+
+// Quantize an array to 8 or 16 bit unsigned integers, using either the
+// given value range or the range of the array values. Returns a new array
+// of the same shape and memory order, plus quantization info.
+static py::tuple
+quantize(const py::array& array, int bits, const py::object& value_range, unsigned threads)
+{
+    if (bits != 8 && bits != 16)
+        throw std::invalid_argument("can only quantize to 8 or 16 bits");
+    
+    py::array values = float16_widened(contiguous_array(array));
+    QuantizationInfo info;
+    bool have_range = false;
+    
+    if (!value_range.is_none())
+    {
+        py::tuple t = value_range.cast<py::tuple>();
+        if (t.size() != 2)
+            throw std::invalid_argument("value_range needs to be a (min, max) tuple");
+        info.lo = t[0].cast<double>();
+        info.hi = t[1].cast<double>();
+        have_range = true;
+    }
+    
+    // Keeps C or Fortran order of the input
+    py::array res = py::module::import("numpy").attr("empty_like")(values, bits == 8 ? "uint8" : "uint16");
+    
+    if (py::isinstance<py::array_t<float>>(values))
+        quantize_array_from<float>(values, res, bits, have_range, threads, info);
+    else if (py::isinstance<py::array_t<double>>(values))
+        quantize_array_from<double>(values, res, bits, have_range, threads, info);
+    else if (py::isinstance<py::array_t<int32_t>>(values))
+        quantize_array_from<int32_t>(values, res, bits, have_range, threads, info);
+    else if (py::isinstance<py::array_t<uint32_t>>(values))
+        quantize_array_from<uint32_t>(values, res, bits, have_range, threads, info);
+    else if (py::isinstance<py::array_t<int16_t>>(values))
+        quantize_array_from<int16_t>(values, res, bits, have_range, threads, info);
+    else if (py::isinstance<py::array_t<uint16_t>>(values))
+        quantize_array_from<uint16_t>(values, res, bits, have_range, threads, info);
+    else
+        throw std::invalid_argument("unhandled array data type '" + std::string(py::str(array.dtype())) + "' for quantization");
+    
+    return py::make_tuple(res, info);
+}
+
+static py::tuple
+copied_data_from_numpy_array_quantized(const py::array& array, int bits, const py::object& value_range, unsigned threads)
+{
+    if (array.ndim() > 3)
+        throw std::invalid_argument("more than 3 dimensions not supported in copied_data_from_numpy_array_quantized()");
+    
+    py::tuple q = quantize(array, bits, value_range, threads);
+    py::array values = q[0].cast<py::array>();
+    
+    vec3ul num_items { 1, 1, 1 };
+    vec3ul byte_stride { 0, 0, 0 };
+
+    num_items.x = values.shape(0);
+    if (values.ndim() >= 2)
+        num_items.y = values.shape(1);
+    if (values.ndim() >= 3)
+        num_items.z = values.shape(2);
+    
+    ospray::cpp::CopiedData data(values.data(), bits == 8 ? OSP_UCHAR : OSP_USHORT, num_items, byte_stride);
+    
+    return py::make_tuple(data, q[1]);
+}
+
+// Volume ingest
+
+template<typename S>
+static std::function<void(void*)>
+ingest_converter_for(const py::array& array, const ptrdiff_t strides[3], const size_t dims[3], OSPDataType type, unsigned threads)
+{
+    const void *src = array.data();
+    const ptrdiff_t s[3] = { strides[0], strides[1], strides[2] };
+    const size_t d[3] = { dims[0], dims[1], dims[2] };
+    
+    return [=](void *dst) {
+        switch (type)
+        {
+          case OSP_UCHAR  : permute_values<S>(src, s, d, (uint8_t*)dst, threads); break;
+          case OSP_SHORT  : permute_values<S>(src, s, d, (int16_t*)dst, threads); break;
+          case OSP_USHORT : permute_values<S>(src, s, d, (uint16_t*)dst, threads); break;
+          case OSP_FLOAT  : permute_values<S>(src, s, d, (float*)dst, threads); break;
+          case OSP_DOUBLE : permute_values<S>(src, s, d, (double*)dst, threads); break;
+          default         : throw std::invalid_argument("unhandled voxel type");
+        }
+    };
+}
+
+// Returns a function that permutes and converts the array values into a
+// destination buffer of voxel type type, which can (and should) be called
+// without holding the GIL. The array needs to stay alive until then.
+static std::function<void(void*)>
+ingest_converter(const py::array& array, const ptrdiff_t strides[3], const size_t dims[3], OSPDataType type, unsigned threads)
+{
+    if (py::isinstance<py::array_t<float>>(array))
+        return ingest_converter_for<float>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<double>>(array))
+        return ingest_converter_for<double>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<int8_t>>(array))
+        return ingest_converter_for<int8_t>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<uint8_t>>(array))
+        return ingest_converter_for<uint8_t>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<int16_t>>(array))
+        return ingest_converter_for<int16_t>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<uint16_t>>(array))
+        return ingest_converter_for<uint16_t>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<int32_t>>(array))
+        return ingest_converter_for<int32_t>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<uint32_t>>(array))
+        return ingest_converter_for<uint32_t>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<int64_t>>(array))
+        return ingest_converter_for<int64_t>(array, strides, dims, type, threads);
+    else if (py::isinstance<py::array_t<uint64_t>>(array))
+        return ingest_converter_for<uint64_t>(array, strides, dims, type, threads);
+    else if (is_float16_array(array))
+        return ingest_converter_for<float16_t>(array, strides, dims, type, threads);
+    
+    throw std::invalid_argument("unhandled array data type '" + std::string(py::str(array.dtype())) + "' for volume ingest");
+}
+
+// Returns a function that permutes and converts the array values into res,
+// which can (and should) be called without holding the GIL
+static std::function<void()>
+ingest_job(const py::array& array, const ptrdiff_t strides[3], const size_t dims[3], py::array& res, unsigned threads)
+{
+    std::function<void(void*)> convert = ingest_converter(array, strides, dims, voxel_type_from_numpy_array(res), threads);
+    void *dst = res.mutable_data();
+    
+    return [=]() { convert(dst); };
+}
+
+// Turn a 3D array of any memory layout into a new Fortran-ordered array 
+// (i.e. x fastest, as expected by the data constructors), permuting the 
+// axes like numpy.transpose(array, axes) and converting values to dtype 
+// in the same pass. By default the data type is kept if it's a voxel 
+// type supported by OSPRay other than float64, otherwise values are 
+// converted to float32.
+static py::array
+ingest_volume(const py::array& array, const std::vector<int>& axes, const py::object& dtype, unsigned threads)
+{
+    if (array.ndim() != 3)
+        throw std::invalid_argument("expected a 3-dimensional array");
+    if (axes.size() != 3)
+        throw std::invalid_argument("axes needs to be a permutation of (0, 1, 2)");
+    
+    bool used[3] = { false, false, false };
+    for (int a : axes)
+    {
+        if (a < 0 || a > 2 || used[a])
+            throw std::invalid_argument("axes needs to be a permutation of (0, 1, 2)");
+        used[a] = true;
+    }
+    
+    ptrdiff_t strides[3];
+    size_t dims[3];
+    
+    for (int d = 0; d < 3; d++)
+    {
+        dims[d] = array.shape(axes[d]);
+        strides[d] = array.strides(axes[d]);
+    }
+    
+    py::dtype out_dtype = py::dtype::of<float>();
+    
+    if (!dtype.is_none())
+        out_dtype = py::dtype::from_args(dtype);
+    else
+    {
+        const OSPDataType type = voxel_type_from_numpy_array(array);
+        if (type != OSP_UNKNOWN && type != OSP_DOUBLE)
+            out_dtype = array.dtype();
+    }
+    
+    py::array res = new_volume_array(out_dtype, vec3ul(dims[0], dims[1], dims[2]));
+    
+    if (voxel_type_from_numpy_array(res) == OSP_UNKNOWN)
+        throw std::invalid_argument("unhandled voxel data type '" + std::string(py::str(out_dtype)) + "' for volume ingest");
+    
+    std::function<void()> job = ingest_job(array, strides, dims, res, threads);
+    
+    {
+        py::gil_scoped_release release;
+        job();
+    }
+    
+    return res;
+}
+
+#ifdef HAVE_HDF5
+
+// HDF5 volume reading
+
+static void
+h5volume_selection_arg(const py::object& value, size_t res[3], const char *name)
+{
+    if (value.is_none())
+        return;
+    
+    py::tuple t = value.cast<py::tuple>();
+    if (t.size() != 3)
+        throw std::invalid_argument(std::string(name) + " needs to be an (x, y, z) tuple");
+    
+    for (int i = 0; i < 3; i++)
+        res[i] = t[i].cast<size_t>();
+}
+
+// Read (a region of) a KJI-ordered 3D HDF5 dataset into a new IJK array
+// (Fortran-ordered, i.e. x fastest), which can be shared with OSPRay as is.
+// Selection start/count/stride are given in IJK order. By default uint8, 
+// int16 and uint16 values are kept as is, all others are read as float32.
+static py::array
+read_hdf5_volume(const std::string& filename, const std::string& dataset, const py::object& dtype,
+    const py::object& start, const py::object& count, const py::object& stride)
+{
+    H5VolumeInfo info;
+    H5VolumeSelection sel;
+    size_t dims[3];
+    
+    h5volume_info(filename, dataset, info);
+    
+    h5volume_selection_arg(start, sel.start, "start");
+    h5volume_selection_arg(count, sel.count, "count");
+    h5volume_selection_arg(stride, sel.stride, "stride");
+    h5volume_resolve_selection(info, sel, dims);
+    
+    py::dtype out_dtype = py::dtype::of<float>();
+    
+    if (!dtype.is_none())
+        out_dtype = py::dtype::from_args(dtype);
+    else if (info.type_class == H5T_INTEGER && info.type_size == 1 && !info.type_signed)
+        out_dtype = py::dtype::of<uint8_t>();
+    else if (info.type_class == H5T_INTEGER && info.type_size == 2)
+        out_dtype = info.type_signed ? py::dtype::of<int16_t>() : py::dtype::of<uint16_t>();
+    
+    py::array res = new_volume_array(out_dtype, vec3ul(dims[0], dims[1], dims[2]));
+    hid_t memtype;
+    
+    switch (voxel_type_from_numpy_array(res))
+    {
+      case OSP_UCHAR  : memtype = H5T_NATIVE_UCHAR; break;
+      case OSP_SHORT  : memtype = H5T_NATIVE_SHORT; break;
+      case OSP_USHORT : memtype = H5T_NATIVE_USHORT; break;
+      case OSP_FLOAT  : memtype = H5T_NATIVE_FLOAT; break;
+      case OSP_DOUBLE : memtype = H5T_NATIVE_DOUBLE; break;
+      default         : 
+        throw std::invalid_argument("unhandled voxel data type '" + std::string(py::str(out_dtype)) + "' for reading HDF5 volume");
+    }
+    
+    void *dst = res.mutable_data();
+    
+    {
+        py::gil_scoped_release release;
+        h5volume_read(filename, dataset, sel, memtype, dst);
+    }
+    
+    return res;
+}
+
+#endif
+
+// Time-series volumes
+
+// A structuredRegular volume whose values come from one of a list of
+// time steps. Each step is either an array indexed [x, y, z] (in any
+// memory layout), a raw file (x fastest) or, when a dataset name is given,
+// an HDF5 file. All steps need to have the same dimensions. Steps that are
+// arrays of the volume's data type in Fortran order are shared as is, 
+// all others are read and/or converted on a background thread, ahead of
+// time: after switching to step t the next prefetch steps get loaded
+// while t is rendered. The last cache_size loaded steps are kept.
+class TimeSeriesVolume
+{
+public:
+    
+    TimeSeriesVolume(const py::list& steps, const py::object& dimensions, const py::object& dtype,
+        const std::string& dataset, const vec3f& grid_origin, const vec3f& grid_spacing, 
+        int cache_size, int prefetch, unsigned threads)
+    :
+        dataset(dataset), prefetch_count(prefetch), current_step(-1), volume("structuredRegular")
+    {
+        const size_t n = steps.size();
+        
+        if (n == 0)
+            throw std::invalid_argument("time series needs at least one step");
+        if (prefetch < 0)
+            throw std::invalid_argument("prefetch needs to be >= 0");
+        if (cache_size < prefetch + 1)
+            throw std::invalid_argument("cache_size needs to be at least prefetch + 1");
+            
+#ifndef HAVE_HDF5
+        if (!dataset.empty())
+            throw std::invalid_argument("HDF5 support not available in this build");
+#endif
+        
+        // Dimensions and data type, by default from the first step
+        const py::object first = steps[0];
+        
+        if (!dimensions.is_none())
+        {
+            const std::vector<size_t> d = dimensions.cast<std::vector<size_t>>();
+            if (d.size() != 3)
+                throw std::invalid_argument("dimensions needs to be an (x, y, z) tuple");
+            dims = vec3ul(d[0], d[1], d[2]);
+        }
+        else if (py::isinstance<py::array>(first))
+            dims = volume_shape(first.cast<py::array>());
+#ifdef HAVE_HDF5
+        else if (!dataset.empty())
+        {
+            H5VolumeInfo info;
+            h5volume_info(first.cast<std::string>(), dataset, info);
+            dims = vec3ul(info.dims[0], info.dims[1], info.dims[2]);
+        }
+#endif
+        else
+            throw std::invalid_argument("dimensions need to be given for raw files");
+        
+        if (!dtype.is_none())
+            type = voxel_type_from_dtype(py::dtype::from_args(dtype));
+        else if (py::isinstance<py::array>(first))
+        {
+            type = voxel_type_from_numpy_array(first.cast<py::array>());
+            if (type == OSP_UNKNOWN || type == OSP_DOUBLE)
+                type = OSP_FLOAT;
+        }
+#ifdef HAVE_HDF5
+        else if (!dataset.empty())
+        {
+            H5VolumeInfo info;
+            h5volume_info(first.cast<std::string>(), dataset, info);
+            type = OSP_FLOAT;
+            if (info.type_class == H5T_INTEGER && info.type_size == 1 && !info.type_signed)
+                type = OSP_UCHAR;
+            else if (info.type_class == H5T_INTEGER && info.type_size == 2)
+                type = info.type_signed ? OSP_SHORT : OSP_USHORT;
+        }
+#endif
+        else
+            throw std::invalid_argument("dtype needs to be given for raw files");
+        
+        nbytes = dims.x * dims.y * dims.z * voxel_size(type);
+        
+        // Per step either shared array memory, a converter or a file
+        shared.resize(n, nullptr);
+        converters.resize(n);
+        paths.resize(n);
+        
+        for (size_t t = 0; t < n; t++)
+        {
+            const py::object step = steps[t];
+            
+            if (!py::isinstance<py::array>(step))
+            {
+                paths[t] = step.cast<std::string>();
+                continue;
+            }
+            
+            py::array array = step.cast<py::array>();
+            
+            const vec3ul shape = volume_shape(array);
+            if (shape.x != dims.x || shape.y != dims.y || shape.z != dims.z)
+                throw std::invalid_argument("step " + std::to_string(t) + " has different dimensions than the time series");
+            
+            if (voxel_type_from_numpy_array(array) == type && (array.flags() & py::array::f_style))
+                shared[t] = array.data();
+            else
+            {
+                const ptrdiff_t strides[3] = { array.strides(0), array.strides(1), array.strides(2) };
+                const size_t d[3] = { dims.x, dims.y, dims.z };
+                converters[t] = ingest_converter(array, strides, d, type, threads);
+            }
+            
+            arrays.push_back(array);
+        }
+        
+        volume.setParam("gridOrigin", grid_origin);
+        volume.setParam("gridSpacing", grid_spacing);
+        
+        prefetcher.reset(new StepPrefetcher(n, 
+            [this](size_t t, StepBuffer& buffer) { load(t, buffer); }, cache_size));
+        
+        set_step(0, py::list());
+    }
+    
+    size_t
+    num_steps() const
+    {
+        return shared.size();
+    }
+    
+    int
+    get_step() const
+    {
+        return current_step;
+    }
+    
+    py::tuple
+    get_dimensions() const
+    {
+        return py::make_tuple(dims.x, dims.y, dims.z);
+    }
+    
+    // Shares the current step's memory, which is owned by this object, so
+    // this needs to outlive all objects using the volume
+    ospray::cpp::Volume
+    get_volume() const
+    {
+        return volume;
+    }
+    
+    bool
+    is_ready(int t)
+    {
+        check_step(t);
+        return shared[t] != nullptr || prefetcher->is_ready(t);
+    }
+    
+    std::vector<size_t>
+    cached_steps()
+    {
+        return prefetcher->cached_steps();
+    }
+    
+    py::dict
+    statistics()
+    {
+        const StepStatistics s = prefetcher->statistics();
+        
+        py::dict res;
+        res["hits"] = s.hits;
+        res["misses"] = s.misses;
+        res["loads"] = s.loads;
+        res["load_time"] = s.load_time;
+        res["stall_time"] = s.stall_time;
+        return res;
+    }
+    
+    // Switch the volume to step t, waiting for it to be loaded if needed, 
+    // and commit it. The data param is swapped in a single commit, so 
+    // this should be called between frames. Afterwards the objects in 
+    // commit (e.g. the volumetric model, group, instance and world) get 
+    // recommitted. The next steps (wrapping around at the end, for looped 
+    // playback) are queued for prefetching before the commits.
+    void
+    set_step(int t, const py::list& commit)
+    {
+        check_step(t);
+        
+        const void *data = shared[t];
+        std::shared_ptr<const StepBuffer> buffer;
+        
+        if (data == nullptr)
+        {
+            py::gil_scoped_release release;
+            buffer = prefetcher->get(t);
+            data = buffer->data();
+        }
+        
+        const size_t n = num_steps();
+        for (int i = 1; i <= prefetch_count && (size_t)i < n; i++)
+        {
+            const size_t next = (t + i) % n;
+            if (shared[next] == nullptr)
+                prefetcher->prefetch(next);
+        }
+        
+        vec3ul byte_stride { 0, 0, 0 };
+        volume.setParam("data", ospray::cpp::SharedData(data, type, dims, byte_stride));
+        volume.commit();
+        
+        // The previous step's buffer can only be released after the commit
+        current = buffer;
+        current_step = t;
+        
+        for (size_t i = 0; i < commit.size(); i++)
+            commit[i].attr("commit")();
+    }
+    
+    // Render steps (by default all, in order), frames_per_step frames each,
+    // switching steps like set_step() and recommitting the world. 
+    // Accumulation is reset per step. If callback is given it is called 
+    // after each frame as callback(step, frame), returning False stops 
+    // rendering. As loading happens while frames are rendered the time per
+    // step is bounded by rendering, unless loading a step takes longer.
+    void
+    render_sequence(ospray::cpp::FrameBuffer& framebuffer, ospray::cpp::Renderer& renderer, 
+        ospray::cpp::Camera& camera, ospray::cpp::World& world, const py::list& commit, 
+        const py::object& steps, int frames_per_step, const py::object& callback)
+    {
+        std::vector<int> order;
+        
+        if (steps.is_none())
+        {
+            for (size_t t = 0; t < num_steps(); t++)
+                order.push_back(t);
+        }
+        else
+            order = steps.cast<std::vector<int>>();
+        
+        int frame = 0;
+        
+        for (int t : order)
+        {
+            set_step(t, commit);
+            world.commit();
+            framebuffer.resetAccumulation();
+            
+            for (int f = 0; f < frames_per_step; f++)
+            {
+                ospray::cpp::Future future = framebuffer.renderFrame(renderer, camera, world);
+                {
+                    py::gil_scoped_release release;
+                    future.wait();
+                }
+                
+                if (!callback.is_none())
+                {
+                    py::object res = callback(t, frame);
+                    if (!res.is_none() && !res.cast<bool>())
+                        return;
+                }
+                
+                frame++;
+            }
+        }
+    }
+    
+protected:
+    
+    static vec3ul
+    volume_shape(const py::array& array)
+    {
+        if (array.ndim() != 3)
+            throw std::invalid_argument("expected a 3-dimensional array");
+        return vec3ul(array.shape(0), array.shape(1), array.shape(2));
+    }
+    
+    static OSPDataType
+    voxel_type_from_dtype(const py::dtype& dtype)
+    {
+        const OSPDataType type = voxel_type_from_numpy_array(py::array(dtype, std::vector<ssize_t>{ 0 }));
+        if (type == OSP_UNKNOWN)
+            throw std::invalid_argument("unhandled voxel data type '" + std::string(py::str(dtype)) + "' for time series");
+        return type;
+    }
+    
+    void
+    check_step(int t) const
+    {
+        if (t < 0 || t >= (int)num_steps())
+            throw std::out_of_range("invalid time step " + std::to_string(t));
+    }
+    
+    // Called on the prefetcher's thread, without the GIL
+    void
+    load(size_t t, StepBuffer& buffer)
+    {
+        buffer.resize(nbytes);
+        
+        if (converters[t])
+        {
+            converters[t](buffer.data());
+            return;
+        }
+        
+#ifdef HAVE_HDF5
+        if (!dataset.empty())
+        {
+            H5VolumeInfo info;
+            h5volume_info(paths[t], dataset, info);
+            if (info.dims[0] != dims.x || info.dims[1] != dims.y || info.dims[2] != dims.z)
+                throw std::runtime_error(paths[t] + ": dataset has different dimensions than the time series");
+            
+            hid_t memtype;
+            switch (type)
+            {
+              case OSP_UCHAR  : memtype = H5T_NATIVE_UCHAR; break;
+              case OSP_SHORT  : memtype = H5T_NATIVE_SHORT; break;
+              case OSP_USHORT : memtype = H5T_NATIVE_USHORT; break;
+              case OSP_FLOAT  : memtype = H5T_NATIVE_FLOAT; break;
+              default         : memtype = H5T_NATIVE_DOUBLE; break;
+            }
+            
+            h5volume_read(paths[t], dataset, H5VolumeSelection(), memtype, buffer.data());
+            return;
+        }
+#endif
+        
+        read_raw_file(paths[t], nbytes, buffer.data());
+    }
+    
+    std::string                                 dataset;
+    int                                         prefetch_count;
+    vec3ul                                      dims;
+    OSPDataType                                 type;
+    size_t                                      nbytes;
+    
+    std::vector<py::array>                      arrays;         // Keeps array steps alive
+    std::vector<const void*>                    shared;
+    std::vector<std::function<void(void*)>>     converters;
+    std::vector<std::string>                    paths;
+    
+    int                                         current_step;
+    std::shared_ptr<const StepBuffer>           current;
+    ospray::cpp::Volume                         volume;
+    
+    // Declared last, so its thread is stopped before the above are destroyed
+    std::unique_ptr<StepPrefetcher>             prefetcher;
+};
+
+// Sparse volumes
+
+template<typename T>
+static std::function<void()>
+vdb_job_for(const py::array& array, const vec3ul& dims, const BrickCulling& culling, unsigned threads, VDBLeaves& leaves)
+{
+    const T *src = static_cast<const T*>(array.data());
+    VDBLeaves *res = &leaves;
+    
+    return [=]() {
+        dense_to_vdb_leaves(src, dims.x, dims.y, dims.z, culling, threads, *res);
+    };
+}
+
+// Convert a dense volume array (x fastest) into a committed 'vdb' volume,
+// keeping only the 8^3 bricks that contain visible values. Visibility is 
+// based on either a value threshold or, when opacities are given, on 
+// the transfer function opacity LUT over value_range. Values are stored 
+// as float, as that's what OSPRay's vdb volume expects. 
+// Returns (volume, info), with info holding the brick counts and sizes.
+static py::tuple
+vdb_volume_from_dense(const py::array& array, const py::object& threshold, 
+    const py::object& opacities, const py::object& value_range, float opacity_threshold, 
+    const vec3f& spacing, const vec3f& origin, unsigned threads)
+{
+    const vec3ul dims = volume_dimensions(array);
+    BrickCulling culling;
+    py::array_t<float, py::array::c_style | py::array::forcecast> opacity_lut;
+    
+    if (!opacities.is_none())
+    {
+        if (value_range.is_none())
+            throw std::invalid_argument("value_range needs to be given when culling with opacities");
+        
+        py::tuple t = value_range.cast<py::tuple>();
+        if (t.size() != 2)
+            throw std::invalid_argument("value_range needs to be a (min, max) tuple");
+        
+        opacity_lut = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(opacities);
+        if (!opacity_lut || opacity_lut.size() == 0)
+            throw std::invalid_argument("opacities needs to be a non-empty array");
+        
+        culling.mode = BrickCulling::OPACITY;
+        culling.opacities = opacity_lut.data();
+        culling.num_opacities = opacity_lut.size();
+        culling.lo = t[0].cast<float>();
+        culling.hi = t[1].cast<float>();
+        culling.threshold = opacity_threshold;
+    }
+    else if (!threshold.is_none())
+    {
+        culling.mode = BrickCulling::VALUE;
+        culling.threshold = threshold.cast<float>();
+    }
+    
+    VDBLeaves leaves;
+    std::function<void()> job;
+    
+    if (py::isinstance<py::array_t<float>>(array))
+        job = vdb_job_for<float>(array, dims, culling, threads, leaves);
+    else if (py::isinstance<py::array_t<double>>(array))
+        job = vdb_job_for<double>(array, dims, culling, threads, leaves);
+    else if (py::isinstance<py::array_t<uint8_t>>(array))
+        job = vdb_job_for<uint8_t>(array, dims, culling, threads, leaves);
+    else if (py::isinstance<py::array_t<int16_t>>(array))
+        job = vdb_job_for<int16_t>(array, dims, culling, threads, leaves);
+    else if (py::isinstance<py::array_t<uint16_t>>(array))
+        job = vdb_job_for<uint16_t>(array, dims, culling, threads, leaves);
+    else if (is_float16_array(array))
+        job = vdb_job_for<float16_t>(array, dims, culling, threads, leaves);
+    else
+        throw std::invalid_argument("unhandled array data type '" + std::string(py::str(array.dtype())) + "' for vdb conversion");
+    
+    {
+        py::gil_scoped_release release;
+        job();
+    }
+    
+    const size_t n = leaves.size();
+    
+    if (n == 0)
+        throw std::runtime_error("no visible bricks in volume, nothing to convert");
+    
+    // Each node needs its own data array
+    std::vector<ospray::cpp::CopiedData> node_data;
+    std::vector<OSPData> node_handles(n);
+    
+    node_data.reserve(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const size_t count = leaves.formats[i] == VDB_FORMAT_TILE ? 1 : VDB_LEAF_VOXELS;
+        node_data.push_back(ospray::cpp::CopiedData(leaves.values.data() + leaves.offsets[i], OSP_FLOAT, vec3ul(count, 1, 1), vec3ul(0, 0, 0)));
+        node_handles[i] = node_data.back().handle();
+    }
+    
+    const float xform[12] = {
+        spacing.x, 0.0f, 0.0f,
+        0.0f, spacing.y, 0.0f,
+        0.0f, 0.0f, spacing.z,
+        origin.x, origin.y, origin.z
+    };
+    
+    ospray::cpp::Volume volume("vdb");
+    volume.setParam("node.level", ospray::cpp::CopiedData(leaves.levels.data(), OSP_UINT, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("node.origin", ospray::cpp::CopiedData(leaves.origins.data(), OSP_VEC3I, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("node.format", ospray::cpp::CopiedData(leaves.formats.data(), OSP_UINT, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("node.data", ospray::cpp::CopiedData(node_handles.data(), OSP_DATA, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("indexToObject", OSP_AFFINE3F, xform);
+    volume.commit();
+    
+    // Sizes of the kept values at the voxel size of the input, so the 
+    // ratio reflects the dropped bricks, plus as stored (i.e. as float)
+    const size_t node_bytes = n*(sizeof(uint32_t) + 3*sizeof(int32_t) + sizeof(uint32_t));
+    const size_t dense_bytes = array.nbytes();
+    const size_t sparse_bytes = leaves.values.size()*array.itemsize() + node_bytes;
+    const size_t stored_bytes = leaves.values.size()*sizeof(float) + node_bytes;
+    
+    py::dict info;
+    info["bricks"] = leaves.num_bricks;
+    info["dense_leaves"] = leaves.num_dense;
+    info["tiles"] = leaves.num_tiles;
+    info["dropped"] = leaves.num_bricks - n;
+    info["dense_bytes"] = dense_bytes;
+    info["sparse_bytes"] = sparse_bytes;
+    info["stored_bytes"] = stored_bytes;
+    info["compression_ratio"] = (double)dense_bytes / sparse_bytes;
+    
+    return py::make_tuple(volume, info);
+}
+
+// Unstructured volumes
+
+// Pack an integer array into dst (of n values), checking all values are
+// in [0, bound)
+template<typename O>
+static void
+unstructured_indices(const py::array& array, size_t n, uint64_t bound, O *dst, const char *name, unsigned threads)
+{
+    const void *src = array.data();
+    
+    if (py::isinstance<py::array_t<int32_t>>(array))
+    {
+        py::gil_scoped_release release;
+        pack_indices(static_cast<const int32_t*>(src), n, bound, dst, name, threads);
+    }
+    else if (py::isinstance<py::array_t<int64_t>>(array))
+    {
+        py::gil_scoped_release release;
+        pack_indices(static_cast<const int64_t*>(src), n, bound, dst, name, threads);
+    }
+    else if (py::isinstance<py::array_t<uint32_t>>(array))
+    {
+        py::gil_scoped_release release;
+        pack_indices(static_cast<const uint32_t*>(src), n, bound, dst, name, threads);
+    }
+    else if (py::isinstance<py::array_t<uint64_t>>(array))
+    {
+        py::gil_scoped_release release;
+        pack_indices(static_cast<const uint64_t*>(src), n, bound, dst, name, threads);
+    }
+    else
+        throw std::invalid_argument(std::string(name) + " needs to be an integer array, not '" + std::string(py::str(array.dtype())) + "'");
+}
+
+static void
+unstructured_cell_types(const py::array& array, size_t n, uint8_t *dst, unsigned threads)
+{
+    const void *src = array.data();
+    
+    if (py::isinstance<py::array_t<uint8_t>>(array))
+    {
+        py::gil_scoped_release release;
+        pack_cell_types(static_cast<const uint8_t*>(src), n, dst, threads);
+    }
+    else if (py::isinstance<py::array_t<int32_t>>(array))
+    {
+        py::gil_scoped_release release;
+        pack_cell_types(static_cast<const int32_t*>(src), n, dst, threads);
+    }
+    else if (py::isinstance<py::array_t<int64_t>>(array))
+    {
+        py::gil_scoped_release release;
+        pack_cell_types(static_cast<const int64_t*>(src), n, dst, threads);
+    }
+    else
+        throw std::invalid_argument("types needs to be an integer array, not '" + std::string(py::str(array.dtype())) + "'");
+}
+
+// Pack the index, cell.index and cell.type arrays with index type O
+template<typename O>
+static void
+set_unstructured_cells(ospray::cpp::Volume& volume, const py::array& connectivity, const py::array& offsets, 
+    const py::array& types, size_t npoints, size_t ncells, OSPDataType index_type, unsigned threads)
+{
+    const size_t nindices = connectivity.size();
+    std::vector<O> index(nindices);
+    std::vector<O> cell_index(ncells);
+    std::vector<uint8_t> cell_type(ncells);
+    
+    unstructured_indices(connectivity, nindices, npoints, index.data(), "connectivity", threads);
+    unstructured_indices(offsets, ncells, nindices + 1, cell_index.data(), "offsets", threads);
+    unstructured_cell_types(types, ncells, cell_type.data(), threads);
+    
+    {
+        py::gil_scoped_release release;
+        validate_cells(cell_type.data(), cell_index.data(), ncells, nindices, threads);
+    }
+    
+    volume.setParam("index", ospray::cpp::CopiedData(index.data(), index_type, vec3ul(nindices, 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("cell.index", ospray::cpp::CopiedData(cell_index.data(), index_type, vec3ul(ncells, 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("cell.type", ospray::cpp::CopiedData(cell_type.data(), OSP_UCHAR, vec3ul(ncells, 1, 1), vec3ul(0, 0, 0)));
+}
+
+// Set float values (with n items of the given type) on the volume. These
+// are shared when already contiguous float32, otherwise a converted copy is 
+// passed to OSPRay.
+static void
+set_unstructured_values(ospray::cpp::Volume& volume, const std::string& name, const py::array& array, 
+    size_t n, OSPDataType type)
+{
+    if (py::isinstance<py::array_t<float>>(array) && (array.flags() & py::array::c_style))
+    {
+        volume.setParam(name, ospray::cpp::SharedData(array.data(), type, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+        return;
+    }
+    
+    py::array_t<float> values = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(array);
+    if (!values)
+        throw std::invalid_argument(name + " values can not be converted to float32");
+    
+    volume.setParam(name, ospray::cpp::CopiedData(values.data(), type, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+}
+
+// Build a committed 'unstructured' volume from VTK-style arrays: points 
+// (N x 3), connectivity (concatenated cell vertex indices), offsets (start 
+// of each cell in connectivity, optionally with a final entry equal to the
+// connectivity length) and VTK cell types. The narrowest valid index type 
+// is used (uint32 when possible, otherwise uint64). Points and values are 
+// shared when they're contiguous float32 (so need to stay alive as long as 
+// the volume), otherwise converted copies are passed.
+static ospray::cpp::Volume
+unstructured_volume(const py::array& points, const py::array& connectivity, const py::array& offsets, 
+    const py::array& types, const py::object& point_values, const py::object& cell_values, unsigned threads)
+{
+    if (points.ndim() != 2 || points.shape(1) != 3)
+        throw std::invalid_argument("points needs to be an N x 3 array");
+    if (connectivity.ndim() != 1 || offsets.ndim() != 1 || types.ndim() != 1)
+        throw std::invalid_argument("connectivity, offsets and types need to be 1-dimensional arrays");
+    
+    const size_t npoints = points.shape(0);
+    const size_t ncells = types.size();
+    
+    if ((size_t)offsets.size() != ncells && (size_t)offsets.size() != ncells + 1)
+        throw std::invalid_argument("offsets needs one value per cell, optionally followed by the connectivity length");
+    
+    if (!point_values.is_none() && (size_t)point_values.cast<py::array>().size() != npoints)
+        throw std::invalid_argument("point_values needs one value per point");
+    if (!cell_values.is_none() && (size_t)cell_values.cast<py::array>().size() != ncells)
+        throw std::invalid_argument("cell_values needs one value per cell");
+    
+    py::array conn = contiguous_array(connectivity);
+    py::array offs = contiguous_array(offsets);
+    py::array ctypes = contiguous_array(types);
+    
+    ospray::cpp::Volume volume("unstructured");
+    
+    set_unstructured_values(volume, "vertex.position", points, npoints, OSP_VEC3F);
+    
+    if (npoints <= UINT32_MAX && (size_t)conn.size() < UINT32_MAX)
+        set_unstructured_cells<uint32_t>(volume, conn, offs, ctypes, npoints, ncells, OSP_UINT, threads);
+    else
+        set_unstructured_cells<uint64_t>(volume, conn, offs, ctypes, npoints, ncells, OSP_ULONG, threads);
+    
+    if (!point_values.is_none())
+        set_unstructured_values(volume, "vertex.data", point_values.cast<py::array>(), npoints, OSP_FLOAT);
+    if (!cell_values.is_none())
+        set_unstructured_values(volume, "cell.data", cell_values.cast<py::array>(), ncells, OSP_FLOAT);
+    
+    volume.commit();
+    
+    return volume;
+}
+
+// AMR volumes
+
+static OSPAMRMethod
+amr_method_from_string(const std::string& method)
+{
+    if (method == "current")
+        return OSP_AMR_CURRENT;
+    else if (method == "finest")
+        return OSP_AMR_FINEST;
+    else if (method == "octant")
+        return OSP_AMR_OCTANT;
+    
+    throw std::invalid_argument("unknown AMR method '" + method + "', expected 'current', 'finest' or 'octant'");
+}
+
+template<typename T>
+static void
+gather_blocks(const std::vector<py::array>& arrays, const std::vector<size_t>& offsets, float *dst, unsigned threads)
+{
+    std::vector<const T*> srcs(arrays.size());
+    for (size_t i = 0; i < arrays.size(); i++)
+        srcs[i] = static_cast<const T*>(arrays[i].data());
+    
+    py::gil_scoped_release release;
+    gather_values(srcs.data(), offsets.data(), arrays.size(), dst, threads);
+}
+
+// Build a committed 'amr' volume from a list of 3D block arrays (x fastest,
+// like the data constructors), their origins (lower corner, in cell indices
+// of their level) and levels, plus the cell width of each level. Block 
+// bounds are derived from the origins and array shapes. 
+//
+// OSPRay needs a separate float Data array per block. With share=True the
+// block arrays (which then need to be contiguous float32) are shared as 
+// is, and like with the shared data constructors need to stay alive as
+// long as OSPRay uses the volume. Otherwise each block is copied, float32
+// blocks directly and other types after being converted and packed into
+// a single buffer in parallel.
+static py::object
+amr_volume(const py::list& blocks, const py::array& origins, const py::array& levels, 
+    const std::vector<float>& cell_widths, const vec3f& grid_origin, 
+    const vec3f& grid_spacing, const std::string& method, bool share, unsigned threads)
+{
+    const size_t n = blocks.size();
+    
+    if (n == 0)
+        throw std::invalid_argument("need at least one block");
+    
+    py::array_t<int32_t, py::array::c_style | py::array::forcecast> block_origins = 
+        py::array_t<int32_t, py::array::c_style | py::array::forcecast>::ensure(origins);
+    py::array_t<int32_t, py::array::c_style | py::array::forcecast> block_levels = 
+        py::array_t<int32_t, py::array::c_style | py::array::forcecast>::ensure(levels);
+    
+    if (!block_origins || block_origins.ndim() != 2 || (size_t)block_origins.shape(0) != n || block_origins.shape(1) != 3)
+        throw std::invalid_argument("origins needs to be an N x 3 integer array, for N blocks");
+    if (!block_levels || (size_t)block_levels.size() != n)
+        throw std::invalid_argument("levels needs one value per block");
+    
+    const int32_t *org = block_origins.data();
+    const int32_t *lvl = block_levels.data();
+    std::vector<py::array> arrays(n);
+    std::vector<int32_t> bounds(6*n);
+    std::vector<size_t> offsets(n+1);
+    
+    offsets[0] = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        arrays[i] = blocks[i].cast<py::array>();
+        const py::array& a = arrays[i];
+        
+        if (a.ndim() != 3)
+            throw std::invalid_argument("block " + std::to_string(i) + " is not a 3-dimensional array");
+        if (!(a.flags() & (py::array::c_style | py::array::f_style)))
+            throw std::invalid_argument("block " + std::to_string(i) + " is not a contiguous array");
+        if (!a.dtype().equal(arrays[0].dtype()))
+            throw std::invalid_argument("block " + std::to_string(i) + " has a different data type than block 0");
+        if (lvl[i] < 0 || (size_t)lvl[i] >= cell_widths.size())
+            throw std::invalid_argument("block " + std::to_string(i) + " has level " + std::to_string(lvl[i]) + 
+                ", but only " + std::to_string(cell_widths.size()) + " cell widths given");
+        
+        // box3i, with inclusive upper bound
+        for (int d = 0; d < 3; d++)
+        {
+            bounds[6*i+d] = org[3*i+d];
+            bounds[6*i+3+d] = org[3*i+d] + (int32_t)a.shape(d) - 1;
+        }
+        
+        offsets[i+1] = offsets[i] + a.size();
+    }
+    
+    std::vector<ospray::cpp::SharedData> shared;
+    std::vector<ospray::cpp::CopiedData> copied;
+    std::vector<OSPData> handles(n);
+    const bool is_float = py::isinstance<py::array_t<float>>(arrays[0]);
+    
+    if (share && !is_float)
+        throw std::invalid_argument("blocks need to be float32 arrays to be shared");
+    
+    if (share)
+    {
+        shared.reserve(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            const py::array& a = arrays[i];
+            shared.push_back(ospray::cpp::SharedData(a.data(), OSP_FLOAT, vec3ul(a.shape(0), a.shape(1), a.shape(2)), vec3ul(0, 0, 0)));
+            handles[i] = shared.back().handle();
+        }
+    }
+    else if (is_float)
+    {
+        copied.reserve(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            const py::array& a = arrays[i];
+            copied.push_back(ospray::cpp::CopiedData(a.data(), OSP_FLOAT, vec3ul(a.shape(0), a.shape(1), a.shape(2)), vec3ul(0, 0, 0)));
+            handles[i] = copied.back().handle();
+        }
+    }
+    else
+    {
+        std::vector<float> packed(offsets[n]);
+        float *dst = packed.data();
+        const py::array& first = arrays[0];
+        
+        if (py::isinstance<py::array_t<double>>(first))
+            gather_blocks<double>(arrays, offsets, dst, threads);
+        else if (py::isinstance<py::array_t<uint8_t>>(first))
+            gather_blocks<uint8_t>(arrays, offsets, dst, threads);
+        else if (py::isinstance<py::array_t<int16_t>>(first))
+            gather_blocks<int16_t>(arrays, offsets, dst, threads);
+        else if (py::isinstance<py::array_t<uint16_t>>(first))
+            gather_blocks<uint16_t>(arrays, offsets, dst, threads);
+        else if (py::isinstance<py::array_t<int32_t>>(first))
+            gather_blocks<int32_t>(arrays, offsets, dst, threads);
+        else if (is_float16_array(first))
+            gather_blocks<float16_t>(arrays, offsets, dst, threads);
+        else
+            throw std::invalid_argument("unhandled block data type '" + std::string(py::str(first.dtype())) + "'");
+        
+        copied.reserve(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            const py::array& a = arrays[i];
+            copied.push_back(ospray::cpp::CopiedData(dst + offsets[i], OSP_FLOAT, vec3ul(a.shape(0), a.shape(1), a.shape(2)), vec3ul(0, 0, 0)));
+            handles[i] = copied.back().handle();
+        }
+    }
+    
+    ospray::cpp::Volume volume("amr");
+    volume.setParam("method", amr_method_from_string(method));
+    volume.setParam("gridOrigin", grid_origin);
+    volume.setParam("gridSpacing", grid_spacing);
+    volume.setParam("cellWidth", ospray::cpp::CopiedData(cell_widths.data(), OSP_FLOAT, vec3ul(cell_widths.size(), 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("block.bounds", ospray::cpp::CopiedData(bounds.data(), OSP_BOX3I, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("block.level", ospray::cpp::CopiedData(lvl, OSP_INT, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+    volume.setParam("block.data", ospray::cpp::CopiedData(handles.data(), OSP_DATA, vec3ul(n, 1, 1), vec3ul(0, 0, 0)));
+    volume.commit();
+    
+    // The shared block arrays themselves (not the list, which can change)
+    // are kept alive by the volume object
+    py::object res = py::cast(volume);
+    if (share)
+        keep_alive_with(res, py::cast(arrays));
+    
+    return res;
+}
+
+// Spatial partitioning
+
+typedef py::array_t<float, py::array::c_style | py::array::forcecast> float_array;
+typedef py::array_t<uint32_t, py::array::c_style | py::array::forcecast> uint32_array;
+
+// Optional (N x ncomp) float array argument, an empty array if None
+static float_array
+optional_rows(const py::object& value, size_t n, size_t ncomp, const char *name)
+{
+    if (value.is_none())
+        return float_array();
+    
+    float_array res = float_array::ensure(value);
+    if (!res || (size_t)res.size() != n*ncomp)
+        throw std::invalid_argument(std::string(name) + " needs " + std::to_string(ncomp) + " value(s) per item, for " + std::to_string(n) + " items");
+    
+    return res;
+}
+
+static std::vector<float>
+gathered_rows(const float_array& array, size_t ncomp, const uint32_t *order, size_t n, unsigned threads)
+{
+    std::vector<float> res(n*ncomp);
+    const float *src = array.data();
+    
+    py::gil_scoped_release release;
+    gather_rows(src, ncomp, order, n, res.data(), threads);
+    
+    return res;
+}
+
+static unsigned
+default_parts(unsigned parts)
+{
+    return parts > 0 ? parts : num_threads();
+}
+
+// Morton-order partitioning of N x 3 points into parts, returns (order, offsets), 
+// with part k consisting of points order[offsets[k]:offsets[k+1]]
+static py::tuple
+partition_points(const py::array& points, unsigned parts, unsigned threads)
+{
+    float_array pts = float_array::ensure(points);
+    if (!pts || pts.ndim() != 2 || pts.shape(1) != 3)
+        throw std::invalid_argument("points needs to be an N x 3 array");
+    
+    const size_t n = pts.shape(0);
+    if (n > UINT32_MAX)
+        throw std::invalid_argument("too many points to partition");
+    
+    const float *p = pts.data();
+    std::vector<uint32_t> order;
+    std::vector<size_t> offsets;
+    parts = default_parts(parts);
+    
+    {
+        py::gil_scoped_release release;
+        morton_partition(n, [p](size_t i, float *q) { std::copy(p + 3*i, p + 3*i + 3, q); }, parts, threads, order, offsets);
+    }
+    
+    return py::make_tuple(py::array_t<uint32_t>(order.size(), order.data()), py::array_t<uint64_t>(offsets.size(), (const uint64_t*)offsets.data()));
+}
+
+// Put the model of each part in its own Group, and commit the geometry,
+// model and group of all parts. The commits are done on the calling 
+// thread, one after the other, as OSPRay doesn't document commits from 
+// multiple threads as safe. OSPRay builds a group's BVH on commit, 
+// using its own threads. Returns the committed groups.
+static py::list
+commit_part_groups(std::vector<ospray::cpp::Geometry>& geometries, 
+    std::vector<ospray::cpp::GeometricModel>& models)
+{
+    std::vector<ospray::cpp::Group> groups;
+    
+    groups.reserve(models.size());
+    for (size_t k = 0; k < models.size(); k++)
+    {
+        groups.push_back(ospray::cpp::Group());
+        groups.back().setParam("geometry", ospray::cpp::CopiedData(models[k]));
+    }
+    
+    {
+        py::gil_scoped_release release;
+        
+        for (size_t k = 0; k < groups.size(); k++)
+        {
+            geometries[k].commit();
+            models[k].commit();
+            groups[k].commit();
+        }
+    }
+    
+    py::list res;
+    for (const ospray::cpp::Group& group : groups)
+        res.append(group);
+    
+    return res;
+}
+
+// Split a set of spheres into spatially coherent parts, returning a
+// committed Group (holding a GeometricModel with its own sphere Geometry)
+// per part, so that OSPRay builds a separate, smaller BVH per part. 
+// Each of the groups can be placed in an Instance.
+static py::list
+partition_spheres(const py::array& positions, const py::object& radius, const py::object& colors, 
+    unsigned parts, unsigned threads)
+{
+    float_array pos = float_array::ensure(positions);
+    if (!pos || pos.ndim() != 2 || pos.shape(1) != 3)
+        throw std::invalid_argument("positions needs to be an N x 3 array");
+    
+    const size_t n = pos.shape(0);
+    if (n > UINT32_MAX)
+        throw std::invalid_argument("too many spheres to partition");
+    
+    float_array rad = optional_rows(radius, n, 1, "radius");
+    float_array col = optional_rows(colors, n, 4, "colors");
+    
+    const float *p = pos.data();
+    std::vector<uint32_t> order;
+    std::vector<size_t> offsets;
+    parts = default_parts(parts);
+    
+    {
+        py::gil_scoped_release release;
+        morton_partition(n, [p](size_t i, float *q) { std::copy(p + 3*i, p + 3*i + 3, q); }, parts, threads, order, offsets);
+    }
+    
+    std::vector<ospray::cpp::Geometry> geometries;
+    std::vector<ospray::cpp::GeometricModel> models;
+    
+    for (unsigned k = 0; k < parts; k++)
+    {
+        const size_t count = offsets[k+1] - offsets[k];
+        const uint32_t *part = order.data() + offsets[k];
+        
+        if (count == 0)
+            continue;
+        
+        ospray::cpp::Geometry geometry("sphere");
+        
+        std::vector<float> values = gathered_rows(pos, 3, part, count, threads);
+        geometry.setParam("sphere.position", ospray::cpp::CopiedData(values.data(), OSP_VEC3F, vec3ul(count, 1, 1), vec3ul(0, 0, 0)));
+        
+        if (!radius.is_none())
+        {
+            values = gathered_rows(rad, 1, part, count, threads);
+            geometry.setParam("sphere.radius", ospray::cpp::CopiedData(values.data(), OSP_FLOAT, vec3ul(count, 1, 1), vec3ul(0, 0, 0)));
+        }
+        
+        ospray::cpp::GeometricModel model(geometry);
+        
+        if (!colors.is_none())
+        {
+            values = gathered_rows(col, 4, part, count, threads);
+            model.setParam("color", ospray::cpp::CopiedData(values.data(), OSP_VEC4F, vec3ul(count, 1, 1), vec3ul(0, 0, 0)));
+        }
+        
+        geometries.push_back(geometry);
+        models.push_back(model);
+    }
+    
+    return commit_part_groups(geometries, models);
+}
+
+// Split a triangle or quad mesh into spatially coherent parts (based on
+// face centroids), returning a committed Group per part like 
+// partition_spheres(). Each part only holds the vertices (and vertex 
+// attributes) it uses.
+static py::list
+partition_mesh(const py::array& vertices, const py::array& indices, const py::object& normals, 
+    const py::object& colors, const py::object& texcoords, unsigned parts, unsigned threads)
+{
+    float_array verts = float_array::ensure(vertices);
+    uint32_array idx = uint32_array::ensure(indices);
+    
+    if (!verts || verts.ndim() != 2 || verts.shape(1) != 3)
+        throw std::invalid_argument("vertices needs to be an N x 3 array");
+    if (!idx || idx.ndim() != 2 || (idx.shape(1) != 3 && idx.shape(1) != 4))
+        throw std::invalid_argument("indices needs to be an N x 3 (triangles) or N x 4 (quads) array");
+    
+    const size_t nverts = verts.shape(0);
+    const size_t nfaces = idx.shape(0);
+    const unsigned vpf = idx.shape(1);
+    
+    // Vertex attributes, with their number of components and OSPRay type
+    struct Attribute { const char *name; bool present; float_array values; size_t ncomp; OSPDataType type; };
+    std::vector<Attribute> attributes = {
+        { "vertex.position", true, verts, 3, OSP_VEC3F },
+        { "vertex.normal", !normals.is_none(), optional_rows(normals, nverts, 3, "normals"), 3, OSP_VEC3F },
+        { "vertex.color", !colors.is_none(), optional_rows(colors, nverts, 4, "colors"), 4, OSP_VEC4F },
+        { "vertex.texcoord", !texcoords.is_none(), optional_rows(texcoords, nverts, 2, "texcoords"), 2, OSP_VEC2F },
+    };
+    
+    const float *v = verts.data();
+    const uint32_t *f = idx.data();
+    
+    for (size_t i = 0; i < nfaces*vpf; i++)
+    {
+        if (f[i] >= nverts)
+            throw std::invalid_argument("vertex index " + std::to_string(f[i]) + " out of range");
+    }
+    
+    std::vector<uint32_t> order;
+    std::vector<size_t> offsets;
+    std::vector<MeshPart> mesh_parts(default_parts(parts));
+    
+    {
+        py::gil_scoped_release release;
+        
+        auto centroid = [v, f, vpf](size_t i, float *q) {
+            q[0] = q[1] = q[2] = 0.0f;
+            for (unsigned j = 0; j < vpf; j++)
+            {
+                const float *p = v + 3*(size_t)f[i*vpf + j];
+                q[0] += p[0]; q[1] += p[1]; q[2] += p[2];
+            }
+            q[0] /= vpf; q[1] /= vpf; q[2] /= vpf;
+        };
+        
+        morton_partition(nfaces, centroid, mesh_parts.size(), threads, order, offsets);
+        
+        parallel_for(mesh_parts.size(), [&](size_t begin, size_t end, unsigned /*chunk*/) {
+            for (size_t k = begin; k < end; k++)
+                build_mesh_part(f, vpf, order.data() + offsets[k], offsets[k+1] - offsets[k], mesh_parts[k]);
+        }, threads);
+    }
+    
+    std::vector<ospray::cpp::Geometry> geometries;
+    std::vector<ospray::cpp::GeometricModel> models;
+    
+    for (size_t k = 0; k < mesh_parts.size(); k++)
+    {
+        MeshPart& part = mesh_parts[k];
+        const size_t count = part.vertices.size();
+        
+        if (part.indices.empty())
+            continue;
+        
+        ospray::cpp::Geometry geometry("mesh");
+        
+        for (const Attribute& attr : attributes)
+        {
+            if (!attr.present)
+                continue;
+            std::vector<float> values = gathered_rows(attr.values, attr.ncomp, part.vertices.data(), count, threads);
+            geometry.setParam(attr.name, ospray::cpp::CopiedData(values.data(), attr.type, vec3ul(count, 1, 1), vec3ul(0, 0, 0)));
+        }
+        
+        geometry.setParam("index", ospray::cpp::CopiedData(part.indices.data(), vpf == 3 ? OSP_VEC3UI : OSP_VEC4UI, 
+            vec3ul(part.indices.size()/vpf, 1, 1), vec3ul(0, 0, 0)));
+        
+        // Free this part's memory as soon as OSPRay has its copy
+        part = MeshPart();
+        
+        geometries.push_back(geometry);
+        models.push_back(ospray::cpp::GeometricModel(geometry));
+    }
+    
+    return commit_part_groups(geometries, models);
+}
+
+// Mesh level-of-detail
+
+static void
+mesh_arrays(const py::array& vertices, const py::array& indices, float_array& verts, uint32_array& idx)
+{
+    verts = float_array::ensure(vertices);
+    idx = uint32_array::ensure(indices);
+    
+    if (!verts || verts.ndim() != 2 || verts.shape(1) != 3)
+        throw std::invalid_argument("vertices needs to be an N x 3 array");
+    if (!idx || idx.ndim() != 2 || idx.shape(1) != 3)
+        throw std::invalid_argument("indices needs to be an N x 3 array of triangles");
+    
+    const size_t nverts = verts.shape(0);
+    const uint32_t *f = idx.data();
+    
+    for (ssize_t i = 0; i < idx.size(); i++)
+    {
+        if (f[i] >= nverts)
+            throw std::invalid_argument("vertex index " + std::to_string(f[i]) + " out of range");
+    }
+}
+
+// Decimate a triangle mesh using vertex clustering, either on a grid of the 
+// given resolution (along the longest axis) or to approximately the target 
+// number of triangles. Returns (vertices, indices).
+static py::tuple
+decimate_mesh(const py::array& vertices, const py::array& indices, unsigned resolution, size_t target_triangles, unsigned threads)
+{
+    if ((resolution == 0) == (target_triangles == 0))
+        throw std::invalid_argument("set either resolution or target_triangles");
+    
+    float_array verts;
+    uint32_array idx;
+    mesh_arrays(vertices, indices, verts, idx);
+    
+    DecimatedMesh mesh;
+    const float *v = verts.data();
+    const uint32_t *f = idx.data();
+    const size_t nverts = verts.shape(0), ntris = idx.shape(0);
+    
+    {
+        py::gil_scoped_release release;
+        if (resolution > 0)
+            cluster_decimate(v, nverts, f, ntris, resolution, threads, mesh);
+        else
+            decimate_to_target(v, nverts, f, ntris, target_triangles, threads, mesh);
+    }
+    
+    const ssize_t nv = mesh.vertices.size() / 3, nt = mesh.num_triangles();
+    
+    return py::make_tuple(
+        py::array_t<float>({nv, (ssize_t)3}, mesh.vertices.data()),
+        py::array_t<uint32_t>({nt, (ssize_t)3}, mesh.indices.data()));
+}
+
+// A set of levels of detail of a triangle mesh, each with its own 
+// GeometricModel, of which one at a time is placed in a Group. Level 0 is
+// the full mesh, each next level has about factor times fewer triangles.
+class MeshLOD
+{
+public:
+    
+    MeshLOD(const py::array& vertices, const py::array& indices, int levels, float factor, unsigned threads)
+    :
+        current(-1)
+    {
+        if (levels < 1)
+            throw std::invalid_argument("need at least 1 level");
+        if (factor <= 1.0f)
+            throw std::invalid_argument("factor needs to be larger than 1");
+        
+        float_array verts;
+        uint32_array idx;
+        mesh_arrays(vertices, indices, verts, idx);
+        
+        const float *v = verts.data();
+        const uint32_t *f = idx.data();
+        const size_t nverts = verts.shape(0), ntris = idx.shape(0);
+        
+        if (ntris == 0)
+            throw std::invalid_argument("mesh has no triangles");
+        
+        add_level(v, nverts, f, ntris);
+        
+        size_t target = ntris;
+        for (int l = 1; l < levels; l++)
+        {
+            target = (size_t)(target / factor);
+            if (target < 1)
+                break;
+            
+            DecimatedMesh mesh;
+            {
+                py::gil_scoped_release release;
+                decimate_to_target(v, nverts, f, ntris, target, threads, mesh);
+            }
+            
+            // Collapsed completely, or no further reduction possible
+            if (mesh.num_triangles() == 0 || mesh.num_triangles() >= triangles.back())
+                break;
+            
+            add_level(mesh.vertices.data(), mesh.vertices.size()/3, mesh.indices.data(), mesh.num_triangles());
+        }
+        
+        set_level(levels > 1 ? (int)models.size()-1 : 0);
+    }
+    
+    int num_levels() const { return models.size(); }
+    int get_level() const { return current; }
+    
+    ospray::cpp::Group get_group() const { return group; }
+    
+    py::list
+    get_models() const
+    {
+        py::list res;
+        for (const ospray::cpp::GeometricModel& model : models)
+            res.append(model);
+        return res;
+    }
+    
+    std::vector<size_t> get_triangle_counts() const { return triangles; }
+    
+    // Use the given level in the group, returns true if it changed 
+    // (in which case the world needs to be committed again)
+    bool
+    set_level(int level)
+    {
+        if (level < 0 || level >= (int)models.size())
+            throw std::invalid_argument("level out of range");
+        
+        if (level == current)
+            return false;
+        
+        std::vector<ospray::cpp::GeometricModel> geometry { models[level] };
+        group.setParam("geometry", ospray::cpp::CopiedData(geometry));
+        group.commit();
+        current = level;
+        
+        return true;
+    }
+    
+    // Use the most detailed level with at most budget triangles (or the
+    // coarsest level if there's none), returns true if the level changed
+    bool
+    select(size_t budget)
+    {
+        int level = models.size() - 1;
+        while (level > 0 && triangles[level-1] <= budget)
+            level--;
+        
+        return set_level(level);
+    }
+    
+protected:
+    
+    void 
+    add_level(const float *vertices, size_t nverts, const uint32_t *indices, size_t ntris)
+    {
+        ospray::cpp::Geometry mesh("mesh");
+        mesh.setParam("vertex.position", ospray::cpp::CopiedData(vertices, OSP_VEC3F, vec3ul(nverts, 1, 1), vec3ul(0, 0, 0)));
+        mesh.setParam("index", ospray::cpp::CopiedData(indices, OSP_VEC3UI, vec3ul(ntris, 1, 1), vec3ul(0, 0, 0)));
+        mesh.commit();
+        
+        ospray::cpp::GeometricModel model(mesh);
+        model.commit();
+        
+        models.push_back(model);
+        triangles.push_back(ntris);
+    }
+    
+    std::vector<ospray::cpp::GeometricModel>    models;
+    std::vector<size_t>                         triangles;
+    ospray::cpp::Group                          group;
+    int                                         current;
+};
+
+// Select levels for a set of LOD meshes, given a total triangle budget per
+// frame. The budget is divided over the meshes in proportion to their full
+// resolution triangle counts (or evenly if these are all 0). Returns true
+// if any level changed.
+static bool
+select_lods(const std::vector<MeshLOD*>& lods, size_t budget)
+{
+    double total = 0.0;
+    for (const MeshLOD *lod : lods)
+        total += lod->get_triangle_counts()[0];
+    
+    bool changed = false;
+    for (MeshLOD *lod : lods)
+    {
+        const double share = total > 0.0 ? lod->get_triangle_counts()[0] / total : 1.0 / lods.size();
+        changed |= lod->select((size_t)(budget * share));
+    }
+    
+    return changed;
+}
+
+// Polygon meshes
+
+typedef py::array_t<int32_t, py::array::c_style | py::array::forcecast> int32_array;
+
+// A polygon mesh as vertices plus a flat list of vertex indices, with the
+// number of vertices of each face in loop_lengths (as used by readply and
+// tinyobjloader), validated and converted to the types OSPRay needs
+struct PolygonArrays
+{
+    float_array             vertices;
+    uint32_array            indices;
+    uint32_array            loop_lengths;
+    std::vector<size_t>     starts;         // Start of each face in indices
+    
+    size_t num_vertices() const { return vertices.shape(0); }
+    size_t num_faces() const { return loop_lengths.size(); }
+    size_t num_indices() const { return indices.size(); }
+};
+
+static void
+polygon_arrays(const py::array& vertices, const py::array& indices, const py::array& loop_lengths, PolygonArrays& res)
+{
+    res.vertices = float_array::ensure(vertices);
+    res.indices = uint32_array::ensure(indices);
+    res.loop_lengths = uint32_array::ensure(loop_lengths);
+    
+    if (!res.vertices || res.vertices.ndim() != 2 || res.vertices.shape(1) != 3)
+        throw std::invalid_argument("vertices needs to be an N x 3 array");
+    if (!res.indices || !res.loop_lengths)
+        throw std::invalid_argument("indices and loop_lengths need to be integer arrays");
+    if (res.num_faces() == 0)
+        throw std::invalid_argument("no faces");
+    
+    const uint32_t *idx = res.indices.data();
+    const uint32_t *loops = res.loop_lengths.data();
+    const size_t nindices = res.num_indices(), nfaces = res.num_faces(), nverts = res.num_vertices();
+    
+    {
+        py::gil_scoped_release release;
+        polygon_starts(idx, nindices, loops, nfaces, nverts, res.starts);
+    }
+}
+
+// Triangulate a polygon mesh, using ear clipping for faces with more than 
+// 3 vertices, so concave faces are handled correctly. Returns an N x 3 
+// array of triangle indices, with the triangles of each face in face order.
+static py::array_t<uint32_t>
+triangulate_polygon_mesh(const py::array& vertices, const py::array& indices, const py::array& loop_lengths, unsigned threads)
+{
+    PolygonArrays p;
+    polygon_arrays(vertices, indices, loop_lengths, p);
+    
+    std::vector<uint32_t> triangles;
+    {
+        py::gil_scoped_release release;
+        triangulate_polygons(p.vertices.data(), p.indices.data(), p.loop_lengths.data(), p.num_faces(), p.starts, threads, triangles);
+    }
+    
+    return py::array_t<uint32_t>({(ssize_t)triangles.size()/3, (ssize_t)3}, triangles.data());
+}
+
+// Set the index of a mesh geometry for the given (validated, non-empty) 
+// polygons. Meshes with only triangles or only quads are used as is, mixed
+// triangles and quads become quads (triangles repeating their last index) 
+// and anything else is triangulated. Doesn't need the GIL.
+static void
+set_polygon_mesh_index(ospray::cpp::Geometry& mesh, const float *verts, const uint32_t *idx, const uint32_t *loops, 
+    size_t nfaces, const std::vector<size_t>& starts, unsigned threads)
+{
+    const auto minmax = std::minmax_element(loops, loops + nfaces);
+    const uint32_t min_length = *minmax.first, max_length = *minmax.second;
+    
+    if (max_length == 3)
+        mesh.setParam("index", ospray::cpp::CopiedData(idx, OSP_VEC3UI, vec3ul(nfaces, 1, 1), vec3ul(0, 0, 0)));
+    else if (min_length == 4 && max_length == 4)
+        mesh.setParam("index", ospray::cpp::CopiedData(idx, OSP_VEC4UI, vec3ul(nfaces, 1, 1), vec3ul(0, 0, 0)));
+    else if (max_length == 4)
+    {
+        std::vector<uint32_t> quads;
+        quads_from_tris_and_quads(idx, loops, nfaces, starts, threads, quads);
+        mesh.setParam("index", ospray::cpp::CopiedData(quads.data(), OSP_VEC4UI, vec3ul(nfaces, 1, 1), vec3ul(0, 0, 0)));
+    }
+    else
+    {
+        std::vector<uint32_t> triangles;
+        triangulate_polygons(verts, idx, loops, nfaces, starts, threads, triangles);
+        mesh.setParam("index", ospray::cpp::CopiedData(triangles.data(), OSP_VEC3UI, vec3ul(triangles.size()/3, 1, 1), vec3ul(0, 0, 0)));
+    }
+}
+
+// A mesh geometry for a polygon mesh, with vertex.position and index set 
+// (but not committed, so other parameters can still be added)
+static ospray::cpp::Geometry
+polygon_mesh(const py::array& vertices, const py::array& indices, const py::array& loop_lengths, unsigned threads)
+{
+    PolygonArrays p;
+    polygon_arrays(vertices, indices, loop_lengths, p);
+    
+    ospray::cpp::Geometry mesh("mesh");
+    mesh.setParam("vertex.position", ospray::cpp::CopiedData(p.vertices.data(), OSP_VEC3F, vec3ul(p.num_vertices(), 1, 1), vec3ul(0, 0, 0)));
+    
+    {
+        py::gil_scoped_release release;
+        set_polygon_mesh_index(mesh, p.vertices.data(), p.indices.data(), p.loop_lengths.data(), p.num_faces(), p.starts, threads);
+    }
+    
+    return mesh;
+}
+
+// A subdivision geometry for a polygon mesh, with vertex.position, index 
+// (uint[]) and face (uint[]) set, plus edgeCrease.index (vec2i[]) and
+// edgeCrease.weight (float[]) when creases are given. Not committed, so
+// other parameters (e.g. level) can still be added.
+static ospray::cpp::Geometry
+subdivision_geometry(const py::array& vertices, const py::array& indices, const py::array& loop_lengths, 
+    const py::object& edge_creases, const py::object& edge_crease_weights)
+{
+    PolygonArrays p;
+    polygon_arrays(vertices, indices, loop_lengths, p);
+    
+    ospray::cpp::Geometry subd("subdivision");
+    subd.setParam("vertex.position", ospray::cpp::CopiedData(p.vertices.data(), OSP_VEC3F, vec3ul(p.num_vertices(), 1, 1), vec3ul(0, 0, 0)));
+    subd.setParam("index", ospray::cpp::CopiedData(p.indices.data(), OSP_UINT, vec3ul(p.num_indices(), 1, 1), vec3ul(0, 0, 0)));
+    subd.setParam("face", ospray::cpp::CopiedData(p.loop_lengths.data(), OSP_UINT, vec3ul(p.num_faces(), 1, 1), vec3ul(0, 0, 0)));
+    
+    if (edge_creases.is_none() != edge_crease_weights.is_none())
+        throw std::invalid_argument("edge_creases and edge_crease_weights need to be set together");
+    
+    if (!edge_creases.is_none())
+    {
+        int32_array edges = int32_array::ensure(edge_creases);
+        float_array weights = float_array::ensure(edge_crease_weights);
+        
+        if (!edges || edges.ndim() != 2 || edges.shape(1) != 2)
+            throw std::invalid_argument("edge_creases needs to be an N x 2 array of vertex indices");
+        if (!weights || weights.ndim() != 1 || weights.shape(0) != edges.shape(0))
+            throw std::invalid_argument("edge_crease_weights needs to be an array with a weight per edge crease");
+        
+        const int32_t *e = edges.data();
+        for (ssize_t i = 0; i < edges.size(); i++)
+        {
+            if (e[i] < 0 || (size_t)e[i] >= p.num_vertices())
+                throw std::invalid_argument("edge crease vertex index " + std::to_string(e[i]) + " out of range");
+        }
+        
+        const vec3ul num_items(edges.shape(0), 1, 1);
+        subd.setParam("edgeCrease.index", ospray::cpp::CopiedData(e, OSP_VEC2I, num_items, vec3ul(0, 0, 0)));
+        subd.setParam("edgeCrease.weight", ospray::cpp::CopiedData(weights.data(), OSP_FLOAT, num_items, vec3ul(0, 0, 0)));
+    }
+    
+    return subd;
+}
+
+// Parallel mesh loading
+
+// Committed model for a mesh read from file. Called on the loader threads,
+// so doesn't touch Python objects.
+static ospray::cpp::GeometricModel
+mesh_file_model(const std::string& fname, const ospray::cpp::Material *material)
+{
+    MeshFile mesh;
+    read_mesh_file(fname, mesh);
+    
+    if (mesh.num_faces() == 0)
+        throw std::runtime_error(fname + ": no faces");
+    
+    const size_t nverts = mesh.num_vertices();
+    std::vector<size_t> starts;
+    
+    try
+    {
+        polygon_starts(mesh.indices.data(), mesh.indices.size(), mesh.loop_lengths.data(), mesh.num_faces(), nverts, starts);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(fname + ": " + e.what());
+    }
+    
+    const vec3ul num_items(nverts, 1, 1), stride(0, 0, 0);
+    
+    ospray::cpp::Geometry geometry("mesh");
+    geometry.setParam("vertex.position", ospray::cpp::CopiedData(mesh.vertices.data(), OSP_VEC3F, num_items, stride));
+    if (!mesh.normals.empty())
+        geometry.setParam("vertex.normal", ospray::cpp::CopiedData(mesh.normals.data(), OSP_VEC3F, num_items, stride));
+    if (!mesh.colors.empty())
+        geometry.setParam("vertex.color", ospray::cpp::CopiedData(mesh.colors.data(), OSP_VEC4F, num_items, stride));
+    
+    // The files themselves are processed in parallel, so one thread per file
+    set_polygon_mesh_index(geometry, mesh.vertices.data(), mesh.indices.data(), mesh.loop_lengths.data(), mesh.num_faces(), starts, 1);
+    geometry.commit();
+    
+    ospray::cpp::GeometricModel model(geometry);
+    if (material != nullptr)
+        model.setParam("material", *material);
+    model.commit();
+    
+    return model;
+}
+
+// Load a set of mesh files (PLY or binary STL) on a pool of threads, each 
+// of which reads a file, creates and commits its geometry and model, and
+// then moves on to the next file. Returns a committed Group holding the 
+// models, in file order. progress(done, total) is called on the calling
+// thread as files finish loading. If any file fails to load an exception
+// is raised, for the first such file.
+static ospray::cpp::Group
+load_meshes(const std::vector<std::string>& filenames, const py::object& material, unsigned threads, const py::object& progress)
+{
+    const size_t n = filenames.size();
+    if (n == 0)
+        throw std::invalid_argument("no files");
+    
+    std::unique_ptr<ospray::cpp::Material> mat;
+    if (!material.is_none())
+        mat.reset(new ospray::cpp::Material(material.cast<ospray::cpp::Material>()));
+    
+    // A model per file, or none if loading failed
+    std::vector<std::vector<ospray::cpp::GeometricModel>> models(n);
+    std::vector<std::string> errors(n);
+    
+    std::atomic<size_t> next(0);
+    std::atomic<bool> cancel(false);
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t done = 0;
+    
+    auto worker = [&]() {
+        size_t i;
+        while (!cancel && (i = next++) < n)
+        {
+            try
+            {
+                models[i].push_back(mesh_file_model(filenames[i], mat.get()));
+            }
+            catch (const std::exception& e)
+            {
+                errors[i] = e.what();
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done++;
+            }
+            finished.notify_one();
+        }
+    };
+    
+    const unsigned nthreads = (unsigned)std::min((size_t)num_threads(threads), n);
+    std::vector<std::thread> pool;
+    
+    auto join = [&]() {
+        py::gil_scoped_release release;
+        for (std::thread& t : pool)
+            t.join();
+    };
+    
+    try
+    {
+        for (unsigned t = 0; t < nthreads; t++)
+            pool.push_back(std::thread(worker));
+        
+        // Wake up regularly, so that signals (e.g. Ctrl-C) are handled 
+        // while a large file is loading
+        size_t reported = 0;
+        while (reported < n)
+        {
+            size_t finished_now;
+            {
+                py::gil_scoped_release release;
+                std::unique_lock<std::mutex> lock(mutex);
+                finished.wait_for(lock, std::chrono::milliseconds(100), [&]() { return done > reported; });
+                finished_now = done;
+            }
+            
+            if (PyErr_CheckSignals() != 0)
+                throw py::error_already_set();
+            if (finished_now > reported)
+            {
+                reported = finished_now;
+                if (!progress.is_none())
+                    progress(reported, n);
+            }
+        }
+    }
+    catch (...)
+    {
+        cancel = true;
+        join();
+        throw;
+    }
+    
+    join();
+    
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!errors[i].empty())
+            throw std::runtime_error(errors[i]);
+    }
+    
+    std::vector<ospray::cpp::GeometricModel> geometry;
+    for (size_t i = 0; i < n; i++)
+        geometry.push_back(models[i][0]);
+    
+    ospray::cpp::Group group;
+    group.setParam("geometry", ospray::cpp::CopiedData(geometry));
+    {
+        py::gil_scoped_release release;
+        group.commit();
+    }
+    
+    return group;
+}
+
+// Data cache
+
+// Copied data is looked up by a hash of the array memory, plus everything
+// else that determines the resulting Data: the constructor used, the 
+// element type and the shape
+struct DataCacheKey
+{
+    ContentHash             hash;
+    char                    constructor;    // 's'calar, 'v'ec or 'b'ox
+    char                    kind;
+    ssize_t                 itemsize;
+    std::vector<ssize_t>    shape;
+    
+    bool 
+    operator==(const DataCacheKey& other) const
+    {
+        return hash == other.hash && constructor == other.constructor && kind == other.kind && 
+            itemsize == other.itemsize && shape == other.shape;
+    }
+};
+
+struct DataCacheKeyHash
+{
+    size_t operator()(const DataCacheKey& key) const { return (size_t)key.hash.lo; }
+};
+
+struct DataCacheStats
+{
+    size_t  hits;
+    size_t  misses;
+    size_t  evictions;
+    size_t  bytes_saved;    // Array bytes not copied because of hits
+    double  hash_time;      // Seconds
+};
+
+// Disabled as long as the maximum size is 0
+static LRUCache<DataCacheKey, ospray::cpp::CopiedData, DataCacheKeyHash> data_cache;
+static DataCacheStats data_cache_stats;
+static unsigned data_cache_threads = 0;
+
+// Copied data constructor F, returning existing Data from the cache for
+// arrays with the same contents. The cache is only accessed with the GIL
+// held.
+template<ospray::cpp::CopiedData (*F)(const py::array&), char CONSTRUCTOR>
+ospray::cpp::CopiedData
+cached_copied_data(const py::array& array)
+{
+    // Hashing covers the array memory linearly, so needs a contiguous array
+    if (data_cache.get_max_bytes() == 0 || !(array.flags() & (py::array::c_style | py::array::f_style)))
+        return F(array);
+    
+    DataCacheKey key;
+    key.constructor = CONSTRUCTOR;
+    key.kind = array.dtype().kind();
+    key.itemsize = array.itemsize();
+    key.shape.assign(array.shape(), array.shape() + array.ndim());
+    
+    const void *data = array.data();
+    const size_t nbytes = array.nbytes();
+    
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+        py::gil_scoped_release release;
+        key.hash = content_hash(data, nbytes, data_cache_threads);
+    }
+    data_cache_stats.hash_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    
+    const ospray::cpp::CopiedData *cached = data_cache.get(key);
+    if (cached != nullptr)
+    {
+        data_cache_stats.hits++;
+        data_cache_stats.bytes_saved += nbytes;
+        return *cached;
+    }
+    
+    data_cache_stats.misses++;
+    
+    ospray::cpp::CopiedData res = F(array);
+    if (res.handle() != nullptr)
+        data_cache_stats.evictions += data_cache.put(key, res, nbytes);
+    
+    return res;
+}
+
+// Enable the cache with the given maximum size in bytes (of the source 
+// arrays), or disable and clear it with a size of 0
+static void
+set_data_cache(size_t max_bytes, unsigned threads)
+{
+    data_cache_stats.evictions += data_cache.set_max_bytes(max_bytes);
+    data_cache_threads = threads;
+}
+
+static void
+clear_data_cache()
+{
+    data_cache.clear();
+    data_cache_stats = DataCacheStats();
+}
+
+static py::dict
+get_data_cache_stats()
+{
+    py::dict res;
+    
+    res["enabled"] = data_cache.get_max_bytes() > 0;
+    res["max_bytes"] = data_cache.get_max_bytes();
+    res["bytes"] = data_cache.get_bytes();
+    res["entries"] = data_cache.size();
+    res["hits"] = data_cache_stats.hits;
+    res["misses"] = data_cache_stats.misses;
+    res["evictions"] = data_cache_stats.evictions;
+    res["bytes_saved"] = data_cache_stats.bytes_saved;
+    res["hash_time"] = data_cache_stats.hash_time;
+    
+    return res;
+}
+
+// In-place updates of Data
+
+// Whether the numpy element type matches the components of OSPRay type
+static bool
+update_type_matches(const py::dtype& dtype, size_t ncomp, OSPDataType type)
+{
+    if (field_data_type(dtype, ncomp) == type)
+        return true;
+    
+    switch (type)
+    {
+      case OSP_BOOL:
+        return dtype.kind() == 'b' && ncomp == 1;
+      case OSP_BOX1I: case OSP_BOX2I: case OSP_BOX3I: case OSP_BOX4I:
+        return dtype.kind() == 'i' && dtype.itemsize() == 4;
+      case OSP_BOX1F: case OSP_BOX2F: case OSP_BOX3F: case OSP_BOX4F:
+      case OSP_LINEAR2F: case OSP_LINEAR3F: case OSP_AFFINE2F: case OSP_AFFINE3F:
+        return dtype.kind() == 'f' && dtype.itemsize() == 4;
+      default:
+        return false;
+    }
+}
+
+// Copy the values of array into Data self, starting at item offset (an 
+// int, or an (i, j, k) tuple for 2D/3D Data). Only for CopiedData, as for
+// SharedData this would write into the application's array. The array shape, minus a
+// trailing axis for the components of vector and box types, gives the
+// region to update, in the same way as for the data constructors. For 1D 
+// Data any array shape can be used. 
+// Only the region is copied (with ospCopyData()), after which objects 
+// using the Data are marked as changed (see ObjectTracker). Cached 
+// (copied_data_constructor()) entries for the Data are dropped, as their 
+// contents no longer match.
+static void
+data_update(const ospray::cpp::CopiedData& self, const py::array& array, const py::object& offset)
+{
+    OSPData handle = self.handle();
+    OSPDataType type;
+    uint64_t dims[3];
+    
+    if (handle == nullptr || !object_tracker().data_info(handle, type, dims))
+        throw std::invalid_argument("unknown Data object, can't update");
+    
+    if (osp_is_object_type(type))
+        throw std::invalid_argument("can't update Data with object handles");
+    
+    const size_t type_size = osp_type_size(type);
+    py::array values = contiguous_array(float16_widened(array));
+    const py::dtype& dtype = values.dtype();
+    
+    if (type_size == 0 || type_size % dtype.itemsize() != 0 || 
+        !update_type_matches(dtype, type_size / dtype.itemsize(), type))
+    {
+        throw std::invalid_argument("array type '" + std::string(py::str(array.dtype())) + 
+            "' doesn't match the Data element type " + std::to_string(type));
+    }
+    
+    const size_t ncomp = type_size / dtype.itemsize();
+    
+    // Region to update
+    uint64_t count[3] = { 1, 1, 1 };
+    
+    if (dims[1] == 1 && dims[2] == 1)
+    {
+        if (values.size() % ncomp != 0)
+            throw std::invalid_argument("array size isn't a multiple of the " + std::to_string(ncomp) + " components per item");
+        count[0] = values.size() / ncomp;
+    }
+    else
+    {
+        int ndim = values.ndim();
+        if (ncomp > 1)
+        {
+            if (ndim < 2 || (size_t)values.shape(ndim-1) != ncomp)
+                throw std::invalid_argument("last array dimension needs to be " + std::to_string(ncomp));
+            ndim--;
+        }
+        if (ndim < 1 || ndim > 3)
+            throw std::invalid_argument("expected 1 to 3 item dimensions");
+        for (int d = 0; d < ndim; d++)
+            count[d] = values.shape(d);
+    }
+    
+    uint64_t start[3] = { 0, 0, 0 };
+    
+    if (py::isinstance<py::int_>(offset))
+        start[0] = offset.cast<uint64_t>();
+    else
+    {
+        const std::vector<uint64_t> o = offset.cast<std::vector<uint64_t>>();
+        if (o.size() < 1 || o.size() > 3)
+            throw std::invalid_argument("offset needs 1 to 3 values");
+        for (size_t d = 0; d < o.size(); d++)
+            start[d] = o[d];
+    }
+    
+    for (int d = 0; d < 3; d++)
+    {
+        if (start[d] + count[d] > dims[d])
+        {
+            throw std::out_of_range("update of " + std::to_string(count[d]) + " items at offset " + 
+                std::to_string(start[d]) + " exceeds dimension " + std::to_string(d) + 
+                " of size " + std::to_string(dims[d]));
+        }
+    }
+    
+    if (count[0] * count[1] * count[2] == 0)
+        return;
+    
+    {
+        // The source only needs to live during the copy
+        py::gil_scoped_release release;
+        ospray::cpp::SharedData source(values.data(), type, vec3ul { count[0], count[1], count[2] }, vec3ul { 0, 0, 0 });
+        ospCopyData(source.handle(), handle, start[0], start[1], start[2]);
+    }
+    
+    data_cache.remove_if([handle](const ospray::cpp::CopiedData& d) { return d.handle() == handle; });
+}
+
+// Scene snapshots
+
+static void
+record_scene(bool enable)
+{
+    scene_recorder().set_recording(enable);
+}
+
+static void
+save_scene(const ospray::cpp::World& world, const std::string& path)
+{
+    py::gil_scoped_release release;
+    scene_recorder().save(world.handle(), path);
+}
+
+// The file is memory-mapped while loading, Data contents are copied from
+// it, so the mapping isn't needed afterwards
+static ospray::cpp::World
+load_scene(const std::string& path)
+{
+    py::array mapped = py::module::import("numpy").attr("memmap")(path, "uint8", "r");
+    const unsigned char *base = static_cast<const unsigned char*>(mapped.data());
+    const size_t size = mapped.nbytes();
+    
+    OSPObject handle;
+    {
+        py::gil_scoped_release release;
+        handle = scene_load(base, size);
+    }
+    
+    return ospray::cpp::World((OSPWorld)handle);
+}
+
+// Frame streaming
+
+// Encodes the (8-bit RGBA) color buffer of a framebuffer into messages
+// holding only the tiles that changed since the previous frame, see
+// stream.h for the format
+class FrameStreamer
+{
+public:
+
+    FrameStreamer(int width, int height, int tile_size, const std::string& encoding, int quality, unsigned threads)
+    :
+        width(width), height(height), tiles_sent(0), bytes_sent(0)
+    {
+        StreamEncoding enc;
+        if (encoding == "raw")
+            enc = STREAM_RAW;
+        else if (encoding == "delta")
+            enc = STREAM_DELTA;
+        else if (encoding == "jpeg")
+            enc = STREAM_JPEG;
+        else if (encoding == "webp")
+            enc = STREAM_WEBP;
+        else
+            throw std::invalid_argument("unknown encoding '" + encoding + "'");
+        
+        if (width <= 0 || height <= 0 || tile_size <= 0)
+            throw std::invalid_argument("invalid frame or tile size");
+        
+        encoder.reset(new FrameStreamEncoder(width, height, tile_size, enc, quality, threads));
+    }
+    
+    py::bytes
+    encode(ospray::cpp::FrameBuffer& framebuffer)
+    {
+        encode_framebuffer(framebuffer);
+        return py::bytes(reinterpret_cast<const char*>(message.data()), message.size());
+    }
+    
+    py::bytes
+    encode_array(const py::array_t<uint8_t, py::array::c_style | py::array::forcecast>& pixels)
+    {
+        if (pixels.size() != (ssize_t)width * height * 4)
+            throw std::invalid_argument("expected an array of " + std::to_string(height) + "x" + 
+                std::to_string(width) + "x4 values");
+        
+        const uint8_t *p = pixels.data();
+        {
+            py::gil_scoped_release release;
+            tiles_sent = encoder->encode(p, message);
+        }
+        bytes_sent = message.size();
+        
+        return py::bytes(reinterpret_cast<const char*>(message.data()), message.size());
+    }
+    
+    // Encode and write directly to a socket (or anything else with a 
+    // fileno()), returns the number of bytes written. For a socket with 
+    // a timeout (which Python implements with a non-blocking descriptor)
+    // the timeout applies to each wait until the socket is writable.
+    size_t
+    send(ospray::cpp::FrameBuffer& framebuffer, const py::object& socket)
+    {
+        const int fd = py::cast<int>(socket.attr("fileno")());
+        int timeout_ms = -1;
+        
+        if (py::hasattr(socket, "gettimeout"))
+        {
+            py::object timeout = socket.attr("gettimeout")();
+            if (!timeout.is_none())
+                timeout_ms = (int)(timeout.cast<double>() * 1000);
+        }
+        
+        encode_framebuffer(framebuffer);
+        
+        // The encoder assumes the receiver has this frame, so on failure
+        // the next frame needs to be a keyframe
+        try
+        {
+            py::gil_scoped_release release;
+            stream_write(fd, message.data(), message.size(), timeout_ms);
+        }
+        catch (...)
+        {
+            encoder->reset();
+            throw;
+        }
+        
+        return message.size();
+    }
+    
+    void reset() { encoder->reset(); }
+    
+    size_t get_tiles_sent() const { return tiles_sent; }
+    size_t get_bytes_sent() const { return bytes_sent; }
+    unsigned get_num_tiles() const { return encoder->num_tiles(); }
+    uint32_t get_frame() const { return encoder->get_frame(); }
+
+protected:
+
+    // OSPRay can't be queried for the framebuffer size and format, these
+    // are known from its creation through the redirects in scene.h
+    void
+    encode_framebuffer(ospray::cpp::FrameBuffer& framebuffer)
+    {
+        int fb_width, fb_height;
+        OSPFrameBufferFormat format;
+        uint32_t channels;
+        
+        if (!object_tracker().framebuffer_info(framebuffer.handle(), fb_width, fb_height, format, channels))
+            throw std::invalid_argument("unknown framebuffer");
+        if (format != OSP_FB_RGBA8 && format != OSP_FB_SRGBA)
+            throw std::invalid_argument("framebuffer needs an 8-bit RGBA format (OSP_FB_RGBA8 or OSP_FB_SRGBA)");
+        if (!(channels & OSP_FB_COLOR))
+            throw std::invalid_argument("framebuffer has no color channel");
+        if (fb_width != width || fb_height != height)
+            throw std::invalid_argument("framebuffer is " + std::to_string(fb_width) + "x" + std::to_string(fb_height) + 
+                ", expected " + std::to_string(width) + "x" + std::to_string(height));
+        
+        const unsigned char *fb = static_cast<const unsigned char*>(framebuffer.map(OSP_FB_COLOR));
+        if (fb == nullptr)
+            throw std::invalid_argument("framebuffer has no color channel");
+        
+        try
+        {
+            py::gil_scoped_release release;
+            tiles_sent = encoder->encode(fb, message);
+        }
+        catch (...)
+        {
+            framebuffer.unmap((void*)fb);
+            throw;
+        }
+        
+        framebuffer.unmap((void*)fb);
+        bytes_sent = message.size();
+    }
+    
+    int                                     width, height;
+    std::unique_ptr<FrameStreamEncoder>     encoder;
+    std::vector<unsigned char>              message;
+    size_t                                  tiles_sent;
+    size_t                                  bytes_sent;
+};
+
+// Distributed rendering
+
+static void
+brick_dims_arg(const std::vector<size_t>& shape, size_t dims[3])
+{
+    if (shape.size() != 3)
+        throw std::invalid_argument("shape needs to be (x, y, z)");
+    for (int d = 0; d < 3; d++)
+        dims[d] = shape[d];
+}
+
+static py::tuple
+get_brick_grid(const std::vector<size_t>& shape, unsigned ranks)
+{
+    size_t dims[3];
+    unsigned grid[3];
+    
+    brick_dims_arg(shape, dims);
+    brick_grid(ranks, dims, grid);
+    
+    return py::make_tuple(grid[0], grid[1], grid[2]);
+}
+
+// Extent of the brick of rank (in x, y, z order, like volume arrays): 
+// the voxels to read (start, count), the position of the first voxel 
+// (grid_origin) and the owned region for the World "region" parameter
+static py::dict
+get_brick_extent(const std::vector<size_t>& shape, unsigned rank, unsigned ranks, unsigned ghost,
+    const vec3f& origin, const vec3f& spacing)
+{
+    size_t dims[3];
+    unsigned grid[3];
+    BrickExtent e;
+    
+    brick_dims_arg(shape, dims);
+    brick_grid(ranks, dims, grid);
+    brick_extent(rank, grid, dims, ghost, e);
+    
+    py::dict res;
+    res["grid"] = py::make_tuple(grid[0], grid[1], grid[2]);
+    res["index"] = py::make_tuple(e.index[0], e.index[1], e.index[2]);
+    res["start"] = py::make_tuple(e.voxel_lo[0], e.voxel_lo[1], e.voxel_lo[2]);
+    res["count"] = py::make_tuple(e.voxel_hi[0]-e.voxel_lo[0], e.voxel_hi[1]-e.voxel_lo[1], e.voxel_hi[2]-e.voxel_lo[2]);
+    res["grid_origin"] = py::make_tuple(
+        origin.x + e.voxel_lo[0]*spacing.x, origin.y + e.voxel_lo[1]*spacing.y, origin.z + e.voxel_lo[2]*spacing.z);
+    res["region"] = py::make_tuple(
+        origin.x + e.cell_lo[0]*spacing.x, origin.y + e.cell_lo[1]*spacing.y, origin.z + e.cell_lo[2]*spacing.z,
+        origin.x + e.cell_hi[0]*spacing.x, origin.y + e.cell_hi[1]*spacing.y, origin.z + e.cell_hi[2]*spacing.z);
+    
+    return res;
+}
+
+// Committed structuredRegular volume for the brick of rank, copied (in 
+// parallel) from the full volume array. Returns (volume, region).
+static py::tuple
+volume_brick(const py::array& array, unsigned rank, unsigned ranks, unsigned ghost,
+    const vec3f& grid_origin, const vec3f& grid_spacing, unsigned threads)
+{
+    if (array.ndim() != 3)
+        throw std::invalid_argument("expected a 3-dimensional array");
+    
+    const std::vector<size_t> shape { (size_t)array.shape(0), (size_t)array.shape(1), (size_t)array.shape(2) };
+    py::dict extent = get_brick_extent(shape, rank, ranks, ghost, grid_origin, grid_spacing);
+    py::tuple start = extent["start"].cast<py::tuple>(), count = extent["count"].cast<py::tuple>();
+    
+    // Strided view of the brick, ingested into a compact array
+    py::tuple slices(3);
+    for (int d = 0; d < 3; d++)
     {
-        if (py::isinstance<py::array_t<float>>(array))
-            return ospray::cpp::CopiedData(array.data(), OSP_BOX1F, num_items, byte_stride);
-        else if (py::isinstance<py::array_t<int32_t>>(array))
-            return ospray::cpp::CopiedData(array.data(), OSP_BOX1I, num_items, byte_stride);
-    }       
-    else if (vecdim == 4)
+        const ssize_t s = start[d].cast<ssize_t>();
+        slices[d] = py::slice(s, s + count[d].cast<ssize_t>(), 1);
+    }
+    py::array view = array[slices].cast<py::array>();
+    
+    ptrdiff_t strides[3];
+    size_t dims[3];
+    for (int d = 0; d < 3; d++)
     {
-        if (py::isinstance<py::array_t<float>>(array))
-            return ospray::cpp::CopiedData(array.data(), OSP_BOX2F, num_items, byte_stride);
-        else if (py::isinstance<py::array_t<int32_t>>(array))
-            return ospray::cpp::CopiedData(array.data(), OSP_BOX2I, num_items, byte_stride);
+        dims[d] = view.shape(d);
+        strides[d] = view.strides(d);
     }
-    else if (vecdim == 6)
+    
+    py::dtype dtype = py::dtype::of<float>();
+    const OSPDataType type = voxel_type_from_numpy_array(array);
+    if (type != OSP_UNKNOWN && type != OSP_DOUBLE)
+        dtype = array.dtype();
+    
+    py::array brick = new_volume_array(dtype, vec3ul(dims[0], dims[1], dims[2]));
+    std::function<void()> job = ingest_job(view, strides, dims, brick, threads);
     {
-        if (py::isinstance<py::array_t<float>>(array))
-            return ospray::cpp::CopiedData(array.data(), OSP_BOX3F, num_items, byte_stride);
-        else if (py::isinstance<py::array_t<int32_t>>(array))
-            return ospray::cpp::CopiedData(array.data(), OSP_BOX3I, num_items, byte_stride);
+        py::gil_scoped_release release;
+        job();
     }
-    else
+    
+    // Copied, as the brick is only a temporary buffer and OSPRay can use
+    // the volume after the Python object is gone
+    vec3ul byte_stride { 0, 0, 0 };
+    ospray::cpp::Volume volume("structuredRegular");
+    volume.setParam("data", ospray::cpp::CopiedData(brick.data(), voxel_type_from_numpy_array(brick), 
+        vec3ul(dims[0], dims[1], dims[2]), byte_stride));
+    volume.setParam("gridOrigin", extent["grid_origin"].cast<vec3f>());
+    volume.setParam("gridSpacing", grid_spacing);
     {
-        if (py::isinstance<py::array_t<float>>(array))
-            return ospray::cpp::CopiedData(array.data(), OSP_BOX4F, num_items, byte_stride);
-        else if (py::isinstance<py::array_t<int32_t>>(array))
-            return ospray::cpp::CopiedData(array.data(), OSP_BOX4I, num_items, byte_stride);
+        py::gil_scoped_release release;
+        volume.commit();
     }
     
-    printf("WARNING: unhandled array in copied_data_from_numpy_array_box(): ");
-    print_array_info(array);
-    printf("\n");
-        
-    return ospray::cpp::CopiedData();
+    return py::make_tuple(volume, extent["region"]);
 }
 
-ospray::cpp::SharedData
-shared_data_from_numpy_array_box(const py::array& array)
+// Camera paths
+
+static glm::vec3
+glm_vec3(const vec3f& v)
 {
-    const int ndim = array.ndim();
+    return glm::vec3(v.x, v.y, v.z);
+}
+
+// Add a keyframe, with the orientation given either as a (w, x, y, z)
+// quaternion (like mat4.from_quaternion()), a direction or a target
+// to look at, the latter two with an up vector
+static void
+camera_path_add_keyframe(CameraPath& self, float time, const vec3f& position,
+    const py::object& orientation, const py::object& direction, const py::object& target,
+    const vec3f& up, float fovy)
+{
+    CameraKeyframe key;
+    key.time = time;
+    key.position = glm_vec3(position);
+    key.fovy = fovy;
     
-    if (ndim > 3)
+    const int given = !orientation.is_none() + !direction.is_none() + !target.is_none();
+    if (given != 1)
+        throw std::invalid_argument("exactly one of orientation, direction and target needs to be given");
+    
+    if (!orientation.is_none())
     {
-        printf("ERROR: more than 3 dimensions not supported in shared_data_from_numpy_array_box(): ");
-        print_array_info(array);
-        printf("\n");
-        return ospray::cpp::SharedData();
+        const std::vector<float> q = orientation.cast<std::vector<float>>();
+        if (q.size() != 4)
+            throw std::invalid_argument("orientation needs to be a (w, x, y, z) quaternion");
+        key.orientation = glm::normalize(glm::quat(q[0], q[1], q[2], q[3]));
     }
+    else if (!direction.is_none())
+        key.orientation = camera_orientation(glm_vec3(direction.cast<vec3f>()), glm_vec3(up));
+    else
+        key.orientation = camera_orientation(glm_vec3(target.cast<vec3f>()) - key.position, 
+            glm_vec3(up));
     
-    const int vecdim = array.shape(ndim-1);
+    self.add(key);
+}
+
+// Frame times: for an integer n, n times evenly spaced over the path
+// (including both ends), otherwise a sequence of times
+static std::vector<float>
+camera_path_times(const CameraPath& self, const py::object& frames)
+{
+    if (!py::isinstance<py::int_>(frames))
+        return frames.cast<std::vector<float>>();
     
-    if (vecdim != 2 && vecdim != 4 && vecdim != 6 && vecdim != 8)
-    {
-        printf("ERROR: last dimension needs to be 2,4,6 or 8 in shared_data_from_numpy_array_box(): ");
-        print_array_info(array);
-        printf("\n");
-        return ospray::cpp::SharedData();
-    }
+    const int n = frames.cast<int>();
+    if (n < 1)
+        throw std::invalid_argument("number of frames needs to be at least 1");
     
-    const py::dtype& dtype = array.dtype();
-    vec3ul  num_items { 1, 1, 1 };
-    vec3ul  byte_stride { 0, 0, 0 };
+    std::vector<float> times(n);
+    for (int i = 0; i < n; i++)
+        times[i] = n > 1 ? self.start() + (self.end() - self.start()) * i / (n - 1) : self.start();
     
-    num_items.x = array.shape(0);
-    if (ndim > 2)
-        num_items.y = array.shape(1);
-    if (ndim > 3)
-        num_items.z = array.shape(2);
+    return times;
+}
+
+// Evaluate the path for all frames at once, returns a dict of arrays:
+// time (N), position, direction and up (N x 3) and fovy (N)
+static py::dict
+camera_path_evaluate(const CameraPath& self, const py::object& frames)
+{
+    const std::vector<float> times = camera_path_times(self, frames);
+    const ssize_t n = times.size();
     
-    if (vecdim == 2)
-    {
-        if (py::isinstance<py::array_t<float>>(array))
-            return ospray::cpp::SharedData(array.data(), OSP_BOX1F, num_items, byte_stride);
-        else if (py::isinstance<py::array_t<int32_t>>(array))
-            return ospray::cpp::SharedData(array.data(), OSP_BOX1I, num_items, byte_stride);
-    }       
-    else if (vecdim == 4)
-    {
-        if (py::isinstance<py::array_t<float>>(array))
-            return ospray::cpp::SharedData(array.data(), OSP_BOX2F, num_items, byte_stride);
-        else if (py::isinstance<py::array_t<int32_t>>(array))
-            return ospray::cpp::SharedData(array.data(), OSP_BOX2I, num_items, byte_stride);
-    }
-    else if (vecdim == 6)
+    py::array_t<float> time(n), position({n, (ssize_t)3}), direction({n, (ssize_t)3}), up({n, (ssize_t)3}), fovy(n);
+    float *T = time.mutable_data(), *P = position.mutable_data(), *D = direction.mutable_data();
+    float *U = up.mutable_data(), *F = fovy.mutable_data();
+    
+    for (ssize_t i = 0; i < n; i++)
     {
-        if (py::isinstance<py::array_t<float>>(array))
-            return ospray::cpp::SharedData(array.data(), OSP_BOX3F, num_items, byte_stride);
-        else if (py::isinstance<py::array_t<int32_t>>(array))
-            return ospray::cpp::SharedData(array.data(), OSP_BOX3I, num_items, byte_stride);
+        const CameraFrame f = self.evaluate(times[i]);
+        T[i] = times[i];
+        F[i] = f.fovy;
+        for (int c = 0; c < 3; c++)
+        {
+            P[3*i+c] = f.position[c];
+            D[3*i+c] = f.direction[c];
+            U[3*i+c] = f.up[c];
+        }
     }
-    else
+    
+    py::dict res;
+    res["time"] = time;
+    res["position"] = position;
+    res["direction"] = direction;
+    res["up"] = up;
+    res["fovy"] = fovy;
+    return res;
+}
+
+static void
+camera_set_frame(ospray::cpp::Camera& camera, const CameraFrame& f, bool set_fovy)
+{
+    camera.setParam("position", vec3f(f.position.x, f.position.y, f.position.z));
+    camera.setParam("direction", vec3f(f.direction.x, f.direction.y, f.direction.z));
+    camera.setParam("up", vec3f(f.up.x, f.up.y, f.up.z));
+    if (set_fovy)
+        camera.setParam("fovy", f.fovy);
+    camera.commit();
+}
+
+// Set (and commit) the camera parameters for the given time. The fovy
+// parameter only applies to perspective cameras.
+static void
+camera_path_apply(const CameraPath& self, ospray::cpp::Camera& camera, float time, bool set_fovy)
+{
+    camera_set_frame(camera, self.evaluate(time), set_fovy);
+}
+
+// Render a frame per time, each with samples accumulated frames, updating
+// the camera natively. If callback is given it is called after each frame
+// as callback(frame), e.g. to save the image, returning False stops 
+// rendering. Returns the render time per frame, in seconds.
+static py::array_t<float>
+camera_path_render(const CameraPath& self, ospray::cpp::FrameBuffer& framebuffer, ospray::cpp::Renderer& renderer,
+    ospray::cpp::Camera& camera, ospray::cpp::World& world, const py::object& frames, int samples, 
+    bool set_fovy, const py::object& callback)
+{
+    const std::vector<float> times = camera_path_times(self, frames);
+    std::vector<float> seconds;
+    
+    for (size_t i = 0; i < times.size(); i++)
     {
-        if (py::isinstance<py::array_t<float>>(array))
-            return ospray::cpp::SharedData(array.data(), OSP_BOX4F, num_items, byte_stride);
-        else if (py::isinstance<py::array_t<int32_t>>(array))
-            return ospray::cpp::SharedData(array.data(), OSP_BOX4I, num_items, byte_stride);
+        camera_set_frame(camera, self.evaluate(times[i]), set_fovy);
+        framebuffer.resetAccumulation();
+        
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < std::max(samples, 1); s++)
+        {
+            ospray::cpp::Future future = framebuffer.renderFrame(renderer, camera, world);
+            py::gil_scoped_release release;
+            future.wait();
+        }
+        seconds.push_back(std::chrono::duration<float>(std::chrono::steady_clock::now() - t0).count());
+        
+        if (!callback.is_none())
+        {
+            py::object res = callback(i);
+            if (!res.is_none() && !res.cast<bool>())
+                break;
+        }
     }
     
-    printf("WARNING: unhandled array in shared_data_from_numpy_array_box(): ");
-    print_array_info(array);
-    printf("\n");
-        
-    return ospray::cpp::SharedData();
+    return py::array_t<float>(seconds.size(), seconds.data());
 }
 
 template<typename T>
@@ -849,7 +4276,7 @@ template<typename T>
 void
 set_param_numpy_array(T &self, const std::string &name, py::array &array)
 {
-    self.setParam(name, copied_data_from_numpy_array(array));
+    self.setParam(name, cached_copied_data<copied_data_from_numpy_array, 's'>(array));
 }
 
 template<typename T>
@@ -940,6 +4367,220 @@ same_handle(T &self, const T &other)
     return self.handle() == other.handle();
 }
 
+// Change tracking, off by default as it adds locking to the parameter and
+// commit calls (see tracking.h). Objects created before enabling it are 
+// always considered changed.
+static void
+track_changes(bool enable)
+{
+    object_tracker().set_enabled(enable);
+}
+
+// Commit profiling
+
+struct CommitProfile
+{
+    std::unordered_map<OSPObject, double>       times;      // Of the objects committed in the call
+    std::unordered_set<OSPObject>               visited;
+    std::unordered_map<OSPObject, uint64_t>     primitives; // Incl. referenced objects
+};
+
+// Primitives of handle plus everything it references, shared objects 
+// counted for each reference
+static uint64_t
+total_primitives(OSPObject handle, CommitProfile& profile)
+{
+    auto it = profile.primitives.find(handle);
+    if (it != profile.primitives.end())
+        return it->second;
+    
+    ObjectTracker& tracker = object_tracker();
+    TrackedObject o;
+    uint64_t n = tracker.primitives(handle);
+    
+    if (tracker.get(handle, o))
+    {
+        for (const auto& p : o.params)
+            n += total_primitives(p.second, profile);
+        for (OSPObject child : o.elements)
+            n += total_primitives(child, profile);
+    }
+    
+    profile.primitives[handle] = n;
+    return n;
+}
+
+// Node of the profile tree for handle, with its referenced objects as 
+// children, sorted by descending total time. The time is that of the 
+// latest commit of the object, which is the one in the profiled call for
+// the objects it committed. Objects referenced more than once only get 
+// their children (and time) at the first reference.
+static py::dict
+commit_profile_node(OSPObject handle, const py::object& param, const py::object& index, CommitProfile& profile)
+{
+    ObjectTracker& tracker = object_tracker();
+    TrackedObject o;
+    const bool known = tracker.get(handle, o);
+    
+    py::dict node;
+    node["type"] = osp_object_type_name(o.type);
+    node["subtype"] = o.subtype;
+    node["handle"] = (size_t)handle;
+    node["param"] = param;
+    node["index"] = index;
+    node["primitives"] = total_primitives(handle, profile);
+    
+    const bool repeated = profile.visited.count(handle) > 0;
+    auto t = profile.times.find(handle);
+    double time = 0.0;
+    if (!repeated)
+        time = t != profile.times.end() ? t->second : o.commit_time;
+    double total_time = time;
+    
+    node["repeated"] = repeated;
+    node["committed"] = !repeated && t != profile.times.end();
+    node["time"] = time;
+    
+    std::vector<std::pair<double, py::dict>> children;
+    
+    if (known && !repeated)
+    {
+        profile.visited.insert(handle);
+        
+        for (const auto& p : o.params)
+        {
+            TrackedObject c;
+            if (tracker.get(p.second, c) && c.type == OSP_DATA)
+            {
+                // Object arrays are flattened, other Data isn't committed
+                for (size_t i = 0; i < c.elements.size(); i++)
+                {
+                    py::dict child = commit_profile_node(c.elements[i], py::str(p.first), py::int_(i), profile);
+                    children.push_back(std::make_pair(child["total_time"].cast<double>(), child));
+                }
+            }
+            else
+            {
+                py::dict child = commit_profile_node(p.second, py::str(p.first), py::none(), profile);
+                children.push_back(std::make_pair(child["total_time"].cast<double>(), child));
+            }
+        }
+    }
+    
+    std::stable_sort(children.begin(), children.end(), 
+        [](const std::pair<double, py::dict>& a, const std::pair<double, py::dict>& b) { return a.first > b.first; });
+    
+    py::list child_list;
+    for (const auto& c : children)
+    {
+        total_time += c.first;
+        child_list.append(c.second);
+    }
+    
+    node["total_time"] = total_time;
+    node["children"] = child_list;
+    
+    return node;
+}
+
+// Commit the changed objects that root (directly or indirectly) references,
+// plus root when changed, children first. Returns the number of objects 
+// committed, or with profile the tree of referenced objects with the time 
+// of each commit.
+static py::object
+commit_changed_objects(OSPObject root, bool profile)
+{
+    ObjectTracker& tracker = object_tracker();
+    CommitProfile res;
+    size_t n = 0;
+    
+    if (!tracker.is_enabled())
+        throw std::runtime_error("change tracking isn't enabled, see track_changes()");
+    
+    // Committing an object marks its users as changed, which are 
+    // visited later
+    for (OSPObject h : tracker.bottom_up(root))
+    {
+        if (tracker.is_dirty(h))
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            ospCommit(h);
+            res.times[h] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            n++;
+        }
+    }
+    
+    if (!profile)
+        return py::int_(n);
+    
+    return commit_profile_node(root, py::none(), py::none(), res);
+}
+
+static py::list
+get_commit_statistics()
+{
+    py::list res;
+    
+    for (const CommitStatistics& cs : object_tracker().commit_statistics())
+    {
+        py::dict d;
+        d["type"] = osp_object_type_name(cs.type);
+        d["subtype"] = cs.subtype;
+        d["handle"] = (size_t)cs.handle;
+        d["primitives"] = cs.primitives;
+        d["commits"] = cs.commits;
+        d["time"] = cs.commit_time;
+        d["total_time"] = cs.total_commit_time;
+        res.append(d);
+    }
+    
+    return res;
+}
+
+static void
+reset_commit_statistics()
+{
+    object_tracker().reset_commit_statistics();
+}
+
+// Commits by default, as changes to the contents of SharedData arrays 
+// can't be tracked. With skip_unchanged the commit is skipped when change
+// tracking is enabled and self didn't change since its last commit. With 
+// profile only self is committed as well, returning the profile tree with
+// the time of this commit. The referenced objects have the time of their 
+// latest commit (when tracking changes).
+template<typename T>
+py::object
+commit_object(const T &self, bool profile, bool skip_unchanged)
+{
+    // Untracked objects count as changed
+    const bool commit = !skip_unchanged || object_tracker().is_dirty(self.handle());
+    
+    if (!profile)
+    {
+        if (commit)
+            self.commit();
+        return py::none();
+    }
+    
+    CommitProfile res;
+    if (commit)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        self.commit();
+        res.times[self.handle()] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+    
+    return commit_profile_node(self.handle(), py::none(), py::none(), res);
+}
+
+template<typename T>
+py::object
+commit_changed(const T &self, bool profile)
+{
+    return commit_changed_objects(self.handle(), profile);
+}
+
 template<typename T>
 void
 declare_managedobject(py::module &m, const char *name)
@@ -963,7 +4604,12 @@ declare_managedobject(py::module &m, const char *name)
         .def("set_param", &set_param_volume<T>)
         .def("set_param", &set_param_volumetric_model<T>)
         .def("remove_param", &remove_param<T>) 
-        .def("commit", &T::commit)
+        .def("commit", &commit_object<T>, py::arg("profile")=false, py::arg("skip_unchanged")=false)
+        .def("commit_changed", &commit_changed<T>, py::arg("profile")=false)
+        .def_property_readonly("dirty", 
+            [](const T& self) {
+                return object_tracker().is_dirty(self.handle());
+            })
         .def("get_bounds", &get_bounds<T>)
         //.def("handle", &get_handle<T>)      // XXX no viable conversion 
         .def("same_handle", &same_handle<T>)
@@ -1024,6 +4670,94 @@ framebuffer_get(ospray::cpp::FrameBuffer &self, OSPFrameBufferChannel channel, p
     return res;
 }
 
+// TransferFunction
+
+static void
+tf_value_range(float *range, const py::object& value_range, const TFControlPoints& cp)
+{
+    if (!value_range.is_none())
+    {
+        py::tuple t = value_range.cast<py::tuple>();
+        if (t.size() != 2)
+            throw std::invalid_argument("value_range needs to be a (min, max) tuple");
+        range[0] = t[0].cast<float>();
+        range[1] = t[1].cast<float>();
+    }
+    else if (cp.has_value_range)
+    {
+        range[0] = cp.value_range[0];
+        range[1] = cp.value_range[1];
+    }
+    else
+    {
+        range[0] = cp.values.front();
+        range[1] = cp.values.back();
+    }
+}
+
+static TFControlPoints
+tf_control_points_from_arrays(
+    const py::array_t<float, py::array::c_style | py::array::forcecast>& values,
+    const py::array_t<float, py::array::c_style | py::array::forcecast>& colors,
+    const py::array_t<float, py::array::c_style | py::array::forcecast>& opacities)
+{
+    const size_t P = values.size();
+
+    if (P == 0)
+        throw std::invalid_argument("need at least 1 transfer function control point");
+    if (colors.ndim() != 2 || (size_t)colors.shape(0) != P || colors.shape(1) != 3)
+        throw std::invalid_argument("colors needs to be an array of shape (N, 3), with N the number of control points");
+    if ((size_t)opacities.size() != P)
+        throw std::invalid_argument("opacities needs to be an array of N values, with N the number of control points");
+
+    TFControlPoints cp;
+    cp.values.assign(values.data(), values.data() + P);
+    cp.colors.assign(colors.data(), colors.data() + 3*P);
+    cp.opacities.assign(opacities.data(), opacities.data() + P);
+
+    return cp;
+}
+
+// Resample the control points into a LUT of the given resolution and set
+// the color, opacity and valueRange parameters in one go
+static void
+tf_set_control_points(ospray::cpp::TransferFunction& self, const TFControlPoints& cp, const py::object& value_range, int resolution)
+{
+    if (resolution < 1)
+        throw std::invalid_argument("resolution needs to be at least 1");
+
+    float range[2];
+    tf_value_range(range, value_range, cp);
+
+    const size_t T = resolution;
+    std::vector<float> tfcolors(3*T);
+    std::vector<float> tfopacities(T);
+
+    resample_tf(cp.values.data(), cp.colors.data(), cp.opacities.data(), cp.size(),
+        range[0], range[1], T, tfcolors.data(), tfopacities.data());
+
+    vec3ul num_items { T, 1, 1 };
+    vec3ul byte_stride { 0, 0, 0 };
+
+    self.setParam("color", ospray::cpp::CopiedData(tfcolors.data(), OSP_VEC3F, num_items, byte_stride));
+    self.setParam("opacity", ospray::cpp::CopiedData(tfopacities.data(), OSP_FLOAT, num_items, byte_stride));
+    self.setParam("valueRange", vec2f(range[0], range[1]));
+}
+
+static py::tuple
+read_trn(const std::string& fname)
+{
+    TFControlPoints cp;
+    read_trn_file(fname, cp);
+
+    const size_t P = cp.size();
+    py::array_t<float> values(P, cp.values.data());
+    py::array_t<float> colors({(ssize_t)P, (ssize_t)3}, cp.colors.data());
+    py::array_t<float> opacities(P, cp.opacities.data());
+
+    return py::make_tuple(values, colors, opacities, py::make_tuple(cp.value_range[0], cp.value_range[1]));
+}
+
 // glm::mat4
 
 glm::mat4
@@ -1107,7 +4841,19 @@ PYBIND11_MODULE(ospray, m)
     });
     */
     
-    m.def("shutdown", &ospShutdown);
+    m.def("shutdown", []() {
+        // Cached and recorded objects need to be released before OSPRay shuts down
+        data_cache.clear();
+        scene_recorder().set_recording(false);
+        ospShutdown();
+    });
+    
+    // Same for scripts that don't call shutdown(), as static destructors 
+    // run too late
+    py::module::import("atexit").attr("register")(py::cpp_function([]() {
+        data_cache.clear();
+        scene_recorder().set_recording(false);
+    }));
         
     declare_managedobject<ManagedCamera>(m, "ManagedCamera");
     declare_managedobject<ManagedData>(m, "ManagedData");
@@ -1147,6 +4893,13 @@ PYBIND11_MODULE(ospray, m)
         .def("set_param", (void (ospray::cpp::Device::*)(const std::string &, const std::string &) const) &ospray::cpp::Device::setParam)
         .def("set_param", &ospray::cpp::Device::setParam<bool>)
         .def("set_param", &ospray::cpp::Device::setParam<int>)
+        .def("set_param", &ospray::cpp::Device::setParam<float>)
+        // E.g. for a device created after init(), such as "mpiDistributed"
+        .def("set_current", [](const ospray::cpp::Device& self) {
+                self.setCurrent();
+                ospDeviceSetErrorCallback(self.handle(), error_func, nullptr);
+                ospDeviceSetStatusCallback(self.handle(), status_func, nullptr);
+            })
         //void set(const std::string &name, void *v) const;
     ;
     
@@ -1169,8 +4922,9 @@ PYBIND11_MODULE(ospray, m)
         .def(py::init<const ospray::cpp::VolumetricModel &>())
         .def(py::init(
             [](py::array& array) {
-                return copied_data_from_numpy_array(array);
+                return cached_copied_data<copied_data_from_numpy_array, 's'>(array);
             }))
+        .def("update", &data_update, py::arg("array"), py::arg("offset")=0)
     ;
 
     py::class_<ospray::cpp::SharedData, ManagedData>(m, "SharedData")
@@ -1218,7 +4972,9 @@ PYBIND11_MODULE(ospray, m)
         .def("cancel", &ospray::cpp::Future::cancel)
         .def("is_ready", &ospray::cpp::Future::isReady, py::arg("event")=OSP_TASK_FINISHED)
         .def("progress", &ospray::cpp::Future::progress)
-        .def("wait", &ospray::cpp::Future::wait, py::arg("event")=OSP_TASK_FINISHED)
+        // Releases the GIL, so other Python threads run during rendering
+        .def("wait", &ospray::cpp::Future::wait, py::arg("event")=OSP_TASK_FINISHED, 
+            py::call_guard<py::gil_scoped_release>())
     ;            
             
     py::class_<ospray::cpp::GeometricModel, ManagedGeometricModel>(m, "GeometricModel")
@@ -1259,12 +5015,90 @@ PYBIND11_MODULE(ospray, m)
 
     py::class_<ospray::cpp::TransferFunction, ManagedTransferFunction>(m, "TransferFunction")
         .def(py::init<const std::string &>())
+        .def_static("from_trn", 
+            [](const std::string& fname, const py::object& value_range, int resolution) {
+                TFControlPoints cp;
+                read_trn_file(fname, cp);
+                ospray::cpp::TransferFunction tf("piecewiseLinear");
+                tf_set_control_points(tf, cp, value_range, resolution);
+                tf.commit();
+                return tf;
+            }, 
+            py::arg("filename"), py::arg("value_range")=py::none(), py::arg("resolution")=256)
+        .def_static("from_control_points", 
+            [](const py::array_t<float, py::array::c_style | py::array::forcecast>& values,
+               const py::array_t<float, py::array::c_style | py::array::forcecast>& colors,
+               const py::array_t<float, py::array::c_style | py::array::forcecast>& opacities,
+               const py::object& value_range, int resolution) {
+                TFControlPoints cp = tf_control_points_from_arrays(values, colors, opacities);
+                ospray::cpp::TransferFunction tf("piecewiseLinear");
+                tf_set_control_points(tf, cp, value_range, resolution);
+                tf.commit();
+                return tf;
+            }, 
+            py::arg("values"), py::arg("colors"), py::arg("opacities"), 
+            py::arg("value_range")=py::none(), py::arg("resolution")=256)
+        .def("set_control_points", 
+            [](ospray::cpp::TransferFunction& self, 
+               const py::array_t<float, py::array::c_style | py::array::forcecast>& values,
+               const py::array_t<float, py::array::c_style | py::array::forcecast>& colors,
+               const py::array_t<float, py::array::c_style | py::array::forcecast>& opacities,
+               const py::object& value_range, int resolution) {
+                tf_set_control_points(self, tf_control_points_from_arrays(values, colors, opacities), value_range, resolution);
+            }, 
+            py::arg("values"), py::arg("colors"), py::arg("opacities"), 
+            py::arg("value_range")=py::none(), py::arg("resolution")=256)
     ;
 
     py::class_<ospray::cpp::Volume, ManagedVolume>(m, "Volume")
         .def(py::init<const std::string &>())
     ;
 
+    py::class_<VolumePyramid>(m, "VolumePyramid")
+        .def(py::init<const py::array&, int, const std::string&, const vec3f&, const vec3f&, unsigned>(),
+            py::arg("array"), py::arg("levels")=0, py::arg("mode")="average", 
+            py::arg("grid_spacing")=vec3f(1, 1, 1), py::arg("grid_origin")=vec3f(0, 0, 0), 
+            py::arg("threads")=0)
+        .def_property_readonly("num_levels", &VolumePyramid::num_levels)
+        .def("dimensions", &VolumePyramid::get_dimensions)
+        .def("grid_spacing", &VolumePyramid::get_grid_spacing)
+        .def("is_ready", &VolumePyramid::is_ready)
+        .def("wait", &VolumePyramid::wait)
+        .def("volume", &VolumePyramid::volume)
+        .def("preview", &VolumePyramid::preview)
+        .def("render_progressive", &VolumePyramid::render_progressive,
+            py::arg("framebuffer"), py::arg("renderer"), py::arg("camera"), py::arg("world"), 
+            py::arg("vmodel"), py::arg("commit")=py::list(), py::arg("frames_per_level")=1, 
+            py::arg("final_frames")=1, py::arg("callback")=py::none())
+    ;
+
+    py::class_<TimeSeriesVolume>(m, "TimeSeriesVolume")
+        .def(py::init([](const py::list& steps, const py::object& dimensions, const py::object& dtype,
+                const std::string& dataset, const vec3f& grid_origin, const vec3f& grid_spacing, 
+                int cache_size, int prefetch, unsigned threads) {
+                return new TimeSeriesVolume(steps, dimensions, dtype, dataset, 
+                    grid_origin, grid_spacing, cache_size, prefetch, threads);
+            }),
+            py::arg("steps"), py::arg("dimensions")=py::none(), py::arg("dtype")=py::none(), 
+            py::arg("dataset")="", py::arg("grid_origin")=vec3f(0, 0, 0), 
+            py::arg("grid_spacing")=vec3f(1, 1, 1), 
+            py::arg("cache_size")=4, py::arg("prefetch")=1, py::arg("threads")=0)
+        .def_property_readonly("num_steps", &TimeSeriesVolume::num_steps)
+        .def_property_readonly("step", &TimeSeriesVolume::get_step)
+        .def_property_readonly("dimensions", &TimeSeriesVolume::get_dimensions)
+        // The volume shares the step buffers and arrays of the time series
+        .def_property_readonly("volume", &TimeSeriesVolume::get_volume, py::keep_alive<0, 1>())
+        .def_property_readonly("cached_steps", &TimeSeriesVolume::cached_steps)
+        .def_property_readonly("statistics", &TimeSeriesVolume::statistics)
+        .def("__len__", &TimeSeriesVolume::num_steps)
+        .def("is_ready", &TimeSeriesVolume::is_ready)
+        .def("set_step", &TimeSeriesVolume::set_step, py::arg("step"), py::arg("commit")=py::list())
+        .def("render_sequence", &TimeSeriesVolume::render_sequence,
+            py::arg("framebuffer"), py::arg("renderer"), py::arg("camera"), py::arg("world"), 
+            py::arg("commit")=py::list(), py::arg("steps")=py::none(), py::arg("frames_per_step")=1, 
+            py::arg("callback")=py::none())
+    ;
+
     py::class_<ospray::cpp::VolumetricModel, ManagedVolumetricModel>(m, "VolumetricModel")
         .def(py::init<const ospray::cpp::Volume &>())
     ;
@@ -1273,6 +5107,44 @@ PYBIND11_MODULE(ospray, m)
         .def(py::init<>())
     ;
     
+    py::class_<QuantizationInfo>(m, "QuantizationInfo")
+        .def_readonly("bits", &QuantizationInfo::bits)
+        .def_property_readonly("value_range", [](const QuantizationInfo& self) {
+                return py::make_tuple(self.lo, self.hi);
+            })
+        .def_readonly("scale", &QuantizationInfo::scale)
+        .def_readonly("offset", &QuantizationInfo::lo)
+        .def_readonly("max_error", &QuantizationInfo::max_error)
+        .def_readonly("rms_error", &QuantizationInfo::rms_error)
+        .def_readonly("clamped", &QuantizationInfo::clamped)
+        .def("quantize", &QuantizationInfo::quantize)
+        .def("dequantize", &QuantizationInfo::dequantize)
+        // Map a value range in original units to quantized units
+        .def("map_range", [](const QuantizationInfo& self, const py::tuple& value_range) {
+                return py::make_tuple(
+                    (value_range[0].cast<double>() - self.lo) * self.scale,
+                    (value_range[1].cast<double>() - self.lo) * self.scale);
+            })
+        // Set valueRange on a transfer function, mapped to quantized units.
+        // Uses the full quantization range if no value range is given.
+        .def("apply", [](const QuantizationInfo& self, ospray::cpp::TransferFunction& tf, const py::object& value_range) {
+                double lo = self.lo, hi = self.hi;
+                if (!value_range.is_none())
+                {
+                    py::tuple t = value_range.cast<py::tuple>();
+                    lo = t[0].cast<double>();
+                    hi = t[1].cast<double>();
+                }
+                tf.setParam("valueRange", vec2f((lo - self.lo) * self.scale, (hi - self.lo) * self.scale));
+            }, py::arg("transfer_function"), py::arg("value_range")=py::none())
+        .def("__repr__", [](const QuantizationInfo& self) {
+                char s[256];
+                snprintf(s, sizeof(s), "<ospray.QuantizationInfo %d bits, range [%g, %g], max error %g, rms error %g>", 
+                    self.bits, self.lo, self.hi, self.max_error, self.rms_error);
+                return std::string(s);
+            })
+    ;
+    
     // Utility
     
     py::class_<glm::mat4>(m, "mat4")      
@@ -1302,14 +5174,179 @@ PYBIND11_MODULE(ospray, m)
         .def("ntransform", mat4_ntransform)
     ;
     
-    m.def("copied_data_constructor", &copied_data_from_numpy_array, py::arg());
-    m.def("copied_data_constructor_vec", &copied_data_from_numpy_array_vec, py::arg());
-    m.def("copied_data_constructor_box", &copied_data_from_numpy_array_box, py::arg());
+    py::class_<CameraPath>(m, "CameraPath")
+        .def(py::init([](const std::string& interpolation) {
+                return new CameraPath(camera_interpolation_from_string(interpolation));
+            }),
+            py::arg("interpolation")="spline")
+        .def_static("orbit", [](const vec3f& center, const vec3f& position, 
+                const vec3f& axis, float degrees, float duration, float fovy, const std::string& interpolation) {
+                CameraPath *path = new CameraPath(camera_interpolation_from_string(interpolation));
+                camera_orbit(*path, glm_vec3(center), glm_vec3(position), 
+                    glm_vec3(axis), degrees, duration, fovy);
+                return path;
+            },
+            py::arg("center"), py::arg("position"), py::arg("axis")=vec3f(0, 0, 1), 
+            py::arg("degrees")=360.0f, py::arg("duration")=1.0f, py::arg("fovy")=45.0f, 
+            py::arg("interpolation")="spline")
+        .def_static("turntable", [](const std::vector<float>& bounds, float elevation, float degrees, float duration, 
+                float fovy, const vec3f& axis, float margin, const std::string& interpolation) {
+                if (bounds.size() != 6)
+                    throw std::invalid_argument("bounds needs to be a (x0, y0, z0, x1, y1, z1) tuple");
+                CameraPath *path = new CameraPath(camera_interpolation_from_string(interpolation));
+                camera_turntable(*path, glm::vec3(bounds[0], bounds[1], bounds[2]), glm::vec3(bounds[3], bounds[4], bounds[5]),
+                    glm_vec3(axis), elevation, degrees, duration, fovy, margin);
+                return path;
+            },
+            py::arg("bounds"), py::arg("elevation")=20.0f, py::arg("degrees")=360.0f, py::arg("duration")=1.0f, 
+            py::arg("fovy")=45.0f, py::arg("axis")=vec3f(0, 0, 1), py::arg("margin")=1.05f,
+            py::arg("interpolation")="spline")
+        .def("add_keyframe", &camera_path_add_keyframe,
+            py::arg("time"), py::arg("position"), py::arg("orientation")=py::none(), py::arg("direction")=py::none(), 
+            py::arg("target")=py::none(), py::arg("up")=vec3f(0, 0, 1), py::arg("fovy")=45.0f)
+        .def("clear", &CameraPath::clear)
+        .def("__len__", &CameraPath::size)
+        .def_property_readonly("num_keyframes", &CameraPath::size)
+        .def_property_readonly("start", &CameraPath::start)
+        .def_property_readonly("end", &CameraPath::end)
+        .def("evaluate", &camera_path_evaluate, py::arg("frames"))
+        .def("apply", &camera_path_apply, py::arg("camera"), py::arg("time"), py::arg("fovy")=true)
+        .def("render", &camera_path_render,
+            py::arg("framebuffer"), py::arg("renderer"), py::arg("camera"), py::arg("world"), py::arg("frames"), 
+            py::arg("samples")=1, py::arg("fovy")=true, py::arg("callback")=py::none())
+    ;
+    
+    m.def("copied_data_constructor", &cached_copied_data<copied_data_from_numpy_array, 's'>, py::arg());
+    m.def("copied_data_constructor_vec", &cached_copied_data<copied_data_from_numpy_array_vec, 'v'>, py::arg());
+    m.def("copied_data_constructor_box", &cached_copied_data<copied_data_from_numpy_array_box, 'b'>, py::arg());
+    
+    m.def("set_data_cache", &set_data_cache, py::arg("max_bytes"), py::arg("threads")=0);
+    m.def("clear_data_cache", &clear_data_cache);
+    m.def("data_cache_stats", &get_data_cache_stats);
+    
+    m.def("track_changes", &track_changes, py::arg("enable")=true);
+    m.def("commit_statistics", &get_commit_statistics);
+    m.def("reset_commit_statistics", &reset_commit_statistics);
 
     m.def("shared_data_constructor", &shared_data_from_numpy_array, py::arg());
     m.def("shared_data_constructor_vec", &shared_data_from_numpy_array_vec, py::arg());
     m.def("shared_data_constructor_box", &shared_data_from_numpy_array_box, py::arg());
     
+    m.def("copied_data_constructor_field", &data_from_record_field<ospray::cpp::CopiedData>, 
+        py::arg("records"), py::arg("fields"));
+    m.def("shared_data_constructor_field", &data_from_record_field<ospray::cpp::SharedData>, 
+        py::arg("records"), py::arg("fields"));
+    
+    m.def("read_trn", &read_trn, py::arg("filename"));
+    
+    m.def("quantize", &quantize, 
+        py::arg("array"), py::arg("bits")=8, py::arg("value_range")=py::none(), py::arg("threads")=0);
+    m.def("copied_data_constructor_quantized", &copied_data_from_numpy_array_quantized, 
+        py::arg("array"), py::arg("bits")=8, py::arg("value_range")=py::none(), py::arg("threads")=0);
+#ifdef HAVE_HDF5
+    m.attr("have_hdf5") = true;
+    m.def("read_hdf5_volume", &read_hdf5_volume, 
+        py::arg("filename"), py::arg("dataset"), py::arg("dtype")=py::none(), 
+        py::arg("start")=py::none(), py::arg("count")=py::none(), py::arg("stride")=py::none());
+#else
+    m.attr("have_hdf5") = false;
+#endif
+    m.def("decimate_mesh", &decimate_mesh, 
+        py::arg("vertices"), py::arg("indices"), py::arg("resolution")=0, py::arg("target_triangles")=0, py::arg("threads")=0);
+    m.def("select_lods", &select_lods, py::arg("lods"), py::arg("budget"));
+    
+    py::class_<MeshLOD>(m, "MeshLOD")
+        .def(py::init<const py::array&, const py::array&, int, float, unsigned>(),
+            py::arg("vertices"), py::arg("indices"), py::arg("levels")=4, py::arg("factor")=4.0f, py::arg("threads")=0)
+        .def_property_readonly("num_levels", &MeshLOD::num_levels)
+        .def_property_readonly("level", &MeshLOD::get_level)
+        .def_property_readonly("group", &MeshLOD::get_group)
+        .def_property_readonly("models", &MeshLOD::get_models)
+        .def_property_readonly("triangle_counts", &MeshLOD::get_triangle_counts)
+        .def("set_level", &MeshLOD::set_level)
+        .def("select", &MeshLOD::select, py::arg("budget"))
+    ;
+    
+    m.def("triangulate_polygons", &triangulate_polygon_mesh, 
+        py::arg("vertices"), py::arg("indices"), py::arg("loop_lengths"), py::arg("threads")=0);
+    m.def("polygon_mesh", &polygon_mesh, 
+        py::arg("vertices"), py::arg("indices"), py::arg("loop_lengths"), py::arg("threads")=0);
+    m.def("subdivision_geometry", &subdivision_geometry, 
+        py::arg("vertices"), py::arg("indices"), py::arg("loop_lengths"), 
+        py::arg("edge_creases")=py::none(), py::arg("edge_crease_weights")=py::none());
+    
+    m.def("load_meshes", &load_meshes, 
+        py::arg("filenames"), py::arg("material")=py::none(), py::arg("threads")=0, py::arg("progress")=py::none());
+    
+    m.def("record_scene", &record_scene, py::arg("enable")=true);
+    m.def("save_scene", &save_scene, py::arg("world"), py::arg("path"));
+    m.def("load_scene", &load_scene, py::arg("path"));
+    
+    py::class_<FrameStreamer>(m, "FrameStreamer")
+        .def(py::init<int, int, int, const std::string&, int, unsigned>(),
+            py::arg("width"), py::arg("height"), py::arg("tile_size")=64, py::arg("encoding")="delta", 
+            py::arg("quality")=85, py::arg("threads")=0)
+        .def("encode", &FrameStreamer::encode, py::arg("framebuffer"))
+        .def("encode_array", &FrameStreamer::encode_array, py::arg("pixels"))
+        .def("send", &FrameStreamer::send, py::arg("framebuffer"), py::arg("socket"))
+        .def("reset", &FrameStreamer::reset)
+        .def_property_readonly("tiles_sent", &FrameStreamer::get_tiles_sent)
+        .def_property_readonly("bytes_sent", &FrameStreamer::get_bytes_sent)
+        .def_property_readonly("num_tiles", &FrameStreamer::get_num_tiles)
+        .def_property_readonly("frame", &FrameStreamer::get_frame)
+    ;
+    m.attr("have_jpeg") = stream_encoding_available(STREAM_JPEG);
+    m.attr("have_webp") = stream_encoding_available(STREAM_WEBP);
+    
+    m.def("brick_grid", &get_brick_grid, py::arg("shape"), py::arg("ranks"));
+    m.def("brick_extent", &get_brick_extent, 
+        py::arg("shape"), py::arg("rank"), py::arg("ranks"), py::arg("ghost")=1,
+        py::arg("grid_origin")=vec3f(0, 0, 0), py::arg("grid_spacing")=vec3f(1, 1, 1));
+    m.def("volume_brick", &volume_brick, 
+        py::arg("array"), py::arg("rank"), py::arg("ranks"), py::arg("ghost")=1,
+        py::arg("grid_origin")=vec3f(0, 0, 0), py::arg("grid_spacing")=vec3f(1, 1, 1),
+        py::arg("threads")=0);
+    
+    m.def("partition_points", &partition_points, py::arg("points"), py::arg("parts")=0, py::arg("threads")=0);
+    m.def("partition_spheres", &partition_spheres, 
+        py::arg("positions"), py::arg("radius")=py::none(), py::arg("colors")=py::none(), 
+        py::arg("parts")=0, py::arg("threads")=0);
+    m.def("partition_mesh", &partition_mesh, 
+        py::arg("vertices"), py::arg("indices"), py::arg("normals")=py::none(), py::arg("colors")=py::none(), 
+        py::arg("texcoords")=py::none(), py::arg("parts")=0, py::arg("threads")=0);
+    m.def("amr_volume", &amr_volume,
+        py::arg("blocks"), py::arg("origins"), py::arg("levels"), py::arg("cell_widths"),
+        py::arg("grid_origin")=vec3f(0, 0, 0), py::arg("grid_spacing")=vec3f(1, 1, 1),
+        py::arg("method")="current", py::arg("share")=false, py::arg("threads")=0);
+    // Shared points and values need to outlive the volume
+    m.def("unstructured_volume", &unstructured_volume,
+        py::arg("points"), py::arg("connectivity"), py::arg("offsets"), py::arg("types"),
+        py::arg("point_values")=py::none(), py::arg("cell_values")=py::none(), py::arg("threads")=0,
+        py::keep_alive<0, 1>(), py::keep_alive<0, 5>(), py::keep_alive<0, 6>());
+    m.def("vdb_volume_from_dense", &vdb_volume_from_dense,
+        py::arg("array"), py::arg("threshold")=py::none(), 
+        py::arg("opacities")=py::none(), py::arg("value_range")=py::none(), py::arg("opacity_threshold")=0.0f,
+        py::arg("grid_spacing")=vec3f(1, 1, 1), py::arg("grid_origin")=vec3f(0, 0, 0),
+        py::arg("threads")=0);
+    m.def("ingest_volume", &ingest_volume, 
+        py::arg("array"), py::arg("axes")=std::vector<int>{0, 1, 2}, py::arg("dtype")=py::none(), py::arg("threads")=0);
+    m.def("downsample", &downsample, py::arg("array"), py::arg("mode")="average", py::arg("threads")=0);
+    m.def("volume_statistics", &volume_statistics, 
+        py::arg("array"), py::arg("bins")=256, py::arg("value_range")=py::none(), 
+        py::arg("percentiles")=std::vector<double>(), py::arg("threads")=0);
+    m.def("copied_data_constructor_stats", 
+        [](const py::array& array, int bins, const py::object& value_range, const std::vector<double>& percentiles, unsigned threads) {
+            return data_with_statistics<ospray::cpp::CopiedData>(array, &copied_data_from_numpy_array, bins, value_range, percentiles, threads);
+        },
+        py::arg("array"), py::arg("bins")=256, py::arg("value_range")=py::none(), 
+        py::arg("percentiles")=std::vector<double>(), py::arg("threads")=0);
+    m.def("shared_data_constructor_stats", 
+        [](const py::array& array, int bins, const py::object& value_range, const std::vector<double>& percentiles, unsigned threads) {
+            return data_with_statistics<ospray::cpp::SharedData>(array, &shared_data_from_numpy_array, bins, value_range, percentiles, threads);
+        },
+        py::arg("array"), py::arg("bins")=256, py::arg("value_range")=py::none(), 
+        py::arg("percentiles")=std::vector<double>(), py::arg("threads")=0);
+    
     // Library version
 
     // Compile-time
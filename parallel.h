@@ -0,0 +1,138 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use, where 0 means one per available core
+inline unsigned
+num_threads(unsigned requested=0)
+{
+    if (requested > 0)
+        return requested;
+
+    const unsigned n = std::thread::hardware_concurrency();
+
+    return n > 0 ? n : 1;
+}
+
+// Number of chunks parallel_for() will split n items into, so callers
+// can set up per-chunk accumulators beforehand
+inline unsigned
+num_chunks(size_t n, unsigned nthreads=0, size_t min_per_chunk=1)
+{
+    if (n == 0)
+        return 0;
+
+    size_t chunks = num_threads(nthreads);
+
+    if (min_per_chunk > 0)
+        chunks = std::min(chunks, (n + min_per_chunk - 1) / min_per_chunk);
+
+    return (unsigned)std::max(chunks, (size_t)1);
+}
+
+// Split [0, n) into contiguous ranges and call func(begin, end, chunk)
+// for each of them on a separate thread. The calling thread processes
+// the first chunk. An exception thrown by func is rethrown here, after
+// all threads have finished.
+//
+// Note: func must not touch Python objects, as the GIL is not held by
+// the worker threads.
+template<typename F>
+void
+parallel_for(size_t n, F func, unsigned nthreads=0, size_t min_per_chunk=1)
+{
+    const unsigned chunks = num_chunks(n, nthreads, min_per_chunk);
+
+    if (chunks == 0)
+        return;
+
+    if (chunks == 1)
+    {
+        func((size_t)0, n, 0u);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(chunks);
+    const size_t per_chunk = n / chunks;
+    const size_t remainder = n % chunks;
+
+    // Chunk c covers [start(c), start(c+1))
+    auto start = [per_chunk, remainder](unsigned c) {
+        return c*per_chunk + std::min((size_t)c, remainder);
+    };
+
+    auto run = [&](unsigned c) {
+        try
+        {
+            func(start(c), start(c+1), c);
+        }
+        catch (...)
+        {
+            errors[c] = std::current_exception();
+        }
+    };
+
+    for (unsigned c = 1; c < chunks; c++)
+        threads.push_back(std::thread(run, c));
+
+    run(0);
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    for (unsigned c = 0; c < chunks; c++)
+    {
+        if (errors[c])
+            std::rethrow_exception(errors[c]);
+    }
+}
+
+// Sort [first, first+n) using multiple threads: chunks are sorted in
+// parallel, after which pairs of sorted runs are merged, again in
+// parallel, until a single run remains.
+template<typename T, typename Compare>
+void
+parallel_sort(T *first, size_t n, Compare comp, unsigned nthreads=0, size_t min_per_chunk=1 << 16)
+{
+    const unsigned chunks = num_chunks(n, nthreads, min_per_chunk);
+
+    if (chunks <= 1)
+    {
+        std::sort(first, first + n, comp);
+        return;
+    }
+
+    // Run boundaries, same split as parallel_for()
+    std::vector<size_t> bounds(chunks + 1);
+    for (unsigned c = 0; c <= chunks; c++)
+        bounds[c] = c*(n / chunks) + std::min((size_t)c, n % chunks);
+
+    parallel_for(chunks, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t c = begin; c < end; c++)
+            std::sort(first + bounds[c], first + bounds[c+1], comp);
+    }, chunks);
+
+    while (bounds.size() > 2)
+    {
+        const size_t runs = bounds.size() - 1;
+        const size_t pairs = runs / 2;
+
+        parallel_for(pairs, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+            for (size_t p = begin; p < end; p++)
+                std::inplace_merge(first + bounds[2*p], first + bounds[2*p+1], first + bounds[2*p+2], comp);
+        }, (unsigned)pairs);
+
+        std::vector<size_t> merged;
+        for (size_t r = 0; r < runs; r += 2)
+            merged.push_back(bounds[r]);
+        merged.push_back(n);
+        bounds.swap(merged);
+    }
+}
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "parallel.h"
+
+// Spatial partitioning of primitives into a number of coherent parts,
+// based on the Morton order of the primitive centers. Instead of sorting
+// all Morton codes, primitives are ordered by 32^3 Morton-ordered buckets
+// with a stable counting sort. Buckets holding too many primitives (as 
+// with clustered data) are refined the same way, using the bounds of their
+// own primitives, up to PARTITION_MAX_DEPTH levels. Consecutive buckets 
+// are then assigned to parts so that each part gets roughly the same 
+// number of primitives. Each level is O(N).
+
+const size_t PARTITION_MIN_PER_THREAD = 1 << 16;
+const int PARTITION_BUCKET_BITS = 5;
+const size_t PARTITION_NUM_BUCKETS = (size_t)1 << (3*PARTITION_BUCKET_BITS);
+const int PARTITION_MAX_DEPTH = 4;
+
+// Spread the lower bits of v, so that there's two 0 bits between each bit
+inline uint32_t
+spread_bits(uint32_t v)
+{
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+inline uint32_t
+morton_code(uint32_t x, uint32_t y, uint32_t z)
+{
+    return spread_bits(x) | (spread_bits(y) << 1) | (spread_bits(z) << 2);
+}
+
+// Order the primitives items[0..n) by Morton bucket, using tmp[0..n) as
+// scratch space. Buckets with more than max_bucket primitives are sorted
+// further, one level deeper. The positions (offset by base) where each
+// of the resulting buckets starts are appended to cuts, in order.
+template<typename I, typename F>
+void
+morton_sort(I *items, I *tmp, size_t n, F point, size_t max_bucket, int depth, unsigned nthreads,
+    size_t base, std::vector<size_t>& cuts)
+{
+    const unsigned chunks = num_chunks(n, nthreads, PARTITION_MIN_PER_THREAD);
+
+    // Bounding box of the primitive centers
+    std::vector<float> chunk_bounds(6*chunks);
+
+    parallel_for(n, [&](size_t begin, size_t end, unsigned chunk) {
+        float lo[3], hi[3], p[3];
+        for (int d = 0; d < 3; d++)
+        {
+            lo[d] = std::numeric_limits<float>::max();
+            hi[d] = -std::numeric_limits<float>::max();
+        }
+        for (size_t i = begin; i < end; i++)
+        {
+            point(items[i], p);
+            for (int d = 0; d < 3; d++)
+            {
+                lo[d] = std::min(lo[d], p[d]);
+                hi[d] = std::max(hi[d], p[d]);
+            }
+        }
+        std::copy(lo, lo+3, &chunk_bounds[6*chunk]);
+        std::copy(hi, hi+3, &chunk_bounds[6*chunk+3]);
+    }, nthreads, PARTITION_MIN_PER_THREAD);
+
+    float lo[3], scale[3];
+    bool single_point = true;
+    for (int d = 0; d < 3; d++)
+    {
+        float hi = chunk_bounds[3+d];
+        lo[d] = chunk_bounds[d];
+        for (unsigned c = 1; c < chunks; c++)
+        {
+            lo[d] = std::min(lo[d], chunk_bounds[6*c+d]);
+            hi = std::max(hi, chunk_bounds[6*c+3+d]);
+        }
+        scale[d] = hi > lo[d] ? (1 << PARTITION_BUCKET_BITS) / (hi - lo[d]) : 0.0f;
+        single_point = single_point && scale[d] == 0.0f;
+    }
+
+    // All centers equal, nothing to order
+    if (single_point)
+    {
+        cuts.push_back(base);
+        return;
+    }
+
+    // Bucket per primitive, plus per-chunk bucket counts
+    const uint32_t maxcell = (1 << PARTITION_BUCKET_BITS) - 1;
+    std::vector<uint16_t> bucket(n);
+    std::vector<size_t> counts(chunks*PARTITION_NUM_BUCKETS, 0);
+
+    parallel_for(n, [&](size_t begin, size_t end, unsigned chunk) {
+        size_t *count = &counts[chunk*PARTITION_NUM_BUCKETS];
+        float p[3];
+        uint32_t c[3];
+        for (size_t i = begin; i < end; i++)
+        {
+            point(items[i], p);
+            for (int d = 0; d < 3; d++)
+                c[d] = std::min((uint32_t)((p[d] - lo[d]) * scale[d]), maxcell);
+            const uint32_t b = morton_code(c[0], c[1], c[2]);
+            bucket[i] = (uint16_t)b;
+            count[b]++;
+        }
+    }, nthreads, PARTITION_MIN_PER_THREAD);
+
+    // Turn the counts into the start position of each (chunk, bucket), 
+    // with the chunks of a bucket consecutive, so that the scatter below
+    // is stable and needs no synchronization
+    std::vector<size_t> bucket_start(PARTITION_NUM_BUCKETS + 1);
+    size_t pos = 0;
+    for (size_t b = 0; b < PARTITION_NUM_BUCKETS; b++)
+    {
+        bucket_start[b] = pos;
+        for (unsigned c = 0; c < chunks; c++)
+        {
+            const size_t count = counts[c*PARTITION_NUM_BUCKETS + b];
+            counts[c*PARTITION_NUM_BUCKETS + b] = pos;
+            pos += count;
+        }
+    }
+    bucket_start[PARTITION_NUM_BUCKETS] = pos;
+
+    // Same chunking as above, as n, nthreads and the minimum are the same
+    parallel_for(n, [&](size_t begin, size_t end, unsigned chunk) {
+        size_t *next = &counts[chunk*PARTITION_NUM_BUCKETS];
+        for (size_t i = begin; i < end; i++)
+            tmp[next[bucket[i]]++] = items[i];
+    }, nthreads, PARTITION_MIN_PER_THREAD);
+
+    parallel_for(n, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+        std::copy(tmp + begin, tmp + end, items + begin);
+    }, nthreads, PARTITION_MIN_PER_THREAD);
+
+    for (size_t b = 0; b < PARTITION_NUM_BUCKETS; b++)
+    {
+        const size_t first = bucket_start[b];
+        const size_t count = bucket_start[b+1] - first;
+
+        if (count == 0)
+            continue;
+
+        if (count > max_bucket && depth + 1 < PARTITION_MAX_DEPTH)
+            morton_sort(items + first, tmp + first, count, point, max_bucket, depth + 1, nthreads, base + first, cuts);
+        else
+            cuts.push_back(base + first);
+    }
+}
+
+// Split primitives [0, n) into parts, where point(i, p) stores the center of
+// primitive i in p[3]. On return order holds the primitive indices, ordered
+// by part, with part k occupying order[offsets[k]] to order[offsets[k+1]].
+// Parts can be empty when there's fewer (refined) buckets than parts.
+template<typename I, typename F>
+void
+morton_partition(size_t n, F point, unsigned parts, unsigned nthreads,
+    std::vector<I>& order, std::vector<size_t>& offsets)
+{
+    parts = std::max(parts, 1u);
+    order.resize(n);
+    offsets.assign(parts + 1, n);
+    offsets[0] = 0;
+
+    if (n == 0)
+        return;
+
+    I *items = order.data();
+    parallel_for(n, [items](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t i = begin; i < end; i++)
+            items[i] = (I)i;
+    }, nthreads, PARTITION_MIN_PER_THREAD);
+
+    // Buckets are refined when holding more than a quarter of a part's 
+    // share, so that they don't unbalance the parts much
+    const size_t max_bucket = std::max(n / (4*(size_t)parts), (size_t)1);
+    std::vector<I> tmp(n);
+    std::vector<size_t> cuts;
+
+    morton_sort(items, tmp.data(), n, point, max_bucket, 0, nthreads, 0, cuts);
+
+    // Assign consecutive buckets to parts, based on the part containing 
+    // the middle of each bucket's range. Parts are non-decreasing along
+    // the buckets, so each part starts at the first bucket assigned to it.
+    unsigned part = 0;
+    for (size_t j = 0; j < cuts.size(); j++)
+    {
+        const size_t end = j + 1 < cuts.size() ? cuts[j+1] : n;
+        const unsigned k = (unsigned)std::min((size_t)parts - 1, (cuts[j] + end) / 2 * parts / n);
+
+        for (; part < k; part++)
+            offsets[part+1] = cuts[j];
+    }
+}
+
+// dst[i] = src[order[i]] for n rows of ncomp values each
+template<typename T, typename I>
+void
+gather_rows(const T *src, size_t ncomp, const I *order, size_t n, T *dst, unsigned nthreads=0)
+{
+    parallel_for(n, [=](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const T *row = src + (size_t)order[i]*ncomp;
+            std::copy(row, row + ncomp, dst + i*ncomp);
+        }
+    }, nthreads, PARTITION_MIN_PER_THREAD);
+}
+
+// Part of a mesh: the original indices of the vertices it uses (ascending)
+// plus its faces, indexing into those vertices
+struct MeshPart
+{
+    std::vector<uint32_t>   vertices;
+    std::vector<uint32_t>   indices;
+};
+
+// Build a mesh part from the faces listed in faces[0..nfaces), each with
+// vpf (3 or 4) indices into the full mesh's vertices
+template<typename I>
+void
+build_mesh_part(const uint32_t *indices, unsigned vpf, const I *faces, size_t nfaces, MeshPart& part)
+{
+    part.indices.resize(nfaces*vpf);
+    for (size_t f = 0; f < nfaces; f++)
+    {
+        const uint32_t *face = indices + (size_t)faces[f]*vpf;
+        std::copy(face, face + vpf, &part.indices[f*vpf]);
+    }
+
+    part.vertices = part.indices;
+    std::sort(part.vertices.begin(), part.vertices.end());
+    part.vertices.erase(std::unique(part.vertices.begin(), part.vertices.end()), part.vertices.end());
+
+    for (size_t i = 0; i < part.indices.size(); i++)
+        part.indices[i] = (uint32_t)(std::lower_bound(part.vertices.begin(), part.vertices.end(), part.indices[i]) - part.vertices.begin());
+}
+
+#endif
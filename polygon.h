@@ -0,0 +1,177 @@
+#ifndef POLYGON_H
+#define POLYGON_H
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "parallel.h"
+
+// Conversion of polygon meshes, given as a flat list of vertex indices
+// plus the number of vertices (loop length) of each face
+
+const size_t POLYGON_MIN_PER_THREAD = 1 << 14;
+
+// Check the face description and compute the start of each face in
+// indices (starts needs room for nfaces+1 values). Throws on invalid input.
+inline void
+polygon_starts(const uint32_t *indices, size_t nindices, const uint32_t *loop_lengths, size_t nfaces,
+    size_t nverts, std::vector<size_t>& starts)
+{
+    starts.resize(nfaces + 1);
+    starts[0] = 0;
+
+    for (size_t f = 0; f < nfaces; f++)
+    {
+        if (loop_lengths[f] < 3)
+            throw std::invalid_argument("face " + std::to_string(f) + " has less than 3 vertices");
+        starts[f+1] = starts[f] + loop_lengths[f];
+    }
+
+    if (starts[nfaces] != nindices)
+        throw std::invalid_argument("sum of loop lengths (" + std::to_string(starts[nfaces]) +
+            ") does not match the number of indices (" + std::to_string(nindices) + ")");
+
+    for (size_t i = 0; i < nindices; i++)
+    {
+        if (indices[i] >= nverts)
+            throw std::invalid_argument("vertex index " + std::to_string(indices[i]) + " at position " +
+                std::to_string(i) + " out of range");
+    }
+}
+
+// Triangulate a single polygon with n vertices by ear clipping, which
+// handles concave (but not self-intersecting) polygons. The polygon is
+// projected onto the plane of its dominant normal axis. Writes n-2
+// triangles to out, with the same orientation as the polygon. Degenerate
+// polygons, for which no more ears can be found, are completed as a fan.
+inline void
+triangulate_polygon(const float *verts, const uint32_t *idx, uint32_t n, uint32_t *out,
+    std::vector<uint32_t>& remaining, std::vector<float>& pts)
+{
+    if (n == 3)
+    {
+        out[0] = idx[0]; out[1] = idx[1]; out[2] = idx[2];
+        return;
+    }
+
+    // Newell normal
+    double normal[3] = { 0.0, 0.0, 0.0 };
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const float *a = verts + 3*(size_t)idx[i];
+        const float *b = verts + 3*(size_t)idx[(i+1) % n];
+        normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+        normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+        normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+    }
+
+    int axis = 0;
+    if (std::fabs(normal[1]) > std::fabs(normal[axis])) axis = 1;
+    if (std::fabs(normal[2]) > std::fabs(normal[axis])) axis = 2;
+
+    // 2D coordinates, oriented so that the polygon is counter-clockwise
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    if (normal[axis] < 0.0)
+        std::swap(u, v);
+
+    pts.resize(2*n);
+    remaining.resize(n);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const float *p = verts + 3*(size_t)idx[i];
+        pts[2*i+0] = p[u];
+        pts[2*i+1] = p[v];
+        remaining[i] = i;
+    }
+
+    auto cross = [&](uint32_t a, uint32_t b, uint32_t c) {
+        return (double)(pts[2*b] - pts[2*a]) * (pts[2*c+1] - pts[2*a+1]) -
+               (double)(pts[2*b+1] - pts[2*a+1]) * (pts[2*c] - pts[2*a]);
+    };
+
+    uint32_t m = n, i = 0, failed = 0;
+
+    while (m > 3)
+    {
+        const uint32_t p = remaining[(i + m - 1) % m], c = remaining[i], q = remaining[(i + 1) % m];
+        bool ear = cross(p, c, q) > 0.0;
+
+        for (uint32_t j = 0; ear && j < m; j++)
+        {
+            const uint32_t r = remaining[j];
+            if (r == p || r == c || r == q)
+                continue;
+            // Inside (or on the border of) triangle p, c, q
+            if (cross(p, c, r) >= 0.0 && cross(c, q, r) >= 0.0 && cross(q, p, r) >= 0.0)
+                ear = false;
+        }
+
+        // No ear found in a full pass, so clip anyway to make progress
+        if (ear || failed >= m)
+        {
+            out[0] = idx[p]; out[1] = idx[c]; out[2] = idx[q];
+            out += 3;
+            remaining.erase(remaining.begin() + i);
+            m--;
+            failed = 0;
+            if (i >= m)
+                i = 0;
+        }
+        else
+        {
+            failed++;
+            i = (i + 1) % m;
+        }
+    }
+
+    out[0] = idx[remaining[0]]; out[1] = idx[remaining[1]]; out[2] = idx[remaining[2]];
+}
+
+// Triangulate all faces, in parallel. Output has (loop_length-2) triangles
+// per face, in face order.
+inline void
+triangulate_polygons(const float *verts, const uint32_t *indices, const uint32_t *loop_lengths, size_t nfaces,
+    const std::vector<size_t>& starts, unsigned nthreads, std::vector<uint32_t>& triangles)
+{
+    // Output position of each face's triangles
+    std::vector<size_t> tri_starts(nfaces + 1);
+    tri_starts[0] = 0;
+    for (size_t f = 0; f < nfaces; f++)
+        tri_starts[f+1] = tri_starts[f] + loop_lengths[f] - 2;
+
+    triangles.resize(3*tri_starts[nfaces]);
+    uint32_t *out = triangles.data();
+
+    parallel_for(nfaces, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+        std::vector<uint32_t> remaining;
+        std::vector<float> pts;
+        for (size_t f = begin; f < end; f++)
+            triangulate_polygon(verts, indices + starts[f], loop_lengths[f], out + 3*tri_starts[f], remaining, pts);
+    }, nthreads, POLYGON_MIN_PER_THREAD);
+}
+
+// Mixed triangles and quads to all quads, by repeating the last index of
+// each triangle (which OSPRay's mesh geometry treats as a triangle)
+inline void
+quads_from_tris_and_quads(const uint32_t *indices, const uint32_t *loop_lengths, size_t nfaces,
+    const std::vector<size_t>& starts, unsigned nthreads, std::vector<uint32_t>& quads)
+{
+    quads.resize(4*nfaces);
+    uint32_t *out = quads.data();
+
+    parallel_for(nfaces, [=, &starts](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t f = begin; f < end; f++)
+        {
+            const uint32_t *face = indices + starts[f];
+            uint32_t *q = out + 4*f;
+            q[0] = face[0];
+            q[1] = face[1];
+            q[2] = face[2];
+            q[3] = loop_lengths[f] == 4 ? face[3] : face[2];
+        }
+    }, nthreads, POLYGON_MIN_PER_THREAD);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#!/usr/bin/env python
+# Profile of the commits of a scene, to find the groups or geometries
+# that take the most time to build.
+#
+# ./samples/commitprofile.py [-g groups] [-n spheres] [-d depth]
+#
+# Builds a world of instances of groups of random spheres, with group i
+# holding n*2^i spheres, and commits it in one go with profiling. Prints
+# the tree of the objects the world references with the time of each
+# commit (* marks the objects committed by the call), then updates the 
+# positions of one group and profiles again, which only commits the 
+# objects affected. Finally profiles a plain world commit, which shows
+# the latest commit times of the referenced objects.
+import sys, os, getopt
+scriptdir = os.path.split(__file__)[0]
+sys.path.insert(0, os.path.join(scriptdir, '..'))
+
+import numpy
+import ospray
+
+num_groups = 4
+N = 100000
+max_depth = 8
+
+argv = ospray.init(sys.argv)
+ospray.track_changes()
+
+optlist, args = getopt.getopt(argv[1:], 'd:g:n:')
+for o, a in optlist:
+    if o == '-d':
+        max_depth = int(a)
+    elif o == '-g':
+        num_groups = int(a)
+    elif o == '-n':
+        N = int(a)
+
+
+def print_node(node, depth=0):
+    name = node['type']
+    if node['subtype']:
+        name += ' ' + node['subtype']
+    if node['param'] is not None:
+        param = node['param'] if node['index'] is None else '%s[%d]' % (node['param'], node['index'])
+        name = '%s: %s' % (param, name)
+    if node['repeated']:
+        name += ' (repeated)'
+    if node['committed']:
+        name += ' *'
+    print('%-50s %12d %10.3f %10.3f' % ('  '*depth + name, node['primitives'], node['time']*1000,
+        node['total_time']*1000))
+    if depth < max_depth:
+        for child in node['children']:
+            print_node(child, depth+1)
+
+
+def print_tree(tree):
+    print('%-50s %12s %10s %10s' % ('object', 'primitives', 'ms', 'total ms'))
+    print_node(tree)
+    print()
+
+
+# Nothing is committed explicitly, world.commit_changed(profile=True) 
+# commits everything that changed
+positions = []
+instances = []
+for i in range(num_groups):
+    n = N * 2**i
+    positions.append(ospray.copied_data_constructor_vec(numpy.random.rand(n, 3).astype(numpy.float32)))
+
+    spheres = ospray.Geometry('sphere')
+    spheres.set_param('sphere.position', positions[-1])
+    spheres.set_param('radius', 0.5 / n**(1/3))
+
+    gmodel = ospray.GeometricModel(spheres)
+    group = ospray.Group()
+    group.set_param('geometry', [gmodel])
+
+    instance = ospray.Instance(group)
+    instance.set_param('transform', ospray.mat4.translate(1.2*i, 0.0, 0.0))
+    instances.append(instance)
+
+world = ospray.World()
+world.set_param('instance', instances)
+
+print_tree(world.commit_changed(profile=True))
+
+# Move the spheres of the first group
+i = 0
+positions[i].update(numpy.random.rand(N * 2**i, 3).astype(numpy.float32))
+print_tree(world.commit_changed(profile=True))
+
+print('Unchanged world, objects committed: %d' % world.commit_changed())
+print()
+
+print_tree(world.commit(profile=True))
+
+print('%-30s %16s %12s %8s %10s' % ('object', 'handle', 'primitives', 'commits', 'total ms'))
+for s in ospray.commit_statistics():
+    name = s['type'] + (' ' + s['subtype'] if s['subtype'] else '')
+    print('%-30s %16x %12d %8d %10.3f' % (name, s['handle'], s['primitives'], s['commits'], s['total_time']*1000))
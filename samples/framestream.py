@@ -0,0 +1,133 @@
+#!/usr/bin/env python
+# Progressive rendering streamed as tiles over a socket, with FrameStreamer.
+#
+# ./samples/framestream.py [-a address] [-e encoding] [-f frames] [-t tile_size] file.ply|file.stl
+# ./samples/framestream.py -r [-a address]
+#
+# The first form renders the file with accumulation and streams each
+# frame (only the tiles that changed) to whoever connects to the address,
+# unix:/path/to/socket or host:port. The second form is a minimal
+# receiver, which parses the messages and reports tiles and bytes per frame.
+import sys, os, getopt, socket, struct, time
+scriptdir = os.path.split(__file__)[0]
+sys.path.insert(0, os.path.join(scriptdir, '..'))
+sys.path.insert(0, scriptdir)
+
+from renderclient import parse_address, recv_exact
+
+W = 1024
+H = 768
+
+address = 'unix:/tmp/ospray-framestream.sock'
+encoding = 'delta'
+frames = 32
+tile_size = 64
+receive = False
+
+optlist, args = getopt.getopt(sys.argv[1:], 'a:e:f:rt:')
+for o, a in optlist:
+    if o == '-a':
+        address = a
+    elif o == '-e':
+        encoding = a
+    elif o == '-f':
+        frames = int(a)
+    elif o == '-r':
+        receive = True
+    elif o == '-t':
+        tile_size = int(a)
+
+family, addr = parse_address(address)
+
+if receive:
+    sock = socket.socket(family, socket.SOCK_STREAM)
+    sock.connect(addr)
+    encodings = ['raw', 'delta', 'jpeg', 'webp']
+    total = 0
+    t0 = time.time()
+    while True:
+        try:
+            header = recv_exact(sock, 20)
+        except ConnectionError:
+            break
+        magic, frame, width, height, tsize, _, ntiles = struct.unpack('<4sIHHHHI', header)
+        assert magic == b'OSPF'
+        nbytes = 20
+        used = set()
+        for i in range(ntiles):
+            tx, ty, enc, _, size = struct.unpack('<HHBBI', recv_exact(sock, 10))
+            recv_exact(sock, size)
+            nbytes += 10 + size
+            used.add(encodings[enc])
+        total += nbytes
+        print('frame %3d: %4d tiles, %9d bytes %s' % (frame, ntiles, nbytes, ','.join(sorted(used))))
+    print('%d bytes in %.3fs' % (total, time.time()-t0))
+    sys.exit(0)
+
+import ospray
+
+argv = ospray.init(sys.argv)
+
+if len(args) != 1:
+    print('Usage: %s [-a address] [-e encoding] [-f frames] [-t tile_size] file.ply|file.stl' % sys.argv[0])
+    print('       %s -r [-a address]' % sys.argv[0])
+    sys.exit(-1)
+
+group = ospray.load_meshes(args)
+instance = ospray.Instance(group)
+instance.commit()
+
+light = ospray.Light('ambient')
+light.commit()
+
+world = ospray.World()
+world.set_param('instance', [instance])
+world.set_param('light', [light])
+world.commit()
+
+bound = world.get_bounds()
+center = tuple(0.5*(bound[i] + bound[i+3]) for i in range(3))
+size = max(bound[i+3] - bound[i] for i in range(3))
+position = (center[0] - size, center[1] - size, center[2] + size)
+
+camera = ospray.Camera('perspective')
+camera.set_param('aspect', W/H)
+camera.set_param('position', position)
+camera.set_param('direction', tuple(center[i] - position[i] for i in range(3)))
+camera.set_param('up', (0.0, 0.0, 1.0))
+camera.commit()
+
+renderer = ospray.Renderer('pathtracer')
+renderer.set_param('backgroundColor', (1.0, 1.0, 1.0, 1.0))
+renderer.commit()
+
+framebuffer = ospray.FrameBuffer(W, H, ospray.OSP_FB_SRGBA,
+    int(ospray.OSP_FB_COLOR) | int(ospray.OSP_FB_ACCUM))
+
+streamer = ospray.FrameStreamer(W, H, tile_size=tile_size, encoding=encoding)
+
+if family == socket.AF_UNIX and os.path.exists(addr):
+    os.unlink(addr)
+server = socket.socket(family, socket.SOCK_STREAM)
+server.bind(addr)
+server.listen(1)
+print('Waiting for receiver on %s' % address)
+conn, _ = server.accept()
+
+framebuffer.clear()
+t0 = time.time()
+total = 0
+for frame in range(frames):
+    framebuffer.render_frame(renderer, camera, world).wait()
+    # Encoded (on multiple threads) and written without going through Python
+    total += streamer.send(framebuffer, conn)
+    print('frame %3d: %4d/%d tiles, %9d bytes' % (frame, streamer.tiles_sent, streamer.num_tiles, streamer.bytes_sent))
+
+t1 = time.time()
+conn.close()
+server.close()
+if family == socket.AF_UNIX:
+    os.unlink(addr)
+
+print('%d frames, %d bytes (%.1f%% of raw frames) in %.3fs' %
+    (frames, total, 100.0*total/(frames*W*H*4), t1-t0))
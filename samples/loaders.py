@@ -19,8 +19,7 @@ def determine_mesh_type(face_lengths):
     
     minn, maxn = numpy.min(face_lengths), numpy.max(face_lengths)
     
-    if minn == maxn:
-        assert minn in [3,4]
+    if minn == maxn and minn in [3,4]:
         mesh_type = 'pure-triangle' if minn == 3 else 'pure-quad'
     elif minn == 3 and maxn == 4:
         mesh_type = 'mixed-tris-and-quads'
@@ -59,12 +58,9 @@ def read_stl(fname, force_subdivision_mesh=False):
             mesh.set_param('vertex.position', ospray.copied_data_constructor_vec(vertices))        
             mesh.set_param('vertex.normal', ospray.copied_data_constructor_vec(normals))        
             mesh.set_param('index', ospray.copied_data_constructor_vec(indices.reshape((-1, 3))))        
-        # XXX borked
-        #else:
-        #    mesh = ospray.Geometry('subdivision')
-        #    mesh.set_param('vertex.position', ospray.copied_data_constructor_vec(vertices))        
-        #    mesh.set_param('index', ospray.copied_data_constructor(indices))            
-        #    mesh.set_param('face', numpy.repeat(3, num_triangles*3).astype('uint32'))
+        else:
+            loop_lengths = numpy.full(num_triangles, 3, dtype='uint32')
+            mesh = ospray.subdivision_geometry(vertices, indices, loop_lengths)
             
         mesh.commit()
         
@@ -94,39 +90,14 @@ def read_ply(fname, force_subdivision_mesh=False):
 
     indices = plymesh['faces']
 
-    if mesh_type.startswith('pure-') and not force_subdivision_mesh:
-        mesh = ospray.Geometry('mesh')
-        indices = indices.reshape((-1, minn))
-        mesh.set_param('index', ospray.copied_data_constructor_vec(indices))
-        # Get a OSPRAY STATUS: ospray::Mesh ignoring 'index' array with wrong element type (should be vec3ui)
-        # when passing a pure-quad index array
+    if force_subdivision_mesh:
+        mesh = ospray.subdivision_geometry(vertices, indices, loop_length)
+    else:
+        # Triangles and/or quads are used as is, other polygons get triangulated
+        mesh = ospray.polygon_mesh(vertices, indices, loop_length)
         if 'normals' in plymesh:
             normals = plymesh['normals'].reshape((-1, 3))
             mesh.set_param('vertex.normal', ospray.copied_data_constructor_vec(normals))
-        
-    elif mesh_type == 'mixed-tris-and-quads' and not force_subdivision_mesh:
-        mesh = ospray.Geometry('mesh')
-        
-        # Duplicate last index of triangles to get all quads
-        new_indices = []
-        first = 0
-        for n in loop_length:
-            if n == 3:
-                new_indices.extend(indices[first:first+3])
-                new_indices.append(indices[first+2])
-            else:
-                new_indices.extend(indices[first:first+4])
-            first += n
-            
-        new_indices = numpy.array(new_indices, dtype=numpy.uint32).reshape((-1, 4))
-        mesh.set_param('index', ospray.copied_data_constructor_vec(new_indices))
-    else:
-        # Use subdivision surface
-        mesh = ospray.Geometry('subdivision')
-        mesh.set_param('index', ospray.copied_data_constructor(indices))
-        mesh.set_param('face', loop_length)
-        
-    mesh.set_param('vertex.position', ospray.copied_data_constructor_vec(vertices))
 
     if 'vertex_colors' in plymesh:
         print('Have vertex colors')
@@ -177,33 +148,10 @@ def read_obj(fname, force_subdivision_mesh=False):
         
         print('%s (%s): %d faces' % (s.name, mesh_type, face_lengths.shape[0]))
         
-        if mesh_type.startswith('pure-') and not force_subdivision_mesh:
-            mesh = ospray.Geometry('mesh')
-            vertex_indices = vertex_indices.reshape((-1, minn)).astype('uint32')
-            mesh.set_param('index', ospray.copied_data_constructor_vec(vertex_indices))
-        elif mesh_type == 'mixed-tris-and-quads' and not force_subdivision_mesh:
-            mesh = ospray.Geometry('mesh')
-            
-            # Duplicate last index of triangles to get all quads
-            new_indices = []
-            first = 0
-            for n in loop_length:
-                if n == 3:
-                    new_indices.extend(vertex_indices[first:first+3])
-                    new_indices.append(vertex_indices[first+2])
-                else:
-                    new_indices.extend(vertex_indices[first:first+4])
-                first += n
-                
-            new_indices = numpy.array(new_indices, dtype=numpy.uint32).reshape((-1, 4))    
-            mesh.set_param('index', ospray.copied_data_constructor_vec(new_indices))
+        if force_subdivision_mesh:
+            mesh = ospray.subdivision_geometry(vertices, vertex_indices, face_lengths)
         else:
-            # Use subdivision surface
-            mesh = ospray.Geometry('subdivision')
-            mesh.set_param('index', ospray.copied_data_constructor(vertex_indices))
-            mesh.set_param('face', face_lengths)
-            
-        mesh.set_param('vertex.position', ospray.copied_data_constructor_vec(vertices))
+            mesh = ospray.polygon_mesh(vertices, vertex_indices, face_lengths)
         
         mesh.commit()
         
@@ -0,0 +1,178 @@
+#!/usr/bin/env python
+# Data-parallel volume rendering with OSPRay's MPI module, with sort-last
+# compositing by the distributed framebuffer.
+#
+# mpirun -np 4 ./samples/mpivolume.py [-m strong|weak] [-n size] [-f frames] [-o image.png]
+# ./samples/mpivolume.py -s [-n size] [-p 1,2,4]
+#
+# Each rank only creates its own brick of a synthetic volume (see
+# ospray.brick_extent()) and declares the region it owns, so no rank ever
+# holds the whole volume. With -m strong the volume is size^3 voxels for
+# any number of ranks, with -m weak each rank gets a size^3 brick.
+# The second form runs both modes through mpirun for each process count
+# and prints a table of the time per frame (rank 0) and the speedup.
+#
+# Needs OSPRay built with its MPI module (libospray_module_mpi).
+import sys, os, getopt, time, math, subprocess
+scriptdir = os.path.split(__file__)[0]
+sys.path.insert(0, os.path.join(scriptdir, '..'))
+
+import numpy
+
+W, H = 1024, 768
+N = 256
+mode = 'strong'
+frames = 10
+output = None
+scaling = False
+process_counts = [1, 2, 4]
+renderer_type = 'mpiRaycast'
+
+optlist, args = getopt.getopt(sys.argv[1:], 'f:m:n:o:p:r:s')
+for o, a in optlist:
+    if o == '-f':
+        frames = int(a)
+    elif o == '-m':
+        mode = a
+    elif o == '-n':
+        N = int(a)
+    elif o == '-o':
+        output = a
+    elif o == '-p':
+        process_counts = [int(v) for v in a.split(',')]
+    elif o == '-r':
+        renderer_type = a
+    elif o == '-s':
+        scaling = True
+
+if scaling:
+    mpirun = os.environ.get('MPIRUN', 'mpirun')
+    print('%-7s %6s %16s %12s %10s' % ('mode', 'ranks', 'dims', 'ms/frame', 'speedup'))
+    for m in ['strong', 'weak']:
+        base = None
+        for np in process_counts:
+            cmd = [mpirun, '-np', str(np), sys.executable, __file__, '-m', m, '-n', str(N),
+                '-f', str(frames), '-r', renderer_type]
+            out = subprocess.check_output(cmd, universal_newlines=True)
+            line = [l for l in out.split('\n') if l.startswith('RESULT')][-1]
+            _, ranks, dims, t = line.split()
+            t = float(t)
+            if base is None:
+                base = t
+            # Weak scaling is ideal when the time stays constant
+            speedup = base / t if m == 'strong' else base / t * int(ranks)
+            print('%-7s %6s %16s %12.2f %10.2f' % (m, ranks, dims, t*1000, speedup))
+    sys.exit(0)
+
+
+def mpi_rank_and_size():
+    try:
+        from mpi4py import MPI
+        return MPI.COMM_WORLD.Get_rank(), MPI.COMM_WORLD.Get_size()
+    except ImportError:
+        pass
+    for r, s in [('OMPI_COMM_WORLD_RANK', 'OMPI_COMM_WORLD_SIZE'), ('PMI_RANK', 'PMI_SIZE')]:
+        if r in os.environ:
+            return int(os.environ[r]), int(os.environ[s])
+    return 0, 1
+
+
+import ospray
+
+rank, ranks = mpi_rank_and_size()
+
+argv = ospray.init(sys.argv)
+ospray.load_module('mpi')
+device = ospray.Device('mpiDistributed')
+device.commit()
+device.set_current()
+
+# Global volume dimensions
+if mode == 'strong':
+    shape = (N, N, N)
+else:
+    grid = ospray.brick_grid(((N-1)*ranks+1,)*3, ranks)
+    shape = tuple((N-1)*g+1 for g in grid)
+
+spacing = 1.0 / (max(shape) - 1)
+extent = ospray.brick_extent(shape, rank, ranks, ghost=1, grid_spacing=(spacing,)*3)
+
+# Only this rank's brick, x varying fastest
+t0 = time.time()
+x, y, z = [(numpy.arange(extent['start'][d], extent['start'][d]+extent['count'][d], dtype=numpy.float32)*spacing)
+    for d in range(3)]
+X, Y, Z = numpy.meshgrid(x, y, z, indexing='ij')
+values = numpy.asfortranarray(
+    numpy.sin(13*X) * numpy.sin(11*Y) * numpy.sin(7*Z) * numpy.exp(-2*((X-0.5)**2 + (Y-0.5)**2 + (Z-0.5)**2)),
+    dtype=numpy.float32)
+del X, Y, Z
+
+volume = ospray.Volume('structuredRegular')
+volume.set_param('data', ospray.shared_data_constructor(values))
+volume.set_param('gridOrigin', extent['grid_origin'])
+volume.set_param('gridSpacing', (spacing,)*3)
+volume.commit()
+
+tf = ospray.TransferFunction.from_control_points(
+    numpy.array([-0.5, 0.0, 0.5], dtype=numpy.float32),
+    numpy.array([[0, 0, 1], [1, 1, 1], [1, 0, 0]], dtype=numpy.float32),
+    numpy.array([0.1, 0.0, 0.1], dtype=numpy.float32),
+    value_range=(-0.5, 0.5), resolution=256)
+
+vmodel = ospray.VolumetricModel(volume)
+vmodel.set_param('transferFunction', tf)
+vmodel.commit()
+
+group = ospray.Group()
+group.set_param('volume', [vmodel])
+group.commit()
+
+instance = ospray.Instance(group)
+instance.commit()
+
+# The region this rank owns, used for compositing the ranks' images
+world = ospray.World()
+world.set_param('instance', [instance])
+world.set_param('region', ospray.copied_data_constructor_box(numpy.array([extent['region']], dtype=numpy.float32)))
+world.commit()
+setup_time = time.time() - t0
+
+size = [(shape[d]-1)*spacing for d in range(3)]
+center = [0.5*s for s in size]
+distance = 1.6 * max(size)
+position = (center[0] - distance/math.sqrt(3), center[1] - distance/math.sqrt(3), center[2] + distance/math.sqrt(3))
+
+camera = ospray.Camera('perspective')
+camera.set_param('aspect', W/H)
+camera.set_param('position', position)
+camera.set_param('direction', tuple(center[d] - position[d] for d in range(3)))
+camera.set_param('up', (0.0, 0.0, 1.0))
+camera.commit()
+
+renderer = ospray.Renderer(renderer_type)
+renderer.set_param('backgroundColor', (1.0, 1.0, 1.0, 1.0))
+renderer.commit()
+
+# Framebuffers of the distributed device are distributed, the final
+# (composited) image is only available on rank 0
+framebuffer = ospray.FrameBuffer(W, H, ospray.OSP_FB_SRGBA, int(ospray.OSP_FB_COLOR))
+
+# Warm-up, includes building acceleration structures
+framebuffer.render_frame(renderer, camera, world).wait()
+
+t0 = time.time()
+for frame in range(frames):
+    framebuffer.clear()
+    framebuffer.render_frame(renderer, camera, world).wait()
+t = (time.time() - t0) / frames
+
+print('rank %d: brick %s of grid %s, %s voxels, setup %.3fs' %
+    (rank, extent['index'], extent['grid'], 'x'.join(map(str, extent['count'])), setup_time))
+
+if rank == 0:
+    print('RESULT %d %s %.6f' % (ranks, 'x'.join(map(str, shape)), t))
+    if output is not None:
+        from PIL import Image
+        colors = framebuffer.get(ospray.OSP_FB_COLOR, (W, H), ospray.OSP_FB_SRGBA)
+        img = Image.frombuffer('RGBA', (W, H), colors, 'raw', 'RGBA', 0, 1)
+        img.transpose(Image.FLIP_TOP_BOTTOM).save(output)
@@ -0,0 +1,86 @@
+#!/usr/bin/env python
+# Compare commit time and peak memory use of a single sphere geometry
+# versus the same spheres split into spatially coherent parts, each in
+# its own Group/Instance.
+#
+# ./samples/partition_benchmark.py [-n num_spheres] [-k parts]
+#
+# Reports the time to get committed groups (for the partitioned case 
+# partition_spheres() commits them) and the time to commit
+# the instances and world. Each variant is run in a separate process, 
+# so the peak memory (maximum resident set size) values are comparable.
+import sys, os, getopt, time, resource, subprocess
+scriptdir = os.path.split(__file__)[0]
+sys.path.insert(0, os.path.join(scriptdir, '..'))
+
+import numpy
+
+N = 10000000
+K = 0
+
+optlist, args = getopt.getopt(sys.argv[1:], 'n:k:')
+for o, a in optlist:
+    if o == '-n':
+        N = int(float(a))
+    elif o == '-k':
+        K = int(a)
+
+def peak_rss_mb():
+    # ru_maxrss is in kilobytes on Linux
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024
+
+def run(mode):
+    import ospray
+    ospray.init(sys.argv)
+
+    numpy.random.seed(123456)
+    positions = numpy.random.rand(N, 3).astype(numpy.float32)
+    radius = (0.5 / pow(N, 1/3) * numpy.random.rand(N)).astype(numpy.float32)
+
+    t0 = time.time()
+
+    instances = []
+    if mode == 'single':
+        spheres = ospray.Geometry('sphere')
+        spheres.set_param('sphere.position', ospray.shared_data_constructor_vec(positions))
+        spheres.set_param('sphere.radius', ospray.shared_data_constructor(radius))
+        spheres.commit()
+        gmodel = ospray.GeometricModel(spheres)
+        gmodel.commit()
+        group = ospray.Group()
+        group.set_param('geometry', [gmodel])
+        group.commit()
+        groups = [group]
+    else:
+        groups = ospray.partition_spheres(positions, radius, parts=K)
+
+    t1 = time.time()
+
+    for group in groups:
+        instance = ospray.Instance(group)
+        instance.commit()
+        instances.append(instance)
+
+    world = ospray.World()
+    world.set_param('instance', instances)
+    world.commit()
+
+    t2 = time.time()
+
+    print('%s %d %.3f %.3f %.1f' % (mode, len(groups), t1-t0, t2-t1, peak_rss_mb()))
+
+
+if len(args) == 1:
+    run(args[0])
+    sys.exit(0)
+
+print('%d spheres' % N)
+print()
+print('%-12s %6s %10s %10s %12s' % ('mode', 'parts', 'groups (s)', 'world (s)', 'peak RSS (MB)'))
+
+for mode in ['single', 'partitioned']:
+    cmd = [sys.executable, __file__, '-n', str(N), '-k', str(K), mode]
+    output = subprocess.check_output(cmd, universal_newlines=True)
+    line = output.strip().split('\n')[-1]
+    mode, parts, groups, world, rss = line.split()
+    print('%-12s %6s %10s %10s %12s' % (mode, parts, groups, world, rss))
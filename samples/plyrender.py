@@ -1,5 +1,5 @@
 #!/usr/bin/env python
-import sys, getopt, math, os
+import sys, getopt, math, os, time
 scriptdir = os.path.split(__file__)[0]
 sys.path.insert(0, os.path.join(scriptdir, '..'))
 
@@ -42,6 +42,9 @@ display_result = False
 
 def usage():
     print('Usage: %s [options] file.ply|file.obj|file.stl|file.pdb' % sys.argv[0])
+    print('       %s [options] file.ply|file.stl ...' % sys.argv[0])
+    print()
+    print('Multiple PLY/STL files are loaded in parallel')
     print()
     print('-d type          Use debug renderer of specific type')
     print('-l subdivlevel   Subdivision level (default: %f)' % subdivision_level)
@@ -68,7 +71,7 @@ for o, a in optlist:
     elif o == '-x':
         display_result = True
 
-if len(args) != 1:
+if len(args) == 0:
     usage()
     sys.exit(-1)
 
@@ -89,49 +92,69 @@ if renderer_type in ['scivis', 'pathtracer']:
 
     material.commit()
 
-# Process file
+# Process file(s)
 
-fname = args[0]
-ext = os.path.splitext(fname)[-1]
+exts = set([os.path.splitext(fname)[-1].lower() for fname in args])
 
-if ext == '.ply':
-    meshes = read_ply(fname, force_subdivision_mesh)
-elif ext in ['.obj', '.OBJ']:
-    meshes = read_obj(fname, force_subdivision_mesh)
-elif ext == '.stl':
-    meshes = read_stl(fname, force_subdivision_mesh)
-elif ext == '.pdb':
-    meshes = read_pdb(fname)
+if not force_subdivision_mesh and exts <= set(['.ply', '.stl']):
+    
+    # Files are read, and their geometry created and committed, on a pool
+    # of threads
+    def progress(done, total):
+        sys.stdout.write('\rLoaded %d/%d files' % (done, total))
+        sys.stdout.flush()
+    
+    t0 = time.time()
+    group = ospray.load_meshes(args, material=material, progress=progress)
+    print('\nLoaded %d files in %.3fs' % (len(args), time.time()-t0))
+    
 else:
-    raise ValueError('Unknown extension %s' % ext)
+    
+    if len(args) != 1:
+        usage()
+        sys.exit(-1)
+        
+    fname = args[0]
+    ext = os.path.splitext(fname)[-1]
+
+    if ext == '.ply':
+        meshes = read_ply(fname, force_subdivision_mesh)
+    elif ext in ['.obj', '.OBJ']:
+        meshes = read_obj(fname, force_subdivision_mesh)
+    elif ext == '.stl':
+        meshes = read_stl(fname, force_subdivision_mesh)
+    elif ext == '.pdb':
+        meshes = read_pdb(fname)
+    else:
+        raise ValueError('Unknown extension %s' % ext)
 
-if isinstance(meshes, ospray.GeometricModel):
-    meshes.set_param('material', material)
-    meshes.commit()    
-    gmodels = [meshes]
-else:
-    gmodels = []
-    for mesh in meshes:
+    if isinstance(meshes, ospray.GeometricModel):
+        meshes.set_param('material', material)
+        meshes.commit()    
+        gmodels = [meshes]
+    else:
+        gmodels = []
+        for mesh in meshes:
         
-        if force_subdivision_mesh:
-            mesh.set_param('level', subdivision_level)
+            if force_subdivision_mesh:
+                mesh.set_param('level', subdivision_level)
         
-        gmodel = ospray.GeometricModel(mesh)
-        if material is not None:
-            gmodel.set_param('material', material)
-        gmodel.commit()
+            gmodel = ospray.GeometricModel(mesh)
+            if material is not None:
+                gmodel.set_param('material', material)
+            gmodel.commit()
     
-        gmodels.append(gmodel)
+            gmodels.append(gmodel)
     
-if len(gmodels) == 0:
-    print('No models to render!')
-    sys.exit(-1)
+    if len(gmodels) == 0:
+        print('No models to render!')
+        sys.exit(-1)
     
-print('Have %d meshes' % len(gmodels))
+    print('Have %d meshes' % len(gmodels))
 
-group = ospray.Group()
-group.set_param('geometry', gmodels)
-group.commit()
+    group = ospray.Group()
+    group.set_param('geometry', gmodels)
+    group.commit()
 
 instance1 = ospray.Instance(group)
 instance1.set_param('transform', ospray.mat4.identity())
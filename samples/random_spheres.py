@@ -50,25 +50,27 @@ camera.commit()
 
 max_radius = 0.7 / pow(N, 1/3)
 
-numpy.random.seed(123456)
-positions = numpy.random.rand(N,3).astype(numpy.float32)
-radii = max_radius*numpy.random.rand(N).astype(numpy.float32)
-colors = 0.3 + 0.7*numpy.random.rand(N,3).astype(numpy.float32)
-opacities = numpy.ones(N, 'float32')
-colors = numpy.c_[ colors, opacities ]
-assert(numpy.min(colors) >= 0.3)
+# Interleaved particle records, as commonly read from particle files. 
+# The fields are shared directly, without de-interleaving.
+particles = numpy.zeros(N, dtype=[
+    ('x', 'f4'), ('y', 'f4'), ('z', 'f4'), ('radius', 'f4'), 
+    ('r', 'f4'), ('g', 'f4'), ('b', 'f4'), ('a', 'f4')])
 
-#colors = numpy.tile(numpy.array([1,0,0,1],'float32'), (N,1))
+numpy.random.seed(123456)
+for c in ['x', 'y', 'z']:
+    particles[c] = numpy.random.rand(N)
+particles['radius'] = max_radius*numpy.random.rand(N)
+for c in ['r', 'g', 'b']:
+    particles[c] = 0.3 + 0.7*numpy.random.rand(N)
+particles['a'] = 1.0
 
 spheres = ospray.Geometry('sphere')
-spheres.set_param('sphere.position', ospray.shared_data_constructor_vec(positions))
-spheres.set_param('sphere.radius', ospray.shared_data_constructor(radii))
+spheres.set_param('sphere.position', ospray.shared_data_constructor_field(particles, ['x', 'y', 'z']))
+spheres.set_param('sphere.radius', ospray.shared_data_constructor_field(particles, 'radius'))
 spheres.commit()
 
 gmodel = ospray.GeometricModel(spheres)
-# XXX sometimes segfault, plus some spheres are black which should not be possible given
-# the colors set
-gmodel.set_param('color', ospray.shared_data_constructor_vec(colors))
+gmodel.set_param('color', ospray.shared_data_constructor_field(particles, ['r', 'g', 'b', 'a']))
 gmodel.commit()
 
 group = ospray.Group()
@@ -0,0 +1,195 @@
+#!/usr/bin/env python
+# Client for renderserver.py, plus a request latency benchmark.
+#
+# ./samples/renderclient.py [-a address] [-n requests] [-s WxH] [-f format] [-p samples] [-w world] [file]
+#
+# With a file (PLY/STL or scene snapshot) it is loaded into the server
+# first, as world 'bench'. The benchmark compares the latency of render
+# requests to the server with a cold start: a fresh process that
+# initializes OSPRay, loads the file and renders a single image.
+#
+# Messages in both directions are a 4-byte big-endian length followed by
+# a JSON header, plus for replies carrying an image a second length and
+# the image bytes.
+import sys, os, getopt, json, socket, struct, subprocess, time
+
+DEFAULT_ADDRESS = 'unix:/tmp/ospray-renderserver.sock'
+
+
+def parse_address(address):
+    """'unix:/path/to/socket' or 'host:port' (TCP), returns (family, address)"""
+    if address.startswith('unix:'):
+        return socket.AF_UNIX, address[5:]
+    host, port = address.rsplit(':', 1)
+    return socket.AF_INET, (host or 'localhost', int(port))
+
+
+def recv_exact(sock, n):
+    chunks = []
+    while n > 0:
+        chunk = sock.recv(min(n, 1 << 20))
+        if not chunk:
+            raise ConnectionError('connection closed')
+        chunks.append(chunk)
+        n -= len(chunk)
+    return b''.join(chunks)
+
+
+def send_message(sock, header, payload=None):
+    data = json.dumps(header).encode('utf8')
+    parts = [struct.pack('>I', len(data)), data]
+    if payload is not None:
+        parts += [struct.pack('>I', len(payload)), payload]
+    sock.sendall(b''.join(parts))
+
+
+def recv_header(sock):
+    n, = struct.unpack('>I', recv_exact(sock, 4))
+    return json.loads(recv_exact(sock, n).decode('utf8'))
+
+
+def recv_payload(sock):
+    n, = struct.unpack('>I', recv_exact(sock, 4))
+    return recv_exact(sock, n)
+
+
+class RenderClient:
+    """Connection to a render server. Raises RuntimeError for errors
+    reported by the server."""
+
+    def __init__(self, address=DEFAULT_ADDRESS):
+        family, addr = parse_address(address)
+        self.sock = socket.socket(family, socket.SOCK_STREAM)
+        if family == socket.AF_INET:
+            self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.sock.connect(addr)
+
+    def close(self):
+        self.sock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def request(self, header):
+        send_message(self.sock, header)
+        reply = recv_header(self.sock)
+        if 'error' in reply:
+            raise RuntimeError(reply['error'])
+        if reply.get('payload', False):
+            reply['data'] = recv_payload(self.sock)
+        return reply
+
+    def ping(self):
+        return self.request({'op': 'ping'})
+
+    def load(self, name, path):
+        """Load a scene snapshot or one or more (comma-separated) PLY/STL
+        files into the server as world name, returns the world bounds"""
+        return self.request({'op': 'load', 'world': name, 'path': path})['bounds']
+
+    def unload(self, name):
+        self.request({'op': 'unload', 'world': name})
+
+    def worlds(self):
+        return self.request({'op': 'worlds'})['worlds']
+
+    def render(self, world, width=512, height=512, camera=None, renderer='scivis', renderer_params=None,
+            samples=1, format='raw'):
+        """Render world, returns the image: for format 'raw' a NumPy array of
+        height x width RGBA uint8 pixels (top row first), otherwise the
+        encoded PNG or JPEG bytes. Camera is a dict with position, direction,
+        up and fovy, by default the camera looks at the whole world."""
+        header = {
+            'op': 'render', 'world': world, 'width': width, 'height': height,
+            'renderer': renderer, 'renderer_params': renderer_params or {},
+            'samples': samples, 'format': format
+        }
+        if camera is not None:
+            header['camera'] = camera
+        reply = self.request(header)
+        if format != 'raw':
+            return reply['data']
+        import numpy
+        return numpy.frombuffer(reply['data'], dtype=numpy.uint8).reshape((height, width, 4))
+
+    def shutdown(self):
+        self.request({'op': 'shutdown'})
+
+
+def cold_start(path, width, height, samples):
+    """Time a single render in a new process, including OSPRay
+    initialization and loading"""
+    code = '''
+import sys, os, time
+t0 = time.time()
+sys.path.insert(0, %r)
+from renderserver import ospray, RenderService
+ospray.init(sys.argv)
+service = RenderService()
+service.load('bench', %r)
+service.render({'world': 'bench', 'width': %d, 'height': %d, 'samples': %d, 'format': 'raw'})
+print(time.time() - t0)
+''' % (os.path.abspath(os.path.split(__file__)[0]), path, width, height, samples)
+    t0 = time.time()
+    output = subprocess.check_output([sys.executable, '-c', code], universal_newlines=True)
+    return time.time() - t0, float(output.strip().split('\n')[-1])
+
+
+if __name__ == '__main__':
+
+    address = DEFAULT_ADDRESS
+    N = 50
+    W, H = 512, 512
+    format = 'raw'
+    samples = 1
+    world = 'bench'
+
+    optlist, args = getopt.getopt(sys.argv[1:], 'a:f:n:p:s:w:')
+    for o, a in optlist:
+        if o == '-a':
+            address = a
+        elif o == '-f':
+            format = a
+        elif o == '-n':
+            N = int(a)
+        elif o == '-p':
+            samples = int(a)
+        elif o == '-s':
+            W, H = map(int, a.split('x'))
+        elif o == '-w':
+            world = a
+
+    client = RenderClient(address)
+
+    if len(args) > 0:
+        t0 = time.time()
+        client.load(world, os.path.abspath(args[0]))
+        print('Loaded %s into server in %.3fs' % (args[0], time.time()-t0))
+
+    t0 = time.time()
+    client.ping()
+    print('Ping %.3f ms' % ((time.time()-t0)*1000))
+
+    latencies = []
+    for i in range(N):
+        t0 = time.time()
+        client.render(world, W, H, samples=samples, format=format)
+        latencies.append(time.time() - t0)
+    client.close()
+
+    latencies.sort()
+    def percentile(p):
+        return latencies[min(len(latencies)-1, int(p*len(latencies)))] * 1000
+
+    print('%d requests of %dx%d (%s, %d spp)' % (N, W, H, format, samples))
+    print('%-10s %10s' % ('', 'ms'))
+    for label, p in [('min', 0.0), ('median', 0.5), ('p95', 0.95), ('max', 1.0)]:
+        print('%-10s %10.2f' % (label, percentile(p)))
+    print('%-10s %10.2f' % ('mean', sum(latencies)/len(latencies)*1000))
+
+    if len(args) > 0:
+        total, inproc = cold_start(os.path.abspath(args[0]), W, H, samples)
+        print('Cold start %.2f ms (%.2f ms after interpreter start)' % (total*1000, inproc*1000))
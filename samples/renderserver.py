@@ -0,0 +1,314 @@
+#!/usr/bin/env python
+# Long-lived render server, which keeps OSPRay initialized and worlds
+# committed in memory, so clients only pay for rendering.
+#
+# ./samples/renderserver.py [-a address] [-r renderers] [-f framebuffers] [-w name=path ...]
+#
+# The address is either unix:/path/to/socket (default
+# unix:/tmp/ospray-renderserver.sock) or host:port for TCP, which should
+# normally be on localhost, as there's no authentication. Worlds can be
+# loaded at startup with -w, or later with a 'load' request. A world is
+# loaded from a scene snapshot (see ospray.save_scene()), or from one or
+# more comma-separated PLY/STL files. At most -r renderers and -f 
+# framebuffers are cached, the least recently used are released first.
+#
+# See renderclient.py for the client API and the message format.
+# Requests (JSON headers) have an 'op' field:
+#
+#   ping
+#   load        world, path
+#   unload      world
+#   worlds
+#   render      world, width, height, [camera], [renderer], [renderer_params],
+#               [samples], [format]
+#   shutdown
+#
+# Requests are handled on a thread per connection. Requests using OSPRay
+# (loading, unloading and rendering) are serialized, as OSPRay doesn't
+# document using it from multiple threads at once as safe. Others (e.g.
+# ping and worlds) don't wait for these.
+import sys, os, getopt, math, socket, socketserver, threading, io, time
+from collections import OrderedDict
+scriptdir = os.path.split(__file__)[0]
+sys.path.insert(0, os.path.join(scriptdir, '..'))
+sys.path.insert(0, scriptdir)
+
+import numpy
+import ospray
+from renderclient import DEFAULT_ADDRESS, parse_address, send_message, recv_header
+
+try:
+    from PIL import Image
+    have_pil = True
+except ImportError:
+    have_pil = False
+
+
+def param_value(value):
+    """JSON value to set_param() value. Lists become tuples of floats,
+    as JSON doesn't distinguish 1 and 1.0."""
+    if isinstance(value, list):
+        return tuple(float(v) for v in value)
+    return value
+
+
+class LRUCache:
+    """Dict with at most max_size items, dropping the least recently used"""
+
+    def __init__(self, max_size):
+        self.max_size = max_size
+        self.items = OrderedDict()
+
+    def get(self, key):
+        value = self.items.get(key)
+        if value is not None:
+            self.items.move_to_end(key)
+        return value
+
+    def put(self, key, value):
+        self.items[key] = value
+        self.items.move_to_end(key)
+        while len(self.items) > self.max_size:
+            self.items.popitem(last=False)
+
+
+class RenderService:
+    """Worlds plus the cached renderers and framebuffers used to render them.
+    Calls to load(), unload() and render() need to be serialized."""
+
+    def __init__(self, max_renderers=8, max_framebuffers=4):
+        self.worlds = {}
+        # Objects that are expensive to recreate are kept between requests
+        self.renderers = LRUCache(max_renderers)        # (type, params) -> Renderer
+        self.framebuffers = LRUCache(max_framebuffers)  # (width, height) -> FrameBuffer
+        self.camera = ospray.Camera('perspective')
+
+        self.material = ospray.Material('scivis', 'obj')
+        self.material.commit()
+
+    def load(self, name, path):
+        if path.endswith('.osps'):
+            world = ospray.load_scene(path)
+        else:
+            group = ospray.load_meshes(path.split(','), material=self.material)
+            instance = ospray.Instance(group)
+            instance.commit()
+
+            light1 = ospray.Light('ambient')
+            light1.set_param('intensity', 0.4)
+            light1.commit()
+            light2 = ospray.Light('distant')
+            light2.set_param('intensity', 0.6)
+            light2.set_param('direction', (1.0, 1.0, -1.0))
+            light2.commit()
+
+            world = ospray.World()
+            world.set_param('instance', [instance])
+            world.set_param('light', [light1, light2])
+            world.commit()
+
+        self.worlds[name] = world
+        return world.get_bounds()
+
+    def unload(self, name):
+        del self.worlds[name]
+
+    def default_camera(self, world, fovy=45.0):
+        """Camera looking at the whole world, from the (-1,-1,-1) direction"""
+        bound = numpy.array(world.get_bounds(), dtype=numpy.float32).reshape((-1, 3))
+        radius = 0.5 * numpy.linalg.norm(bound[1] - bound[0])
+        distance = radius / math.tan(0.5*math.radians(fovy)) * 1.05
+        center = 0.5*(bound[0] + bound[1])
+        position = center - distance/math.sqrt(3)*numpy.array([1, 1, 1], 'float32')
+        return {
+            'position': position.tolist(), 'direction': (center - position).tolist(),
+            'up': [0.0, 0.0, 1.0], 'fovy': fovy
+        }
+
+    def get_renderer(self, type, params):
+        key = (type, tuple(sorted((k, repr(v)) for k, v in params.items())))
+        renderer = self.renderers.get(key)
+        if renderer is None:
+            renderer = ospray.Renderer(type)
+            for name, value in params.items():
+                renderer.set_param(name, param_value(value))
+            renderer.commit()
+            self.renderers.put(key, renderer)
+        return renderer
+
+    def get_framebuffer(self, width, height):
+        framebuffer = self.framebuffers.get((width, height))
+        if framebuffer is None:
+            framebuffer = ospray.FrameBuffer(width, height, ospray.OSP_FB_SRGBA,
+                int(ospray.OSP_FB_COLOR) | int(ospray.OSP_FB_ACCUM))
+            self.framebuffers.put((width, height), framebuffer)
+        return framebuffer
+
+    def render(self, request):
+        """Returns the encoded image, for format 'raw' the RGBA pixels, top row first"""
+        world = self.worlds[request['world']]
+        width, height = int(request['width']), int(request['height'])
+        format = request.get('format', 'raw')
+
+        if format not in ['raw', 'png', 'jpeg']:
+            raise ValueError('unknown format %s' % format)
+        if format != 'raw' and not have_pil:
+            raise ValueError('format %s needs PIL' % format)
+
+        camera = request.get('camera', None)
+        if camera is None:
+            camera = self.default_camera(world)
+        self.camera.set_param('aspect', width/height)
+        self.camera.set_param('position', param_value(camera['position']))
+        self.camera.set_param('direction', param_value(camera['direction']))
+        self.camera.set_param('up', param_value(camera['up']))
+        self.camera.set_param('fovy', float(camera.get('fovy', 45.0)))
+        self.camera.commit()
+
+        renderer = self.get_renderer(request.get('renderer', 'scivis'), request.get('renderer_params', {}))
+
+        framebuffer = self.get_framebuffer(width, height)
+        framebuffer.clear()
+        for i in range(max(1, int(request.get('samples', 1)))):
+            framebuffer.render_frame(renderer, self.camera, world).wait()
+
+        pixels = framebuffer.get(ospray.OSP_FB_COLOR, (width, height), ospray.OSP_FB_SRGBA)
+        # Framebuffer rows start at the bottom
+        pixels = numpy.ascontiguousarray(pixels.reshape((height, width, 4))[::-1])
+
+        if format == 'raw':
+            return pixels.tobytes()
+
+        img = Image.fromarray(pixels, 'RGBA')
+        f = io.BytesIO()
+        if format == 'png':
+            img.save(f, 'PNG', compress_level=1)
+        else:
+            img.convert('RGB').save(f, 'JPEG', quality=90)
+        return f.getvalue()
+
+
+class RequestHandler(socketserver.BaseRequestHandler):
+
+    def handle(self):
+        server = self.server
+        while True:
+            try:
+                request = recv_header(self.request)
+            except ConnectionError:
+                return
+
+            op = request.get('op', None)
+            payload = None
+            reply = {}
+
+            try:
+                if op == 'ping':
+                    pass
+                elif op == 'load':
+                    with server.lock:
+                        reply['bounds'] = server.service.load(request['world'], request['path'])
+                elif op == 'unload':
+                    with server.lock:
+                        server.service.unload(request['world'])
+                elif op == 'worlds':
+                    reply['worlds'] = sorted(server.service.worlds.keys())
+                elif op == 'render':
+                    with server.lock:
+                        t0 = time.time()
+                        payload = server.service.render(request)
+                        reply['render_time'] = time.time() - t0
+                    reply['payload'] = True
+                elif op == 'shutdown':
+                    threading.Thread(target=server.shutdown).start()
+                else:
+                    raise ValueError('unknown op %r' % op)
+            except Exception as e:
+                reply = {'error': '%s: %s' % (type(e).__name__, e)}
+                payload = None
+
+            send_message(self.request, reply, payload)
+
+            if op == 'shutdown':
+                return
+
+
+class UnixRenderServer(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+    daemon_threads = True
+
+
+class TCPRenderServer(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def server_bind(self):
+        self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        socketserver.TCPServer.server_bind(self)
+
+
+def usage():
+    print('Usage: %s [options]' % sys.argv[0])
+    print()
+    print('-a address       unix:/path/to/socket or host:port (default: %s)' % DEFAULT_ADDRESS)
+    print('-f framebuffers  Maximum number of cached framebuffers (default: 4)')
+    print('-r renderers     Maximum number of cached renderers (default: 8)')
+    print('-w name=path     Load world at startup (repeatable)')
+    print('-h               Help')
+    print()
+
+
+if __name__ == '__main__':
+
+    argv = ospray.init(sys.argv)
+
+    address = DEFAULT_ADDRESS
+    initial = []
+    max_renderers = 8
+    max_framebuffers = 4
+
+    optlist, args = getopt.getopt(argv[1:], 'a:f:hr:w:')
+    for o, a in optlist:
+        if o == '-a':
+            address = a
+        elif o == '-f':
+            max_framebuffers = int(a)
+        elif o == '-r':
+            max_renderers = int(a)
+        elif o == '-h':
+            usage()
+            sys.exit(-1)
+        elif o == '-w':
+            initial.append(a.split('=', 1))
+
+    service = RenderService(max_renderers, max_framebuffers)
+    for name, path in initial:
+        t0 = time.time()
+        service.load(name, path)
+        print('Loaded world %s from %s in %.3fs' % (name, path, time.time()-t0))
+
+    family, addr = parse_address(address)
+    if family == socket.AF_UNIX:
+        if os.path.exists(addr):
+            os.unlink(addr)
+        server = UnixRenderServer(addr, RequestHandler)
+    else:
+        server = TCPRenderServer(addr, RequestHandler)
+
+    server.service = service
+    server.lock = threading.Lock()
+
+    print('Listening on %s' % address)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        if family == socket.AF_UNIX and os.path.exists(addr):
+            os.unlink(addr)
+        # Wait for the request being handled, if any, and keep the lock so 
+        # no other handler (daemon threads, killed on exit) uses OSPRay 
+        # anymore. Release OSPRay objects before shutting down.
+        server.lock.acquire()
+        del server.service, service
+        ospray.shutdown()
@@ -0,0 +1,79 @@
+#!/usr/bin/env python
+# Turntable animation of one or more meshes, rendered with a CameraPath.
+#
+# ./samples/turntable.py [-f frames] [-s samples] [-o prefix] file.ply|file.stl ...
+#
+# The camera is updated natively per frame, the only Python work per frame
+# is saving the image (skipped without -o).
+import sys, os, getopt
+scriptdir = os.path.split(__file__)[0]
+sys.path.insert(0, os.path.join(scriptdir, '..'))
+
+import numpy
+import ospray
+
+W = 1024
+H = 768
+
+frames = 72
+samples = 4
+prefix = None
+
+argv = ospray.init(sys.argv)
+
+optlist, args = getopt.getopt(argv[1:], 'f:o:s:')
+for o, a in optlist:
+    if o == '-f':
+        frames = int(a)
+    elif o == '-o':
+        prefix = a
+    elif o == '-s':
+        samples = int(a)
+
+if len(args) == 0:
+    print('Usage: %s [-f frames] [-s samples] [-o prefix] file.ply|file.stl ...' % sys.argv[0])
+    sys.exit(-1)
+
+group = ospray.load_meshes(args)
+instance = ospray.Instance(group)
+instance.commit()
+
+light1 = ospray.Light('ambient')
+light1.set_param('intensity', 0.4)
+light1.commit()
+light2 = ospray.Light('distant')
+light2.set_param('intensity', 0.6)
+light2.set_param('direction', (1.0, 1.0, -1.0))
+light2.commit()
+
+world = ospray.World()
+world.set_param('instance', [instance])
+world.set_param('light', [light1, light2])
+world.commit()
+
+camera = ospray.Camera('perspective')
+camera.set_param('aspect', W/H)
+
+renderer = ospray.Renderer('scivis')
+renderer.set_param('backgroundColor', (1.0, 1.0, 1.0, 1.0))
+renderer.commit()
+
+framebuffer = ospray.FrameBuffer(W, H, ospray.OSP_FB_SRGBA,
+    int(ospray.OSP_FB_COLOR) | int(ospray.OSP_FB_ACCUM))
+
+# A full turn, not repeating the first frame at the end
+path = ospray.CameraPath.turntable(world.get_bounds(), elevation=25, degrees=360)
+times = numpy.arange(frames, dtype=numpy.float32) / frames
+
+
+def save(frame):
+    from PIL import Image
+    colors = framebuffer.get(ospray.OSP_FB_COLOR, (W, H), ospray.OSP_FB_SRGBA)
+    img = Image.frombuffer('RGBA', (W, H), colors, 'raw', 'RGBA', 0, 1)
+    img.transpose(Image.FLIP_TOP_BOTTOM).save('%s%04d.png' % (prefix, frame))
+
+
+seconds = path.render(framebuffer, renderer, camera, world, times, samples=samples,
+    callback=save if prefix is not None else None)
+
+print('%d frames, %.1f ms/frame (%d samples)' % (len(seconds), 1000*seconds.mean(), samples))
@@ -83,6 +83,7 @@ show_histogram = False
 camera_configuration = None
 camera_fov_string = None
 extra_scene_script = None
+roi_start = roi_count = roi_stride = None
 
 
 def usage():
@@ -103,6 +104,7 @@ def usage():
     print(' -I width,height                 Image resolution')
     print(' -o output-image                 Output file (default: volume.png)')
     print(' -p                              Use pathtracer (default: use scivis renderer)')
+    print(' -r x0,y0,z0,nx,ny,nz[,sx,sy,sz] HDF5 region of interest (start, count, stride)')
     print(' -s xs,ys,zs                     Grid spacing')
     print(' -S samples                      Samples per pixel (default: %d)' % samples)
     print(' -t <default>|<linear>|<file.trn> Set transfer function')
@@ -114,7 +116,7 @@ def usage():
     print()
 
 try:
-    optlist, args = getopt.getopt(argv[1:], 'a:b:Bc:C:d:D:f:Hi:I:o:ps:S:t:v:xX:')
+    optlist, args = getopt.getopt(argv[1:], 'a:b:Bc:C:d:D:f:Hi:I:o:pr:s:S:t:v:xX:')
 except getopt.GetoptError as err:
     print(err)
     usage()
@@ -195,6 +197,13 @@ for o, a in optlist:
         image_file = a
     elif o == '-p':
         RENDERER = 'pathtracer'
+    elif o == '-r':
+        r = list(map(int, a.split(',')))
+        assert len(r) in [6, 9]
+        roi_start = tuple(r[:3])
+        roi_count = tuple(r[3:6])
+        if len(r) == 9:
+            roi_stride = tuple(r[6:])
     elif o == '-s':
         grid_spacing = tuple(map(float, a.split(',')))
         assert len(grid_spacing) == 3
@@ -247,20 +256,34 @@ if ext == '.raw':
     extent[1] = dimensions * grid_spacing   
     
 elif ext in ['.h5', '.hdf5']:
-    assert have_h5py and 'h5py module could not be loaded!'
     assert dataset_name and 'Set hdf5 dataset name with -D name'
     
-    f = h5py.File(volfile, 'r')
-    dset = f[dataset_name]
-    data = numpy.array(dset[:])    
-    f.close()
+    if ospray.have_hdf5:
+        # Streamed directly into the final (IJK) volume layout
+        data = ospray.read_hdf5_volume(volfile, dataset_name, 
+            start=roi_start, count=roi_count, stride=roi_stride)
+        
+    else:
+        assert have_h5py and 'h5py module could not be loaded!'
+        
+        f = h5py.File(volfile, 'r')
+        dset = f[dataset_name]
+        if roi_start is not None or roi_count is not None or roi_stride is not None:
+            start = roi_start or (0, 0, 0)
+            stride = roi_stride or (1, 1, 1)
+            count = roi_count or (None, None, None)
+            # KJI selection
+            sel = tuple(slice(start[i], None if count[i] is None else start[i]+count[i]*stride[i], stride[i]) for i in [2,1,0])
+            values = dset[sel]
+        else:
+            values = dset[()]
+        # KJI -> IJK, plus float64 -> float32, in a single pass
+        data = ospray.ingest_volume(values, axes=(2,1,0))
+        del values
+        f.close()
     
-    # KJI -> IJK
-    data = numpy.swapaxes(data, 0, 2)
     dimensions = data.shape
-    
-    if value_range is None:
-        value_range = tuple(map(float, (numpy.min(data), numpy.max(data))))
+    grid_spacing *= numpy.array(roi_stride or (1, 1, 1), dtype=numpy.float32)
     
     extent[1] = dimensions * grid_spacing   
     
@@ -301,11 +324,15 @@ elif ext in ['.vtk', '.vti']:
     data = data.reshape(dimensions)
     assert len(data.shape) == 3
     
-    value_range = tuple(map(float, (numpy.min(data), numpy.max(data))))
-    
 else:
     raise ValueError('Unknown file extension "%s"' % ext)   
 
+# Single (multi-threaded) pass over the data for value range and histogram
+if value_range is None or show_histogram:
+    stats = ospray.volume_statistics(data, bins=30)
+    if value_range is None:
+        value_range = stats['value_range']
+
 minx, miny, minz = extent[0]
 maxx, maxy, maxz = extent[1]
 diagonal_size = sqrt((maxx-minx)**2 + (maxy-miny)**2 + (maxz-minz)**2)
@@ -317,7 +344,7 @@ print('spacing', grid_spacing)
 print('extent', extent)
 
 if show_histogram:
-    print(numpy.histogram(data, bins=30))
+    print(stats['histogram'], stats['bin_edges'])
 
 assert value_range is not None and 'Set value range with -v min,max'
 
@@ -344,88 +371,34 @@ volume.commit()
 
 # TF
 
-def generate_tf(values, colors, opacities, T=16):
-    """
-    The values, colors and opacities arrays together sparsely define
-    the transfer function.
-    """
-
-    assert value_range is not None
-    
-    #print(values)
-    #print(colors)
-    #print(opacities)
-        
-    P = values.shape[0]
-    assert colors.shape[0] == P and colors.shape[1] == 3
-    assert opacities.shape[0] == P
-    
-    # Generate equidistant TF from sparse specification
-    tfcolors = numpy.zeros((T,3), dtype=numpy.float32)
-    tfopacities = numpy.zeros(T, dtype=numpy.float32)
-
-    idx = 0
-    pos = 0.0
-    pos_step = value_range[-1]/(T-1)
-    while idx < T:
-        valueidx = numpy.interp(pos, values, numpy.arange(P))
-            
-        lowidx = int(valueidx)
-        highidx = min(lowidx + 1, P-1)
-        factor = valueidx - lowidx
-        
-        #print(value, valueidx, lowidx, highidx, factor)
-
-        tfcolors[idx] = (1-factor) * colors[lowidx] + factor * colors[highidx]
-        tfopacities[idx] = (1-factor) * opacities[lowidx] + factor * opacities[highidx]
-        
-        idx += 1
-        pos += pos_step
-        
-    return tfcolors, tfopacities
-    
-
 if isovalue is not None:
     # Fixed color and opacity for isosurface
-    tfcolors = numpy.array([[0.8, 0.8, 0.8]], dtype=numpy.float32)
-    tfopacities = numpy.array([1], dtype=numpy.float32)
+    values = numpy.array([0], dtype=numpy.float32)
+    colors = numpy.array([[0.8, 0.8, 0.8]], dtype=numpy.float32)
+    opacities = numpy.array([1], dtype=numpy.float32)
     
 elif tf_mode == 'file':
     # Read a .trn file
     # <minval> <maxval>
     # <value> <r> <g> <b> <a>
-    lines = [l.strip() for l in open(tf_file, 'rt').readlines() if l.strip() != '' and l[0] != '#']    
+    values, colors, opacities, trn_value_range = ospray.read_trn(tf_file)
     
     if value_range is None:
-        value_range = list(map(float, lines[0].split(' ')))
-    lines = lines[1:]
-    
-    N = len(lines)
-    assert N >= 2
-    
-    values = numpy.zeros(N, dtype=numpy.float32)
-    colors = numpy.zeros((N,3), dtype=numpy.float32)
-    opacities = numpy.zeros(N, dtype=numpy.float32)
-    
-    for idx, line in enumerate(lines):
-        pp = list(map(float, line.split()))
-        assert len(pp) == 5
-        values[idx] = pp[0]
-        colors[idx] = (pp[1], pp[2], pp[3])
-        opacities[idx] = pp[4]
-        
-    tfcolors, tfopacities = generate_tf(values, colors, opacities)    
+        value_range = trn_value_range
     
 elif tf_mode == 'linear':
     # Simple linear TF
-    tfcolors = numpy.array([[0, 0, 0], [0, 0, 1]], dtype=numpy.float32)
-    tfopacities = numpy.array([0, 1], dtype=numpy.float32)
+    values = numpy.array(value_range, dtype=numpy.float32)
+    colors = numpy.array([[0, 0, 0], [0, 0, 1]], dtype=numpy.float32)
+    opacities = numpy.array([0, 1], dtype=numpy.float32)
     
 elif tf_mode == 'default':
 
     values = numpy.array([
         0, 0.318, 0.462, 0.546, 1   
     ], dtype=numpy.float32)
+    # Relative to the value range
+    values = value_range[0] + values*(value_range[1] - value_range[0])
 
     colors = numpy.array([
         [0, 0, 1],
@@ -439,15 +412,11 @@ elif tf_mode == 'default':
         1, 1, 1, 0, 0
     ], dtype=numpy.float32)
     
-    tfcolors, tfopacities = generate_tf(values, colors, opacities)
-    
-#print('tfcolors', tfcolors.shape)
-#print('tfopacities', tfopacities.shape)
-
 #print('TF:')
 #print(value_range)
-#print(tfcolors)
-#print(tfopacities)
+#print(values)
+#print(colors)
+#print(opacities)
     
 if isovalue is not None:
 
@@ -486,11 +455,8 @@ else:
     
     # Volume rendered
 
-    transfer_function = ospray.TransferFunction('piecewiseLinear')
-    transfer_function.set_param('color', ospray.copied_data_constructor_vec(tfcolors))
-    transfer_function.set_param('opacity', ospray.copied_data_constructor(tfopacities))
-    transfer_function.set_param('valueRange', tuple(value_range))
-    transfer_function.commit()
+    transfer_function = ospray.TransferFunction.from_control_points(
+        values, colors, opacities, tuple(value_range), resolution=256)
 
     vmodel = ospray.VolumetricModel(volume)
     vmodel.set_param('transferFunction', transfer_function)
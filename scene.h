@@ -0,0 +1,1007 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ospray/ospray.h>
+#include <ospray/ospray_util.h>
+#include "tracking.h"
+
+// Scene recording and snapshots. OSPRay has no API for reading back object
+// parameters or data contents, so while recording is enabled the object
+// creation, parameter and data calls made through ospray_cpp are recorded
+// here. This uses the redirects at the end of this file, so this header
+// needs to be included before <ospray/ospray_cpp.h>. Everything reachable
+// from a recorded world can then be saved to a file, with all array data
+// in a single binary container, and loaded again later with the arrays
+// copied from the memory-mapped file. The contents of shared Data are 
+// copied when the Data is created, as the application memory might be 
+// gone by the time the scene is saved, so in-place changes made to it 
+// afterwards aren't recorded. While recording, memory use is therefore 
+// up to twice the size of all Data created.
+//
+// File layout (all values in native byte order and sizes, so files can
+// only be loaded on hosts with the same byte order, which is checked):
+//   "OSPSCENE", uint32 version, uint32 0, uint64 table size, uint64 payload offset
+//   table: uint64 object count, then per object (children before parents):
+//     int32 type, strings subtypes, ids constructor args, params,
+//     plus for Data: int32 element type, uint64 num_items[3], uint64 payload offset and size
+//   payloads, each aligned to SCENE_PAYLOAD_ALIGNMENT bytes
+// Object references are stored as int64 ids (the object's index in the
+// table), or -1 for none.
+
+const char SCENE_MAGIC[8] = { 'O', 'S', 'P', 'S', 'C', 'E', 'N', 'E' };
+const uint32_t SCENE_VERSION = 1;
+const size_t SCENE_PAYLOAD_ALIGNMENT = 64;
+
+// Size in bytes of an element of the given type, 0 if not supported
+inline size_t
+osp_type_size(OSPDataType type)
+{
+    if (osp_is_object_type(type))
+        return sizeof(OSPObject);
+
+    switch (type)
+    {
+      case OSP_BOOL: case OSP_CHAR: case OSP_UCHAR:
+        return 1;
+      case OSP_VEC2UC: case OSP_SHORT: case OSP_USHORT:
+        return 2;
+      case OSP_VEC3UC:
+        return 3;
+      case OSP_VEC4UC: case OSP_INT: case OSP_UINT: case OSP_FLOAT:
+        return 4;
+      case OSP_VEC2I: case OSP_VEC2UI: case OSP_VEC2F: case OSP_LONG: case OSP_ULONG: case OSP_DOUBLE:
+      case OSP_BOX1I: case OSP_BOX1F:
+        return 8;
+      case OSP_VEC3I: case OSP_VEC3UI: case OSP_VEC3F:
+        return 12;
+      case OSP_VEC4I: case OSP_VEC4UI: case OSP_VEC4F: case OSP_VEC2L: case OSP_VEC2UL:
+      case OSP_BOX2I: case OSP_BOX2F: case OSP_LINEAR2F:
+        return 16;
+      case OSP_VEC3L: case OSP_VEC3UL: case OSP_BOX3I: case OSP_BOX3F: case OSP_AFFINE2F:
+        return 24;
+      case OSP_VEC4L: case OSP_VEC4UL: case OSP_BOX4I: case OSP_BOX4F:
+        return 32;
+      case OSP_LINEAR3F:
+        return 36;
+      case OSP_AFFINE3F:
+        return 48;
+      default:
+        return 0;
+    }
+}
+
+struct RecordedParam
+{
+    std::string                 name;
+    OSPDataType                 type;
+    std::vector<unsigned char>  value;      // Raw value, string (incl. 0) or object handle
+};
+
+struct RecordedObject
+{
+    OSPDataType                 type;
+    std::vector<std::string>    subtypes;   // E.g. "mesh", or renderer and material type
+    std::vector<OSPObject>      args;       // Constructor arguments, e.g. the group of an instance
+    std::vector<RecordedParam>  params;     // In the order first set
+
+    // Data only
+    OSPDataType                 data_type;
+    uint64_t                    num_items[3];
+    bool                        copy_source;// Shared data used as the source of ospCopyData()
+    std::vector<unsigned char>  payload;    // Contents, compact
+
+    size_t
+    num_elements() const
+    {
+        return num_items[0] * num_items[1] * num_items[2];
+    }
+};
+
+// Recorded objects by handle. Each recorded object is retained, so its
+// handle stays unique until recording is stopped.
+class SceneRecorder
+{
+public:
+
+    SceneRecorder()
+    :
+        active(false)
+    {
+    }
+
+    bool recording() const { return active; }
+
+    // Stopping also drops (and releases) all recorded objects
+    void
+    set_recording(bool enable)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = enable;
+        if (!enable)
+        {
+            for (auto& o : objects)
+                ospRelease(o.first);
+            objects.clear();
+        }
+    }
+
+    size_t
+    num_objects()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return objects.size();
+    }
+
+    void
+    add(OSPObject handle, OSPDataType type, const std::vector<std::string>& subtypes, const std::vector<OSPObject>& args={})
+    {
+        if (!active || handle == nullptr)
+            return;
+
+        RecordedObject o;
+        o.type = type;
+        o.subtypes = subtypes;
+        o.args = args;
+        o.data_type = OSP_UNKNOWN;
+        o.copy_source = false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (objects.find(handle) == objects.end())
+            ospRetain(handle);
+        objects[handle] = o;
+    }
+
+    void
+    add_data(OSPData handle, const void *shared, OSPDataType type, uint64_t n1, int64_t s1, uint64_t n2, int64_t s2, uint64_t n3, int64_t s3)
+    {
+        if (!active || handle == nullptr)
+            return;
+
+        add(handle, OSP_DATA, {});
+
+        std::lock_guard<std::mutex> lock(mutex);
+        RecordedObject& o = objects[handle];
+        o.data_type = type;
+        o.num_items[0] = n1; o.num_items[1] = n2; o.num_items[2] = n3;
+
+        const size_t size = osp_type_size(type);
+        if (shared == nullptr || size == 0)
+            return;
+
+        // Compact strides for 0 values, as OSPRay does
+        const int64_t stride0 = s1 != 0 ? s1 : (int64_t)size;
+        const int64_t stride1 = s2 != 0 ? s2 : stride0 * (int64_t)n1;
+        const int64_t stride2 = s3 != 0 ? s3 : stride1 * (int64_t)n2;
+
+        // Copy the (possibly strided) application memory
+        const unsigned char *src = static_cast<const unsigned char*>(shared);
+        o.payload.resize(o.num_elements() * size);
+        unsigned char *dst = o.payload.data();
+        for (uint64_t z = 0; z < n3; z++)
+            for (uint64_t y = 0; y < n2; y++)
+            {
+                const unsigned char *row = src + (int64_t)y*stride1 + (int64_t)z*stride2;
+                if (stride0 == (int64_t)size)
+                {
+                    std::memcpy(dst, row, n1*size);
+                    dst += n1*size;
+                    continue;
+                }
+                for (uint64_t x = 0; x < n1; x++, dst += size)
+                    std::memcpy(dst, row + (int64_t)x*stride0, size);
+            }
+    }
+
+    void
+    set_param(OSPObject handle, const char *name, OSPDataType type, const void *mem)
+    {
+        if (!active)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        if (it == objects.end())
+            return;
+
+        RecordedParam p;
+        p.name = name;
+        p.type = type;
+        if (type == OSP_STRING)
+        {
+            const char *s = static_cast<const char*>(mem);
+            p.value.assign(s, s + std::strlen(s) + 1);
+        }
+        else
+        {
+            // Unsupported types (e.g. OSP_VOID_PTR) are recorded without
+            // value, and are an error when saving
+            const unsigned char *v = static_cast<const unsigned char*>(mem);
+            p.value.assign(v, v + osp_type_size(type));
+        }
+
+        std::vector<RecordedParam>& params = it->second.params;
+        for (RecordedParam& q : params)
+        {
+            if (q.name == p.name)
+            {
+                q = p;
+                return;
+            }
+        }
+        params.push_back(p);
+    }
+
+    void
+    remove_param(OSPObject handle, const char *name)
+    {
+        if (!active)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        if (it == objects.end())
+            return;
+
+        std::vector<RecordedParam>& params = it->second.params;
+        for (size_t i = 0; i < params.size(); i++)
+        {
+            if (params[i].name == name)
+            {
+                params.erase(params.begin() + i);
+                return;
+            }
+        }
+    }
+
+    // Copy the contents of source data into the payload of destination
+    // data, at the given index
+    void
+    copy_data(OSPData source, OSPData destination, uint64_t i1, uint64_t i2, uint64_t i3)
+    {
+        if (!active)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto src_it = objects.find(source), dst_it = objects.find(destination);
+        if (src_it == objects.end() || dst_it == objects.end())
+            return;
+
+        RecordedObject& src = src_it->second;
+        RecordedObject& dst = dst_it->second;
+        const size_t size = osp_type_size(dst.data_type);
+
+        if (size == 0 || src.data_type != dst.data_type)
+            return;
+
+        src.copy_source = true;
+        dst.payload.resize(dst.num_elements() * size);
+
+        // Both compact
+        if (src.payload.empty())
+            return;
+        for (uint64_t z = 0; z < src.num_items[2] && i3+z < dst.num_items[2]; z++)
+            for (uint64_t y = 0; y < src.num_items[1] && i2+y < dst.num_items[1]; y++)
+            {
+                const uint64_t n = std::min(src.num_items[0], dst.num_items[0] - std::min(i1, dst.num_items[0]));
+                std::memcpy(&dst.payload[(((i3+z)*dst.num_items[1] + i2+y)*dst.num_items[0] + i1)*size],
+                    &src.payload[((z*src.num_items[1] + y)*src.num_items[0])*size], n*size);
+            }
+    }
+
+    // Drop the record of temporary shared data once the application
+    // releases it, i.e. the source data of CopiedData. Returns true if
+    // the recorder's reference was released.
+    bool
+    release(OSPObject handle)
+    {
+        if (!active)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        if (it == objects.end() || !it->second.copy_source)
+            return false;
+
+        objects.erase(it);
+        ospRelease(handle);
+
+        return true;
+    }
+
+    void save(OSPObject root, const std::string& path);
+
+protected:
+
+    std::atomic<bool>                               active;
+    std::mutex                                      mutex;
+    std::unordered_map<OSPObject, RecordedObject>   objects;
+};
+
+inline SceneRecorder&
+scene_recorder()
+{
+    static SceneRecorder recorder;
+    return recorder;
+}
+
+// Serialization helpers
+
+inline void
+scene_put(std::vector<unsigned char>& buf, const void *p, size_t n)
+{
+    const unsigned char *b = static_cast<const unsigned char*>(p);
+    buf.insert(buf.end(), b, b + n);
+}
+
+template<typename T>
+void
+scene_put(std::vector<unsigned char>& buf, T v)
+{
+    scene_put(buf, &v, sizeof(T));
+}
+
+inline void
+scene_put_string(std::vector<unsigned char>& buf, const std::string& s)
+{
+    scene_put(buf, (uint32_t)s.size());
+    scene_put(buf, s.data(), s.size());
+}
+
+class SceneReader
+{
+public:
+
+    SceneReader(const unsigned char *p, size_t n)
+    :
+        p(p), end(p + n)
+    {
+    }
+
+    const unsigned char*
+    bytes(size_t n)
+    {
+        if (n > (size_t)(end - p))
+            throw std::runtime_error("invalid scene file (truncated)");
+        const unsigned char *res = p;
+        p += n;
+        return res;
+    }
+
+    template<typename T>
+    T
+    get()
+    {
+        T v;
+        std::memcpy(&v, bytes(sizeof(T)), sizeof(T));
+        return v;
+    }
+
+    std::string
+    get_string()
+    {
+        const uint32_t n = get<uint32_t>();
+        const char *s = reinterpret_cast<const char*>(bytes(n));
+        return std::string(s, n);
+    }
+
+protected:
+    const unsigned char *p, *end;
+};
+
+inline size_t
+scene_aligned(size_t n)
+{
+    return (n + SCENE_PAYLOAD_ALIGNMENT - 1) / SCENE_PAYLOAD_ALIGNMENT * SCENE_PAYLOAD_ALIGNMENT;
+}
+
+// Save everything reachable from root to a file. Throws if any of those
+// objects wasn't recorded.
+inline void
+SceneRecorder::save(OSPObject root, const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Order objects so that children come before their parents
+    std::vector<OSPObject> order;
+    std::unordered_map<OSPObject, int64_t> ids;
+
+    std::function<void(OSPObject)> visit = [&](OSPObject h) {
+        if (h == nullptr || ids.find(h) != ids.end())
+            return;
+
+        auto it = objects.find(h);
+        if (it == objects.end())
+            throw std::runtime_error("scene contains an object that wasn't recorded, enable recording before creating the scene");
+        const RecordedObject& o = it->second;
+
+        // Marks the object as being visited, the OSPRay object graph has no cycles
+        ids[h] = -1;
+
+        for (OSPObject arg : o.args)
+            visit(arg);
+
+        for (const RecordedParam& p : o.params)
+        {
+            if (osp_is_object_type(p.type))
+            {
+                OSPObject child;
+                std::memcpy(&child, p.value.data(), sizeof(OSPObject));
+                visit(child);
+            }
+        }
+
+        if (o.type == OSP_DATA && osp_is_object_type(o.data_type))
+        {
+            for (size_t i = 0; i < o.num_elements(); i++)
+            {
+                OSPObject child;
+                if (o.payload.empty())
+                    continue;
+                std::memcpy(&child, &o.payload[i*sizeof(OSPObject)], sizeof(OSPObject));
+                visit(child);
+            }
+        }
+
+        ids[h] = order.size();
+        order.push_back(h);
+    };
+
+    visit(root);
+
+    auto id_of = [&](OSPObject h) -> int64_t {
+        return h == nullptr ? -1 : ids[h];
+    };
+
+    // Payload of each Data object: contents, with object handles as ids
+    auto payload_size = [&](const RecordedObject& o) -> size_t {
+        if (osp_is_object_type(o.data_type))
+            return o.num_elements() * sizeof(int64_t);
+        return o.num_elements() * osp_type_size(o.data_type);
+    };
+
+    std::vector<unsigned char> table;
+    scene_put(table, (uint64_t)order.size());
+    size_t payload_end = 0;
+
+    for (OSPObject h : order)
+    {
+        const RecordedObject& o = objects[h];
+
+        scene_put(table, (int32_t)o.type);
+
+        scene_put(table, (uint32_t)o.subtypes.size());
+        for (const std::string& s : o.subtypes)
+            scene_put_string(table, s);
+
+        scene_put(table, (uint32_t)o.args.size());
+        for (OSPObject arg : o.args)
+            scene_put(table, id_of(arg));
+
+        scene_put(table, (uint32_t)o.params.size());
+        for (const RecordedParam& p : o.params)
+        {
+            if (p.type != OSP_STRING && osp_type_size(p.type) == 0)
+                throw std::runtime_error("parameter '" + p.name + "' has a type that can't be saved");
+
+            scene_put_string(table, p.name);
+            scene_put(table, (int32_t)p.type);
+            if (osp_is_object_type(p.type))
+            {
+                OSPObject child;
+                std::memcpy(&child, p.value.data(), sizeof(OSPObject));
+                scene_put(table, (uint32_t)sizeof(int64_t));
+                scene_put(table, id_of(child));
+            }
+            else
+            {
+                scene_put(table, (uint32_t)p.value.size());
+                scene_put(table, p.value.data(), p.value.size());
+            }
+        }
+
+        if (o.type == OSP_DATA)
+        {
+            if (osp_type_size(o.data_type) == 0)
+                throw std::runtime_error("data has an element type that can't be saved");
+
+            const size_t size = payload_size(o);
+            scene_put(table, (int32_t)o.data_type);
+            for (int d = 0; d < 3; d++)
+                scene_put(table, (uint64_t)o.num_items[d]);
+            scene_put(table, (uint64_t)payload_end);
+            scene_put(table, (uint64_t)size);
+            payload_end = scene_aligned(payload_end + size);
+        }
+    }
+
+    std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("can't open '" + path + "' for writing");
+
+    const size_t header_size = sizeof(SCENE_MAGIC) + 2*sizeof(uint32_t) + 2*sizeof(uint64_t);
+    const uint64_t payload_offset = scene_aligned(header_size + table.size());
+
+    std::vector<unsigned char> header;
+    scene_put(header, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+    scene_put(header, SCENE_VERSION);
+    scene_put(header, (uint32_t)0);
+    scene_put(header, (uint64_t)table.size());
+    scene_put(header, payload_offset);
+
+    const std::vector<char> zeros(SCENE_PAYLOAD_ALIGNMENT, 0);
+    f.write(reinterpret_cast<const char*>(header.data()), header.size());
+    f.write(reinterpret_cast<const char*>(table.data()), table.size());
+    f.write(zeros.data(), payload_offset - header_size - table.size());
+
+    // Payloads, in the same order as in the table
+    std::vector<unsigned char> row;
+    for (OSPObject h : order)
+    {
+        const RecordedObject& o = objects[h];
+        if (o.type != OSP_DATA)
+            continue;
+
+        const size_t size = payload_size(o);
+
+        if (osp_is_object_type(o.data_type))
+        {
+            row.clear();
+            for (size_t i = 0; i < o.num_elements(); i++)
+            {
+                OSPObject child = nullptr;
+                if (!o.payload.empty())
+                    std::memcpy(&child, &o.payload[i*sizeof(OSPObject)], sizeof(OSPObject));
+                scene_put(row, id_of(child));
+            }
+            f.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+        else if (o.payload.size() == size)
+            f.write(reinterpret_cast<const char*>(o.payload.data()), size);
+        else
+        {
+            // Never written to
+            const std::vector<char> empty(size, 0);
+            f.write(empty.data(), size);
+        }
+
+        f.write(zeros.data(), scene_aligned(size) - size);
+    }
+
+    if (!f)
+        throw std::runtime_error("error writing '" + path + "'");
+}
+
+// Create the objects stored in a scene file, which is in memory at base
+// (only during the call, Data contents are copied). Objects are
+// committed after creation. Returns the root object, of which the caller
+// owns a reference.
+inline OSPObject
+scene_load(const unsigned char *base, size_t size)
+{
+    SceneReader header(base, size);
+
+    if (std::memcmp(header.bytes(sizeof(SCENE_MAGIC)), SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0)
+        throw std::runtime_error("not a scene file");
+    const uint32_t version = header.get<uint32_t>();
+    const uint32_t swapped_version = (SCENE_VERSION >> 24) | ((SCENE_VERSION >> 8) & 0xff00) | 
+        ((SCENE_VERSION << 8) & 0xff0000) | (SCENE_VERSION << 24);
+    if (version == swapped_version)
+        throw std::runtime_error("scene file was written on a host with a different byte order");
+    if (version != SCENE_VERSION)
+        throw std::runtime_error("unsupported scene file version");
+    header.get<uint32_t>();
+
+    const uint64_t table_size = header.get<uint64_t>();
+    const uint64_t payload_offset = header.get<uint64_t>();
+    if (payload_offset > size)
+        throw std::runtime_error("invalid scene file (truncated)");
+
+    SceneReader table(header.bytes(table_size), table_size);
+    const unsigned char *payloads = base + payload_offset;
+    const size_t payloads_size = size - payload_offset;
+
+    const uint64_t n = table.get<uint64_t>();
+    std::vector<OSPObject> objects;
+
+    auto object = [&](int64_t id) -> OSPObject {
+        if (id < -1 || id >= (int64_t)objects.size())
+            throw std::runtime_error("invalid scene file (object reference)");
+        return id < 0 ? nullptr : objects[id];
+    };
+
+    try
+    {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            const OSPDataType type = (OSPDataType)table.get<int32_t>();
+
+            std::vector<std::string> subtypes(table.get<uint32_t>());
+            for (std::string& s : subtypes)
+                s = table.get_string();
+
+            std::vector<OSPObject> args(table.get<uint32_t>());
+            for (OSPObject& arg : args)
+                arg = object(table.get<int64_t>());
+
+            auto subtype = [&](size_t j) -> const char* {
+                if (j >= subtypes.size())
+                    throw std::runtime_error("invalid scene file (missing object subtype)");
+                return subtypes[j].c_str();
+            };
+            auto arg = [&](size_t j) -> OSPObject {
+                return j < args.size() ? args[j] : nullptr;
+            };
+
+            // Parameters are read first, so Data can be created at the end
+            struct Param { std::string name; OSPDataType type; const unsigned char *value; uint32_t size; };
+            std::vector<Param> params(table.get<uint32_t>());
+            for (Param& p : params)
+            {
+                p.name = table.get_string();
+                p.type = (OSPDataType)table.get<int32_t>();
+                p.size = table.get<uint32_t>();
+                p.value = table.bytes(p.size);
+            }
+
+            OSPObject h = nullptr;
+
+            switch (type)
+            {
+              case OSP_GEOMETRY:            h = ospNewGeometry(subtype(0)); break;
+              case OSP_VOLUME:              h = ospNewVolume(subtype(0)); break;
+              case OSP_GEOMETRIC_MODEL:     h = ospNewGeometricModel((OSPGeometry)arg(0)); break;
+              case OSP_VOLUMETRIC_MODEL:    h = ospNewVolumetricModel((OSPVolume)arg(0)); break;
+              case OSP_MATERIAL:            h = ospNewMaterial(subtype(0), subtype(1)); break;
+              case OSP_TRANSFER_FUNCTION:   h = ospNewTransferFunction(subtype(0)); break;
+              case OSP_TEXTURE:             h = ospNewTexture(subtype(0)); break;
+              case OSP_LIGHT:               h = ospNewLight(subtype(0)); break;
+              case OSP_GROUP:               h = ospNewGroup(); break;
+              case OSP_INSTANCE:            h = ospNewInstance((OSPGroup)arg(0)); break;
+              case OSP_WORLD:               h = ospNewWorld(); break;
+              case OSP_DATA:
+              {
+                const OSPDataType data_type = (OSPDataType)table.get<int32_t>();
+                uint64_t num_items[3];
+                for (int d = 0; d < 3; d++)
+                    num_items[d] = table.get<uint64_t>();
+                const uint64_t offset = table.get<uint64_t>();
+                const uint64_t nbytes = table.get<uint64_t>();
+
+                if (offset > payloads_size || nbytes > payloads_size - offset)
+                    throw std::runtime_error("invalid scene file (truncated payload)");
+                const unsigned char *payload = payloads + offset;
+
+                if (osp_is_object_type(data_type))
+                {
+                    // Handles can't be shared from the file, so copy
+                    const size_t count = nbytes / sizeof(int64_t);
+                    std::vector<OSPObject> handles(count);
+                    for (size_t j = 0; j < count; j++)
+                    {
+                        int64_t id;
+                        std::memcpy(&id, payload + j*sizeof(int64_t), sizeof(int64_t));
+                        handles[j] = object(id);
+                    }
+
+                    OSPData tmp = ospNewSharedData(handles.data(), data_type, num_items[0], 0, num_items[1], 0, num_items[2], 0);
+                    OSPData data = ospNewData(data_type, num_items[0], num_items[1], num_items[2]);
+                    ospCopyData(tmp, data);
+                    object_tracker().created_data(data, handles.data(), data_type, 
+                        num_items[0], 0, num_items[1], 0, num_items[2], 0);
+                    ospRelease(tmp);
+                    h = data;
+                }
+                else
+                {
+                    // Copied, as OSPRay can use the Data for longer than
+                    // the file stays mapped
+                    OSPData tmp = ospNewSharedData(payload, data_type, num_items[0], 0, num_items[1], 0, num_items[2], 0);
+                    OSPData data = ospNewData(data_type, num_items[0], num_items[1], num_items[2]);
+                    ospCopyData(tmp, data);
+                    object_tracker().created_data(data, payload, data_type, 
+                        num_items[0], 0, num_items[1], 0, num_items[2], 0);
+                    ospRelease(tmp);
+                    h = data;
+                }
+                break;
+              }
+              default:
+                throw std::runtime_error("invalid scene file (unsupported object type " + std::to_string((int)type) + ")");
+            }
+
+            if (h == nullptr)
+                throw std::runtime_error("failed to create object " + std::to_string(i) + " of scene");
+            objects.push_back(h);
+            if (type == OSP_GEOMETRIC_MODEL)
+                object_tracker().created(h, type, nullptr, "geometry", arg(0));
+            else if (type == OSP_VOLUMETRIC_MODEL)
+                object_tracker().created(h, type, nullptr, "volume", arg(0));
+            else if (type == OSP_INSTANCE)
+                object_tracker().created(h, type, nullptr, "group", arg(0));
+            else if (type != OSP_DATA)
+                object_tracker().created(h, type, subtypes.empty() ? nullptr : subtypes.back().c_str());
+
+            for (const Param& p : params)
+            {
+                if (osp_is_object_type(p.type))
+                {
+                    int64_t id;
+                    if (p.size != sizeof(id))
+                        throw std::runtime_error("invalid scene file (object parameter)");
+                    std::memcpy(&id, p.value, sizeof(id));
+                    OSPObject child = object(id);
+                    ospSetParam(h, p.name.c_str(), p.type, &child);
+                    object_tracker().set_param(h, p.name.c_str(), p.type, &child);
+                }
+                else
+                {
+                    // Copied, as values in the table aren't necessarily aligned
+                    std::vector<unsigned char> value(p.value, p.value + p.size);
+                    ospSetParam(h, p.name.c_str(), p.type, value.data());
+                }
+            }
+
+            if (type != OSP_DATA)
+            {
+                const auto t0 = std::chrono::steady_clock::now();
+                ospCommit(h);
+                if (object_tracker().is_enabled())
+                    object_tracker().committed(h, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+            }
+        }
+
+        if (objects.empty())
+            throw std::runtime_error("empty scene file");
+    }
+    catch (...)
+    {
+        for (OSPObject h : objects)
+        {
+            object_tracker().released(h);
+            ospRelease(h);
+        }
+        throw;
+    }
+
+    // Parents hold references to their children, so only keep the root
+    for (size_t i = 0; i+1 < objects.size(); i++)
+    {
+        object_tracker().released(objects[i]);
+        ospRelease(objects[i]);
+    }
+
+    return objects.back();
+}
+
+// Redirects of the OSPRay API calls used by ospray_cpp, recording objects
+// when enabled and tracking changes (see tracking.h). The functions call 
+// the actual API functions, as the macros below aren't defined yet at that
+// point.
+
+inline OSPGeometry
+recorded_ospNewGeometry(const char *type)
+{
+    OSPGeometry h = ospNewGeometry(type);
+    object_tracker().created(h, OSP_GEOMETRY, type);
+    scene_recorder().add(h, OSP_GEOMETRY, { type });
+    return h;
+}
+
+inline OSPVolume
+recorded_ospNewVolume(const char *type)
+{
+    OSPVolume h = ospNewVolume(type);
+    object_tracker().created(h, OSP_VOLUME, type);
+    scene_recorder().add(h, OSP_VOLUME, { type });
+    return h;
+}
+
+inline OSPGeometricModel
+recorded_ospNewGeometricModel(OSPGeometry geometry = nullptr)
+{
+    OSPGeometricModel h = ospNewGeometricModel(geometry);
+    object_tracker().created(h, OSP_GEOMETRIC_MODEL, nullptr, "geometry", geometry);
+    scene_recorder().add(h, OSP_GEOMETRIC_MODEL, {}, { geometry });
+    return h;
+}
+
+inline OSPVolumetricModel
+recorded_ospNewVolumetricModel(OSPVolume volume = nullptr)
+{
+    OSPVolumetricModel h = ospNewVolumetricModel(volume);
+    object_tracker().created(h, OSP_VOLUMETRIC_MODEL, nullptr, "volume", volume);
+    scene_recorder().add(h, OSP_VOLUMETRIC_MODEL, {}, { volume });
+    return h;
+}
+
+inline OSPMaterial
+recorded_ospNewMaterial(const char *renderer_type, const char *material_type)
+{
+    OSPMaterial h = ospNewMaterial(renderer_type, material_type);
+    object_tracker().created(h, OSP_MATERIAL, material_type);
+    scene_recorder().add(h, OSP_MATERIAL, { renderer_type, material_type });
+    return h;
+}
+
+inline OSPTransferFunction
+recorded_ospNewTransferFunction(const char *type)
+{
+    OSPTransferFunction h = ospNewTransferFunction(type);
+    object_tracker().created(h, OSP_TRANSFER_FUNCTION, type);
+    scene_recorder().add(h, OSP_TRANSFER_FUNCTION, { type });
+    return h;
+}
+
+inline OSPTexture
+recorded_ospNewTexture(const char *type)
+{
+    OSPTexture h = ospNewTexture(type);
+    object_tracker().created(h, OSP_TEXTURE, type);
+    scene_recorder().add(h, OSP_TEXTURE, { type });
+    return h;
+}
+
+inline OSPLight
+recorded_ospNewLight(const char *type)
+{
+    OSPLight h = ospNewLight(type);
+    object_tracker().created(h, OSP_LIGHT, type);
+    scene_recorder().add(h, OSP_LIGHT, { type });
+    return h;
+}
+
+inline OSPGroup
+recorded_ospNewGroup()
+{
+    OSPGroup h = ospNewGroup();
+    object_tracker().created(h, OSP_GROUP);
+    scene_recorder().add(h, OSP_GROUP, {});
+    return h;
+}
+
+inline OSPInstance
+recorded_ospNewInstance(OSPGroup group = nullptr)
+{
+    OSPInstance h = ospNewInstance(group);
+    object_tracker().created(h, OSP_INSTANCE, nullptr, "group", group);
+    scene_recorder().add(h, OSP_INSTANCE, {}, { group });
+    return h;
+}
+
+inline OSPWorld
+recorded_ospNewWorld()
+{
+    OSPWorld h = ospNewWorld();
+    object_tracker().created(h, OSP_WORLD);
+    scene_recorder().add(h, OSP_WORLD, {});
+    return h;
+}
+
+// Not part of a scene, only tracked
+inline OSPFrameBuffer
+recorded_ospNewFrameBuffer(int width, int height, OSPFrameBufferFormat format = OSP_FB_SRGBA,
+    uint32_t channels = OSP_FB_COLOR)
+{
+    OSPFrameBuffer h = ospNewFrameBuffer(width, height, format, channels);
+    object_tracker().created_framebuffer(h, width, height, format, channels);
+    return h;
+}
+
+inline OSPData
+recorded_ospNewSharedData(const void *shared, OSPDataType type, uint64_t n1, int64_t s1 = 0,
+    uint64_t n2 = 1, int64_t s2 = 0, uint64_t n3 = 1, int64_t s3 = 0)
+{
+    OSPData h = ospNewSharedData(shared, type, n1, s1, n2, s2, n3, s3);
+    object_tracker().created_data(h, shared, type, n1, s1, n2, s2, n3, s3);
+    scene_recorder().add_data(h, shared, type, n1, s1, n2, s2, n3, s3);
+    return h;
+}
+
+inline OSPData
+recorded_ospNewData(OSPDataType type, uint64_t n1, uint64_t n2 = 1, uint64_t n3 = 1)
+{
+    OSPData h = ospNewData(type, n1, n2, n3);
+    object_tracker().created_data(h, nullptr, type, n1, 0, n2, 0, n3, 0);
+    scene_recorder().add_data(h, nullptr, type, n1, 0, n2, 0, n3, 0);
+    return h;
+}
+
+inline void
+recorded_ospCopyData(const OSPData source, OSPData destination, uint64_t i1 = 0, uint64_t i2 = 0, uint64_t i3 = 0)
+{
+    ospCopyData(source, destination, i1, i2, i3);
+    object_tracker().copy_data(source, destination);
+    scene_recorder().copy_data(source, destination, i1, i2, i3);
+}
+
+inline void
+recorded_ospSetParam(OSPObject h, const char *name, OSPDataType type, const void *mem)
+{
+    ospSetParam(h, name, type, mem);
+    object_tracker().set_param(h, name, type, mem);
+    scene_recorder().set_param(h, name, type, mem);
+}
+
+inline void
+recorded_ospRemoveParam(OSPObject h, const char *name)
+{
+    ospRemoveParam(h, name);
+    object_tracker().remove_param(h, name);
+    scene_recorder().remove_param(h, name);
+}
+
+inline void
+recorded_ospCommit(OSPObject h)
+{
+    if (!object_tracker().is_enabled())
+    {
+        ospCommit(h);
+        return;
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    ospCommit(h);
+    object_tracker().committed(h, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+}
+
+inline void
+recorded_ospRetain(OSPObject h)
+{
+    ospRetain(h);
+    object_tracker().retained(h);
+}
+
+inline void
+recorded_ospRelease(OSPObject h)
+{
+    object_tracker().released(h);
+    scene_recorder().release(h);
+    ospRelease(h);
+}
+
+#define ospNewGeometry(...)             recorded_ospNewGeometry(__VA_ARGS__)
+#define ospNewVolume(...)               recorded_ospNewVolume(__VA_ARGS__)
+#define ospNewGeometricModel(...)       recorded_ospNewGeometricModel(__VA_ARGS__)
+#define ospNewVolumetricModel(...)      recorded_ospNewVolumetricModel(__VA_ARGS__)
+#define ospNewMaterial(...)             recorded_ospNewMaterial(__VA_ARGS__)
+#define ospNewTransferFunction(...)     recorded_ospNewTransferFunction(__VA_ARGS__)
+#define ospNewTexture(...)              recorded_ospNewTexture(__VA_ARGS__)
+#define ospNewLight(...)                recorded_ospNewLight(__VA_ARGS__)
+#define ospNewGroup(...)                recorded_ospNewGroup(__VA_ARGS__)
+#define ospNewInstance(...)             recorded_ospNewInstance(__VA_ARGS__)
+#define ospNewWorld(...)                recorded_ospNewWorld(__VA_ARGS__)
+#define ospNewFrameBuffer(...)          recorded_ospNewFrameBuffer(__VA_ARGS__)
+#define ospNewSharedData(...)           recorded_ospNewSharedData(__VA_ARGS__)
+#define ospNewData(...)                 recorded_ospNewData(__VA_ARGS__)
+#define ospCopyData(...)                recorded_ospCopyData(__VA_ARGS__)
+#define ospSetParam(...)                recorded_ospSetParam(__VA_ARGS__)
+#define ospRemoveParam(...)             recorded_ospRemoveParam(__VA_ARGS__)
+#define ospCommit(...)                  recorded_ospCommit(__VA_ARGS__)
+#define ospRetain(...)                  recorded_ospRetain(__VA_ARGS__)
+#define ospRelease(...)                 recorded_ospRelease(__VA_ARGS__)
+
+// Variants from ospray_util.h
+#define ospNewSharedData1D(p, t, n1)                        recorded_ospNewSharedData(p, t, n1)
+#define ospNewSharedData1DStride(p, t, n1, s1)              recorded_ospNewSharedData(p, t, n1, s1)
+#define ospNewSharedData2D(p, t, n1, n2)                    recorded_ospNewSharedData(p, t, n1, 0, n2)
+#define ospNewSharedData2DStride(p, t, n1, s1, n2, s2)      recorded_ospNewSharedData(p, t, n1, s1, n2, s2)
+#define ospNewSharedData3D(p, t, n1, n2, n3)                recorded_ospNewSharedData(p, t, n1, 0, n2, 0, n3)
+#define ospNewSharedData3DStride(p, t, n1, s1, n2, s2, n3, s3)  recorded_ospNewSharedData(p, t, n1, s1, n2, s2, n3, s3)
+#define ospNewData1D(t, n1)                                 recorded_ospNewData(t, n1)
+#define ospNewData2D(t, n1, n2)                             recorded_ospNewData(t, n1, n2)
+#define ospCopyData1D(s, d, i1)                             recorded_ospCopyData(s, d, i1)
+#define ospCopyData2D(s, d, i1, i2)                         recorded_ospCopyData(s, d, i1, i2)
+
+#endif
@@ -0,0 +1,372 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#ifdef HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+#ifdef HAVE_WEBP
+#include <webp/encode.h>
+#endif
+#include "parallel.h"
+
+// Tiled frame streaming: an RGBA8 image is split into tiles, and only the
+// tiles that changed since the previous frame are encoded (in parallel)
+// into a single message.
+//
+// Message layout (little-endian):
+//   "OSPF", uint32 frame number, uint16 width, height, tile size, uint16 0,
+//   uint32 number of tiles, then per tile:
+//   uint16 tile x, tile y (in tiles), uint8 encoding, uint8 0, uint32 size, encoded bytes
+// Tiles at the right and top border can be smaller than the tile size.
+// Pixel rows are in framebuffer order, i.e. bottom row first.
+//
+// Encodings:
+// - raw: the tile's RGBA pixels, row by row
+// - delta: per byte the difference (mod 256) with the previously sent
+//   tile (all zeros before the first), run-length encoded as a control byte
+//   c followed by c+1 literal bytes if c < 128, or c-127 zero bytes otherwise
+// - jpeg, webp: compressed image of the tile, when available
+
+enum StreamEncoding
+{
+    STREAM_RAW = 0,
+    STREAM_DELTA = 1,
+    STREAM_JPEG = 2,
+    STREAM_WEBP = 3
+};
+
+const char STREAM_MAGIC[4] = { 'O', 'S', 'P', 'F' };
+
+inline bool
+stream_encoding_available(StreamEncoding encoding)
+{
+    switch (encoding)
+    {
+      case STREAM_RAW: case STREAM_DELTA:
+        return true;
+#ifdef HAVE_TURBOJPEG
+      case STREAM_JPEG:
+        return true;
+#endif
+#ifdef HAVE_WEBP
+      case STREAM_WEBP:
+        return true;
+#endif
+      default:
+        return false;
+    }
+}
+
+// Append the run-length encoded difference of cur and prev (n bytes)
+inline void
+stream_delta_encode(const unsigned char *cur, const unsigned char *prev, size_t n, std::vector<unsigned char>& out)
+{
+    size_t i = 0;
+    while (i < n)
+    {
+        // Zero run
+        size_t z = 0;
+        while (i + z < n && z < 128 && cur[i+z] == prev[i+z])
+            z++;
+        if (z > 0)
+        {
+            out.push_back((unsigned char)(127 + z));
+            i += z;
+            continue;
+        }
+
+        // Literal run, up to the next pair of zero differences (single
+        // zeros are cheaper to keep in the literal run)
+        size_t l = 0;
+        while (i + l < n && l < 128 &&
+               !(i + l + 1 < n && cur[i+l] == prev[i+l] && cur[i+l+1] == prev[i+l+1]))
+            l++;
+        out.push_back((unsigned char)(l - 1));
+        for (size_t j = 0; j < l; j++)
+            out.push_back((unsigned char)(cur[i+j] - prev[i+j]));
+        i += l;
+    }
+}
+
+class FrameStreamEncoder
+{
+public:
+
+    FrameStreamEncoder(unsigned width, unsigned height, unsigned tile_size, StreamEncoding encoding,
+        int quality, unsigned nthreads)
+    :
+        width(width), height(height), tile_size(tile_size), encoding(encoding), quality(quality),
+        nthreads(nthreads), frame(0)
+    {
+        if (width == 0 || height == 0 || width > 65535 || height > 65535)
+            throw std::invalid_argument("invalid frame size");
+        if (tile_size == 0 || tile_size > 65535)
+            throw std::invalid_argument("invalid tile size");
+        if (!stream_encoding_available(encoding))
+            throw std::invalid_argument("encoding not available in this build");
+
+        tiles_x = (width + tile_size - 1) / tile_size;
+        tiles_y = (height + tile_size - 1) / tile_size;
+        reset();
+    }
+
+    // Send all tiles with the next frame, e.g. for a new receiver
+    void
+    reset()
+    {
+        previous.assign((size_t)width * height * 4, 0);
+        force = true;
+    }
+
+    // Encode the tiles of pixels (width x height RGBA8) that differ from the
+    // previous frame into message, returns the number of tiles encoded
+    size_t
+    encode(const unsigned char *pixels, std::vector<unsigned char>& message)
+    {
+        const size_t ntiles = (size_t)tiles_x * tiles_y;
+        std::vector<std::vector<unsigned char>> encoded(ntiles);
+        std::vector<char> changed(ntiles, 0);
+        std::string error;
+        std::mutex error_mutex;
+
+        parallel_for(ntiles, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+            std::vector<unsigned char> tile;
+            for (size_t t = begin; t < end; t++)
+            {
+                unsigned x0, y0, w, h;
+                tile_rect(t, x0, y0, w, h);
+
+                if (!force && !tile_changed(pixels, x0, y0, w, h))
+                    continue;
+                changed[t] = 1;
+
+                try
+                {
+                    encode_tile(pixels, x0, y0, w, h, tile, encoded[t]);
+                }
+                catch (const std::exception& e)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    error = e.what();
+                }
+
+                // The tile is sent, so becomes the reference for the next frame
+                for (unsigned y = y0; y < y0 + h; y++)
+                {
+                    const size_t offset = ((size_t)y * width + x0) * 4;
+                    std::memcpy(&previous[offset], pixels + offset, (size_t)w * 4);
+                }
+            }
+        }, nthreads, 4);
+
+        if (!error.empty())
+        {
+            reset();
+            throw std::runtime_error(error);
+        }
+
+        size_t n = 0, size = 20;
+        for (size_t t = 0; t < ntiles; t++)
+        {
+            if (changed[t])
+            {
+                n++;
+                size += 10 + encoded[t].size();
+            }
+        }
+
+        message.clear();
+        message.reserve(size);
+        put(message, STREAM_MAGIC, 4);
+        put32(message, frame++);
+        put16(message, width);
+        put16(message, height);
+        put16(message, tile_size);
+        put16(message, 0);
+        put32(message, (uint32_t)n);
+
+        for (size_t t = 0; t < ntiles; t++)
+        {
+            if (!changed[t])
+                continue;
+            put16(message, (uint16_t)(t % tiles_x));
+            put16(message, (uint16_t)(t / tiles_x));
+            message.push_back((unsigned char)encoding);
+            message.push_back(0);
+            put32(message, (uint32_t)encoded[t].size());
+            put(message, encoded[t].data(), encoded[t].size());
+        }
+
+        force = false;
+
+        return n;
+    }
+
+    unsigned num_tiles() const { return tiles_x * tiles_y; }
+    uint32_t get_frame() const { return frame; }
+
+protected:
+
+    void
+    tile_rect(size_t t, unsigned& x0, unsigned& y0, unsigned& w, unsigned& h) const
+    {
+        x0 = (unsigned)(t % tiles_x) * tile_size;
+        y0 = (unsigned)(t / tiles_x) * tile_size;
+        w = std::min(tile_size, width - x0);
+        h = std::min(tile_size, height - y0);
+    }
+
+    bool
+    tile_changed(const unsigned char *pixels, unsigned x0, unsigned y0, unsigned w, unsigned h) const
+    {
+        for (unsigned y = y0; y < y0 + h; y++)
+        {
+            const size_t offset = ((size_t)y * width + x0) * 4;
+            if (std::memcmp(&previous[offset], pixels + offset, (size_t)w * 4) != 0)
+                return true;
+        }
+        return false;
+    }
+
+    void
+    encode_tile(const unsigned char *pixels, unsigned x0, unsigned y0, unsigned w, unsigned h,
+        std::vector<unsigned char>& tile, std::vector<unsigned char>& out) const
+    {
+        // Gather the tile's rows
+        const size_t row = (size_t)w * 4;
+        tile.resize(row * h);
+        for (unsigned y = 0; y < h; y++)
+            std::memcpy(&tile[y * row], pixels + ((size_t)(y0 + y) * width + x0) * 4, row);
+
+        switch (encoding)
+        {
+          case STREAM_RAW:
+            out = tile;
+            break;
+
+          case STREAM_DELTA:
+          {
+            out.clear();
+            for (unsigned y = 0; y < h; y++)
+            {
+                // Rows are encoded separately, as the previous frame isn't gathered
+                stream_delta_encode(&tile[y * row], &previous[((size_t)(y0 + y) * width + x0) * 4], row, out);
+            }
+            break;
+          }
+
+#ifdef HAVE_TURBOJPEG
+          case STREAM_JPEG:
+          {
+            tjhandle handle = tjInitCompress();
+            if (handle == nullptr)
+                throw std::runtime_error("tjInitCompress() failed");
+            unsigned char *jpeg = nullptr;
+            unsigned long size = 0;
+            const int res = tjCompress2(handle, tile.data(), (int)w, 0, (int)h, TJPF_RGBA,
+                &jpeg, &size, TJSAMP_420, quality, TJFLAG_FASTDCT);
+            if (res == 0)
+                out.assign(jpeg, jpeg + size);
+            tjFree(jpeg);
+            tjDestroy(handle);
+            if (res != 0)
+                throw std::runtime_error("JPEG compression failed");
+            break;
+          }
+#endif
+
+#ifdef HAVE_WEBP
+          case STREAM_WEBP:
+          {
+            uint8_t *webp = nullptr;
+            const size_t size = WebPEncodeRGBA(tile.data(), (int)w, (int)h, (int)row, (float)quality, &webp);
+            if (size > 0)
+                out.assign(webp, webp + size);
+            WebPFree(webp);
+            if (size == 0)
+                throw std::runtime_error("WebP compression failed");
+            break;
+          }
+#endif
+
+          default:
+            throw std::runtime_error("encoding not available");
+        }
+    }
+
+    static void
+    put(std::vector<unsigned char>& buf, const void *p, size_t n)
+    {
+        const unsigned char *b = static_cast<const unsigned char*>(p);
+        buf.insert(buf.end(), b, b + n);
+    }
+
+    static void
+    put16(std::vector<unsigned char>& buf, uint16_t v)
+    {
+        buf.push_back(v & 0xff);
+        buf.push_back(v >> 8);
+    }
+
+    static void
+    put32(std::vector<unsigned char>& buf, uint32_t v)
+    {
+        put16(buf, v & 0xffff);
+        put16(buf, v >> 16);
+    }
+
+    unsigned            width, height;
+    unsigned            tile_size;
+    unsigned            tiles_x, tiles_y;
+    StreamEncoding      encoding;
+    int                 quality;
+    unsigned            nthreads;
+    uint32_t            frame;
+    bool                force;
+
+    // Last sent contents of each tile
+    std::vector<unsigned char>  previous;
+};
+
+// Write all of data to a socket (or other file descriptor). Python
+// ignores SIGPIPE, so a closed connection results in an exception.
+// Non-blocking descriptors (e.g. Python sockets with a timeout) are 
+// waited on until writable, for at most timeout_ms milliseconds per 
+// wait (-1 waits indefinitely).
+inline void
+stream_write(int fd, const unsigned char *data, size_t n, int timeout_ms=-1)
+{
+    while (n > 0)
+    {
+        const ssize_t res = write(fd, data, n);
+        if (res < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+            
+            pollfd p { fd, POLLOUT, 0 };
+            const int ready = poll(&p, 1, timeout_ms);
+            if (ready < 0 && errno != EINTR)
+                throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+            if (ready == 0)
+                throw std::runtime_error("write timed out");
+            continue;
+        }
+        data += res;
+        n -= res;
+    }
+}
+
+#endif
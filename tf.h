@@ -0,0 +1,186 @@
+#ifndef TF_H
+#define TF_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// Sparse transfer function specification, i.e. a set of control points
+// with a value, RGB color and opacity each. Colors are stored as
+// consecutive RGB triplets.
+
+struct TFControlPoints
+{
+    std::vector<float>  values;
+    std::vector<float>  colors;
+    std::vector<float>  opacities;
+
+    // Only set when read from a .trn file
+    bool                has_value_range;
+    float               value_range[2];
+
+    TFControlPoints(): has_value_range(false)
+    {
+        value_range[0] = 0.0f;
+        value_range[1] = 1.0f;
+    }
+
+    size_t size() const { return values.size(); }
+};
+
+// Parse up to maxn floats from a line, returns the number parsed
+static int
+parse_floats(const char *s, float *res, int maxn)
+{
+    int n = 0;
+    char *end;
+
+    while (n < maxn)
+    {
+        errno = 0;
+        float v = strtof(s, &end);
+        if (end == s || errno != 0)
+            break;
+        res[n++] = v;
+        s = end;
+    }
+
+    // Anything but whitespace left means a malformed line
+    while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')
+        s++;
+    if (*s != '\0')
+        return -1;
+
+    return n;
+}
+
+// Read a .trn file:
+//
+//  # comment
+//  <minval> <maxval>
+//  <value> <r> <g> <b> <a>
+//  ...
+//
+// Control point values need to be ascending.
+void
+read_trn_file(const std::string& fname, TFControlPoints& cp)
+{
+    FILE *f = fopen(fname.c_str(), "rt");
+
+    if (f == nullptr)
+        throw std::runtime_error("Could not open transfer function file '" + fname + "'");
+
+    char line[1024];
+    int lineno = 0;
+    float v[6];
+
+    cp = TFControlPoints();
+
+    while (fgets(line, sizeof(line), f))
+    {
+        lineno++;
+
+        const char *s = line;
+        while (*s == ' ' || *s == '\t')
+            s++;
+        if (*s == '#' || *s == '\0' || *s == '\n' || *s == '\r')
+            continue;
+
+        int n = parse_floats(s, v, 6);
+
+        if (!cp.has_value_range)
+        {
+            if (n != 2)
+            {
+                fclose(f);
+                throw std::runtime_error(fname + ":" + std::to_string(lineno) + ": expected '<minval> <maxval>'");
+            }
+
+            cp.value_range[0] = v[0];
+            cp.value_range[1] = v[1];
+            cp.has_value_range = true;
+            continue;
+        }
+
+        if (n != 5)
+        {
+            fclose(f);
+            throw std::runtime_error(fname + ":" + std::to_string(lineno) + ": expected '<value> <r> <g> <b> <a>'");
+        }
+
+        cp.values.push_back(v[0]);
+        cp.colors.push_back(v[1]);
+        cp.colors.push_back(v[2]);
+        cp.colors.push_back(v[3]);
+        cp.opacities.push_back(v[4]);
+    }
+
+    fclose(f);
+
+    if (cp.size() < 2)
+        throw std::runtime_error("Transfer function file '" + fname + "' needs at least 2 control points");
+}
+
+// Resample the control points into T equidistant entries over
+// [minval, maxval]. Positions outside of the control point values get
+// the color/opacity of the first/last control point. Output arrays need
+// room for 3*T colors and T opacities.
+//
+// Both the positions and the control point values are ascending, so a
+// single merge-like sweep suffices, i.e. O(P+T).
+void
+resample_tf(const float *values, const float *colors, const float *opacities, size_t P,
+    float minval, float maxval, size_t T, float *tfcolors, float *tfopacities)
+{
+    if (P == 0)
+        throw std::invalid_argument("resample_tf(): need at least 1 control point");
+    if (T == 0)
+        throw std::invalid_argument("resample_tf(): resolution needs to be at least 1");
+
+    for (size_t i = 1; i < P; i++)
+    {
+        if (values[i] < values[i-1])
+            throw std::invalid_argument("resample_tf(): control point values need to be ascending");
+    }
+
+    const float step = T > 1 ? (maxval - minval) / (T - 1) : 0.0f;
+    size_t seg = 0;
+
+    for (size_t i = 0; i < T; i++)
+    {
+        const float pos = minval + i*step;
+        size_t lo, hi;
+        float f;
+
+        while (seg+2 < P && values[seg+1] < pos)
+            seg++;
+
+        if (P == 1 || pos <= values[0])
+        {
+            lo = hi = 0;
+            f = 0.0f;
+        }
+        else if (pos >= values[P-1])
+        {
+            lo = hi = P-1;
+            f = 0.0f;
+        }
+        else
+        {
+            lo = seg;
+            hi = seg+1;
+            const float w = values[hi] - values[lo];
+            f = w > 0.0f ? (pos - values[lo]) / w : 1.0f;
+        }
+
+        tfcolors[3*i+0] = (1-f)*colors[3*lo+0] + f*colors[3*hi+0];
+        tfcolors[3*i+1] = (1-f)*colors[3*lo+1] + f*colors[3*hi+1];
+        tfcolors[3*i+2] = (1-f)*colors[3*lo+2] + f*colors[3*hi+2];
+        tfopacities[i] = (1-f)*opacities[lo] + f*opacities[hi];
+    }
+}
+
+#endif
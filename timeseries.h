@@ -0,0 +1,278 @@
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "datacache.h"
+
+// Asynchronous loading of the steps of a time series. Steps are loaded
+// one at a time on a background thread, in the order they are requested,
+// and kept in a small LRU cache, so the next step(s) can be read and
+// converted while the current one is being rendered.
+
+typedef std::vector<char> StepBuffer;
+
+// Read exactly n bytes from the start of a raw file into dst
+inline void
+read_raw_file(const std::string& fname, size_t n, void *dst)
+{
+    FILE *f = fopen(fname.c_str(), "rb");
+
+    if (f == nullptr)
+        throw std::runtime_error("Could not open raw file '" + fname + "'");
+
+    const size_t read = fread(dst, 1, n, f);
+    fclose(f);
+
+    if (read != n)
+        throw std::runtime_error(fname + ": expected " + std::to_string(n) + " bytes, read " + std::to_string(read));
+}
+
+struct StepStatistics
+{
+    size_t  hits;           // Requested steps that were already loaded
+    size_t  misses;         // Requested steps that had to be waited for
+    size_t  loads;
+    double  load_time;      // Seconds spent loading, on the background thread
+    double  stall_time;     // Seconds spent waiting for steps to load
+};
+
+class StepPrefetcher
+{
+public:
+
+    // Loads step t into the (empty) buffer, called on the background thread
+    typedef std::function<void(size_t, StepBuffer&)> Loader;
+
+    StepPrefetcher(size_t num_steps, const Loader& loader, size_t cache_size)
+    :
+        num_steps(num_steps), loader(loader), cache(cache_size), loading(false),
+        loading_step(0), stop(false), stats()
+    {
+        if (cache_size < 1)
+            throw std::invalid_argument("cache size needs to be at least 1");
+
+        worker = std::thread([this]() { run(); });
+    }
+
+    ~StepPrefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+            requested.notify_all();
+        }
+        worker.join();
+    }
+
+    // Queue step t for loading, unless it's already loaded, queued or
+    // being loaded. Errors are reported by get().
+    void
+    prefetch(size_t t)
+    {
+        check_step(t);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending(t))
+            return;
+
+        queue.push_back(t);
+        requested.notify_all();
+    }
+
+    // Step t, waiting for it to be loaded (ahead of any prefetched steps)
+    // when needed. Rethrows the exception of a failed load, after which a
+    // next get() retries.
+    std::shared_ptr<const StepBuffer>
+    get(size_t t)
+    {
+        check_step(t);
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        std::shared_ptr<StepBuffer> *cached = cache.get(t);
+        if (cached != nullptr)
+        {
+            stats.hits++;
+            return *cached;
+        }
+
+        errors.erase(t);
+        if (!(loading && loading_step == t))
+        {
+            for (auto it = queue.begin(); it != queue.end(); ++it)
+            {
+                if (*it == t)
+                {
+                    queue.erase(it);
+                    break;
+                }
+            }
+            queue.push_front(t);
+            requested.notify_all();
+        }
+
+        // The loaded buffer is handed over through delivered, as it could
+        // already be evicted from the cache by later prefetches when
+        // this thread wakes up
+        const auto t0 = std::chrono::steady_clock::now();
+        waiting[t]++;
+        loaded.wait(lock, [this, t]() { return delivered.count(t) > 0 || errors.count(t) > 0; });
+
+        std::shared_ptr<StepBuffer> res;
+        auto it = delivered.find(t);
+        if (it != delivered.end())
+            res = it->second;
+        if (--waiting[t] == 0)
+        {
+            waiting.erase(t);
+            delivered.erase(t);
+        }
+
+        stats.misses++;
+        stats.stall_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        if (!res)
+            std::rethrow_exception(errors[t]);
+
+        return res;
+    }
+
+    bool
+    is_ready(size_t t)
+    {
+        check_step(t);
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache.get(t) != nullptr;
+    }
+
+    // Loaded steps, in ascending order
+    std::vector<size_t>
+    cached_steps()
+    {
+        std::vector<size_t> res;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t t = 0; t < num_steps; t++)
+        {
+            if (cache.contains(t))
+                res.push_back(t);
+        }
+        return res;
+    }
+
+    StepStatistics
+    statistics()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+protected:
+
+    void
+    check_step(size_t t) const
+    {
+        if (t >= num_steps)
+            throw std::out_of_range("invalid time step " + std::to_string(t));
+    }
+
+    // Called with the mutex held
+    bool
+    pending(size_t t)
+    {
+        if (cache.contains(t) || (loading && loading_step == t))
+            return true;
+        for (size_t q : queue)
+        {
+            if (q == t)
+                return true;
+        }
+        return false;
+    }
+
+    void
+    run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true)
+        {
+            requested.wait(lock, [this]() { return stop || !queue.empty(); });
+            if (stop)
+                return;
+
+            const size_t t = queue.front();
+            queue.pop_front();
+            if (cache.contains(t))
+                continue;
+
+            loading = true;
+            loading_step = t;
+            lock.unlock();
+
+            std::shared_ptr<StepBuffer> buffer = std::make_shared<StepBuffer>();
+            std::exception_ptr error;
+            const auto t0 = std::chrono::steady_clock::now();
+
+            try
+            {
+                loader(t, *buffer);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            lock.lock();
+            loading = false;
+            stats.loads++;
+            stats.load_time += elapsed;
+
+            if (error)
+                errors[t] = error;
+            else
+            {
+                cache.put(t, buffer, 1);
+                if (waiting.count(t) > 0)
+                    delivered[t] = buffer;
+            }
+
+            loaded.notify_all();
+        }
+    }
+
+    const size_t                num_steps;
+    Loader                      loader;
+
+    // Cache sizes count steps, not bytes
+    LRUCache<size_t, std::shared_ptr<StepBuffer>, std::hash<size_t>>   cache;
+
+    std::deque<size_t>          queue;
+    bool                        loading;
+    size_t                      loading_step;
+    std::map<size_t, std::exception_ptr>            errors;
+    std::map<size_t, int>                           waiting;
+    std::map<size_t, std::shared_ptr<StepBuffer>>   delivered;
+
+    std::thread                 worker;
+    std::mutex                  mutex;
+    std::condition_variable     requested;
+    std::condition_variable     loaded;
+    bool                        stop;
+    StepStatistics              stats;
+};
+
+#endif
@@ -0,0 +1,665 @@
+#ifndef TRACKING_H
+#define TRACKING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <ospray/ospray.h>
+
+// Tracking of the changes made to objects through the OSPRay API redirects
+// in scene.h. Only the element type and size of Data (for in-place 
+// updates) and the size and format of FrameBuffers (for checking mapped 
+// buffers, as OSPRay has no API to query these) are always tracked. When 
+// change tracking is enabled, which like scene recording is off by 
+// default, this also keeps per object whether it changed since it was 
+// last committed, the timing of its commits, and which objects it 
+// references (through object parameters, or as elements of an object 
+// array). This allows changes to be propagated to the objects
+// that use a changed object: committing an object marks its users as 
+// changed, as they need a commit to pick up the change. With tracking 
+// disabled the parameter and commit redirects don't take a lock.
+//
+// Data doesn't need a commit, so is never marked as changed itself. Copying
+// into Data marks its users as changed instead.
+//
+// The application references to each object are counted (ospRetain() and
+// ospRelease()). An entry is removed once the application released all its
+// references and no tracked object references it any more, mirroring when
+// OSPRay destroys the object. An entry also gets reset when a new object 
+// reuses its handle. Objects not created through the redirects (e.g. 
+// cameras) are tracked from their first change, without a reference of 
+// their own.
+
+inline bool
+osp_is_object_type(OSPDataType type)
+{
+    return type >= OSP_OBJECT && type <= OSP_WORLD;
+}
+
+// Python class name of an object type
+inline const char*
+osp_object_type_name(OSPDataType type)
+{
+    switch (type)
+    {
+      case OSP_CAMERA:              return "Camera";
+      case OSP_DATA:                return "Data";
+      case OSP_FRAMEBUFFER:         return "FrameBuffer";
+      case OSP_FUTURE:              return "Future";
+      case OSP_GEOMETRIC_MODEL:     return "GeometricModel";
+      case OSP_GEOMETRY:            return "Geometry";
+      case OSP_GROUP:               return "Group";
+      case OSP_IMAGE_OPERATION:     return "ImageOperation";
+      case OSP_INSTANCE:            return "Instance";
+      case OSP_LIGHT:               return "Light";
+      case OSP_MATERIAL:            return "Material";
+      case OSP_RENDERER:            return "Renderer";
+      case OSP_TEXTURE:             return "Texture";
+      case OSP_TRANSFER_FUNCTION:   return "TransferFunction";
+      case OSP_VOLUME:              return "Volume";
+      case OSP_VOLUMETRIC_MODEL:    return "VolumetricModel";
+      case OSP_WORLD:               return "World";
+      default:                      return "Object";
+    }
+}
+
+struct TrackedObject
+{
+    OSPDataType                                 type;           // OSP_UNKNOWN if not created through the redirects
+    std::string                                 subtype;        // E.g. "mesh", or the material type
+    int                                         refs;           // Application references
+    bool                                        dirty;
+    OSPDataType                                 data_type;      // OSP_UNKNOWN if not Data
+    uint64_t                                    num_items[3];   // Of Data, or FrameBuffer width and height
+    OSPFrameBufferFormat                        fb_format;      // OSP_FB_NONE if not a FrameBuffer
+    uint32_t                                    fb_channels;
+    std::unordered_map<std::string, OSPObject>  params;         // Object parameters
+    std::vector<OSPObject>                      elements;       // Of object arrays
+
+    size_t                                      commits;
+    double                                      commit_time;    // Seconds, of the last commit
+    double                                      total_commit_time;
+
+    TrackedObject()
+    :
+        type(OSP_UNKNOWN), refs(0), dirty(true), data_type(OSP_UNKNOWN),
+        fb_format(OSP_FB_NONE), fb_channels(0), commits(0), commit_time(0.0), total_commit_time(0.0)
+    {
+        num_items[0] = num_items[1] = num_items[2] = 0;
+    }
+};
+
+// Commit timing of one object
+struct CommitStatistics
+{
+    OSPObject       handle;
+    OSPDataType     type;
+    std::string     subtype;
+    uint64_t        primitives;
+    size_t          commits;
+    double          commit_time;
+    double          total_commit_time;
+};
+
+// Per geometry and volume type the parameter holding the primitives (or
+// cells), with the number of items per primitive. The first parameter
+// set is used.
+struct PrimitiveParam
+{
+    OSPDataType     type;
+    const char      *subtype;
+    const char      *param;
+    uint64_t        items_per_primitive;
+};
+
+const PrimitiveParam PRIMITIVE_PARAMS[] = {
+    { OSP_GEOMETRY, "mesh",                 "index",                1 },
+    { OSP_GEOMETRY, "mesh",                 "vertex.position",      3 },
+    { OSP_GEOMETRY, "subdivision",          "face",                 1 },
+    { OSP_GEOMETRY, "subdivision",          "index",                4 },
+    { OSP_GEOMETRY, "sphere",               "sphere.position",      1 },
+    { OSP_GEOMETRY, "curve",                "index",                1 },
+    { OSP_GEOMETRY, "box",                  "box",                  1 },
+    { OSP_GEOMETRY, "plane",                "plane.coefficients",   1 },
+    { OSP_GEOMETRY, "isosurface",           "isovalue",             1 },
+    { OSP_VOLUME,   "structuredRegular",    "data",                 1 },
+    { OSP_VOLUME,   "structuredSpherical",  "data",                 1 },
+    { OSP_VOLUME,   "unstructured",         "cell.type",            1 },
+    { OSP_VOLUME,   "unstructured",         "cell.index",           1 },
+    { OSP_VOLUME,   "amr",                  "block.bounds",         1 },
+    { OSP_VOLUME,   "particle",             "particle.position",    1 },
+    { OSP_VOLUME,   "vdb",                  "node.level",           1 },
+};
+
+class ObjectTracker
+{
+public:
+
+    ObjectTracker()
+    :
+        enabled(false)
+    {
+    }
+
+    bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Disabling drops all change tracking state, keeping only Data and
+    // FrameBuffer info
+    void
+    set_enabled(bool enable)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        enabled = enable;
+        if (enable)
+            return;
+
+        users.clear();
+        for (auto it = objects.begin(); it != objects.end(); )
+        {
+            if (it->second.data_type == OSP_UNKNOWN && it->second.fb_format == OSP_FB_NONE)
+                it = objects.erase(it);
+            else
+            {
+                TrackedObject& o = it->second;
+                o.params.clear();
+                o.elements.clear();
+                o.commits = 0;
+                o.commit_time = o.total_commit_time = 0.0;
+                ++it;
+            }
+        }
+    }
+
+    // Objects created with a reference (e.g. the geometry of a geometric
+    // model) pass it as the parameter it corresponds to
+    void
+    created(OSPObject handle, OSPDataType type, const char *subtype=nullptr,
+        const char *param=nullptr, OSPObject child=nullptr)
+    {
+        if (handle == nullptr || !is_enabled())
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        TrackedObject& o = reset(handle);
+        o.refs = 1;
+        o.type = type;
+        if (subtype != nullptr)
+            o.subtype = subtype;
+        if (child != nullptr)
+        {
+            o.params[param] = child;
+            users[child][handle]++;
+        }
+    }
+
+    // Data, with the handles of object arrays read from shared
+    void
+    created_data(OSPData handle, const void *shared, OSPDataType type, uint64_t n1, int64_t s1,
+        uint64_t n2, int64_t s2, uint64_t n3, int64_t s3)
+    {
+        if (handle == nullptr)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        TrackedObject& o = reset(handle);
+        o.refs = 1;
+        o.type = OSP_DATA;
+        o.dirty = false;
+        o.data_type = type;
+        o.num_items[0] = n1; o.num_items[1] = n2; o.num_items[2] = n3;
+
+        if (shared == nullptr || !osp_is_object_type(type) || !enabled)
+            return;
+
+        const int64_t b1 = s1 != 0 ? s1 : (int64_t)sizeof(OSPObject);
+        const int64_t b2 = s2 != 0 ? s2 : b1 * (int64_t)n1;
+        const int64_t b3 = s3 != 0 ? s3 : b2 * (int64_t)n2;
+        const char *base = static_cast<const char*>(shared);
+
+        for (uint64_t z = 0; z < n3; z++)
+            for (uint64_t y = 0; y < n2; y++)
+                for (uint64_t x = 0; x < n1; x++)
+                {
+                    OSPObject child = *reinterpret_cast<const OSPObject*>(base + x*b1 + y*b2 + z*b3);
+                    add_element(handle, o, child);
+                }
+    }
+
+    void
+    created_framebuffer(OSPFrameBuffer handle, int width, int height, OSPFrameBufferFormat format, uint32_t channels)
+    {
+        if (handle == nullptr)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        TrackedObject& o = reset(handle);
+        o.refs = 1;
+        o.type = OSP_FRAMEBUFFER;
+        o.num_items[0] = width; o.num_items[1] = height; o.num_items[2] = 1;
+        o.fb_format = format;
+        o.fb_channels = channels;
+    }
+
+    void
+    set_param(OSPObject handle, const char *name, OSPDataType type, const void *mem)
+    {
+        if (!is_enabled())
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        TrackedObject& o = objects[handle];
+        o.dirty = true;
+
+        remove_reference(handle, o, name);
+        if (osp_is_object_type(type))
+        {
+            OSPObject child = *static_cast<const OSPObject*>(mem);
+            if (child != nullptr)
+            {
+                o.params[name] = child;
+                users[child][handle]++;
+            }
+        }
+    }
+
+    void
+    remove_param(OSPObject handle, const char *name)
+    {
+        if (!is_enabled())
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        TrackedObject& o = objects[handle];
+        o.dirty = true;
+        remove_reference(handle, o, name);
+    }
+
+    // The destination changed, so all objects using it need a commit
+    void
+    copy_data(OSPData source, OSPData destination)
+    {
+        if (!is_enabled())
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        TrackedObject& dst = objects[destination];
+
+        auto it = objects.find(source);
+        if (it != objects.end())
+        {
+            const std::vector<OSPObject> elements = it->second.elements;
+            for (OSPObject child : elements)
+                add_element(destination, dst, child);
+        }
+
+        mark_users_dirty(destination);
+    }
+
+    void
+    retained(OSPObject handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        if (it != objects.end())
+            it->second.refs++;
+    }
+
+    void
+    released(OSPObject handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        if (it != objects.end() && --it->second.refs <= 0)
+            remove_unused(handle);
+    }
+
+    void
+    committed(OSPObject handle, double seconds)
+    {
+        if (!is_enabled())
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        TrackedObject& o = objects[handle];
+        o.dirty = false;
+        o.commits++;
+        o.commit_time = seconds;
+        o.total_commit_time += seconds;
+        mark_users_dirty(handle);
+    }
+
+    // Unknown objects are considered dirty
+    bool
+    is_dirty(OSPObject handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        return it == objects.end() || it->second.dirty;
+    }
+
+    // Copy of the state of an object, false if unknown
+    bool
+    get(OSPObject handle, TrackedObject& res)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        if (it == objects.end())
+            return false;
+        res = it->second;
+        return true;
+    }
+
+    // Number of primitives of a geometry, or cells of a volume, from the 
+    // size of its Data. 0 for other objects, or when unknown.
+    uint64_t
+    primitives(OSPObject handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return primitive_count(handle);
+    }
+
+    // Of all objects committed at least once, by descending total commit time
+    std::vector<CommitStatistics>
+    commit_statistics()
+    {
+        std::vector<CommitStatistics> res;
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (const auto& it : objects)
+        {
+            const TrackedObject& o = it.second;
+            if (o.commits == 0)
+                continue;
+            res.push_back(CommitStatistics { it.first, o.type, o.subtype, primitive_count(it.first),
+                o.commits, o.commit_time, o.total_commit_time });
+        }
+
+        std::sort(res.begin(), res.end(), [](const CommitStatistics& a, const CommitStatistics& b) {
+            return a.total_commit_time > b.total_commit_time;
+        });
+
+        return res;
+    }
+
+    void
+    reset_commit_statistics()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& it : objects)
+        {
+            it.second.commits = 0;
+            it.second.commit_time = it.second.total_commit_time = 0.0;
+        }
+    }
+
+    // Element type and dimensions of a Data object, false if unknown
+    bool
+    data_info(OSPData handle, OSPDataType& type, uint64_t num_items[3])
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        if (it == objects.end() || it->second.data_type == OSP_UNKNOWN)
+            return false;
+
+        type = it->second.data_type;
+        for (int d = 0; d < 3; d++)
+            num_items[d] = it->second.num_items[d];
+        return true;
+    }
+
+    // Size, format and channels of a FrameBuffer, false if unknown
+    bool
+    framebuffer_info(OSPFrameBuffer handle, int& width, int& height, OSPFrameBufferFormat& format, uint32_t& channels)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = objects.find(handle);
+        if (it == objects.end() || it->second.fb_format == OSP_FB_NONE)
+            return false;
+
+        width = (int)it->second.num_items[0];
+        height = (int)it->second.num_items[1];
+        format = it->second.fb_format;
+        channels = it->second.fb_channels;
+        return true;
+    }
+
+    // Objects referencing handle directly
+    std::vector<OSPObject>
+    get_users(OSPObject handle)
+    {
+        std::vector<OSPObject> res;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = users.find(handle);
+        if (it != users.end())
+        {
+            for (const auto& u : it->second)
+                res.push_back(u.first);
+        }
+        return res;
+    }
+
+    size_t
+    size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return objects.size();
+    }
+
+    // Objects referenced directly or indirectly by root, plus root itself,
+    // each once and ordered so that objects come after all objects they
+    // reference (assuming no cycles)
+    std::vector<OSPObject>
+    bottom_up(OSPObject root)
+    {
+        std::vector<OSPObject> res;
+        std::unordered_set<OSPObject> visited;
+        // Object plus whether its children were already pushed
+        std::vector<std::pair<OSPObject, bool>> stack;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stack.push_back(std::make_pair(root, false));
+
+        while (!stack.empty())
+        {
+            const OSPObject h = stack.back().first;
+            if (stack.back().second)
+            {
+                stack.pop_back();
+                res.push_back(h);
+                continue;
+            }
+
+            if (visited.count(h) > 0)
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            visited.insert(h);
+            stack.back().second = true;
+
+            auto it = objects.find(h);
+            if (it == objects.end())
+                continue;
+            for (const auto& p : it->second.params)
+            {
+                if (visited.count(p.second) == 0)
+                    stack.push_back(std::make_pair(p.second, false));
+            }
+            for (OSPObject child : it->second.elements)
+            {
+                if (visited.count(child) == 0)
+                    stack.push_back(std::make_pair(child, false));
+            }
+        }
+
+        return res;
+    }
+
+protected:
+
+    // Called with the mutex held
+    TrackedObject&
+    reset(OSPObject handle)
+    {
+        auto it = objects.find(handle);
+        if (it != objects.end())
+        {
+            // Stale references from and to the previous object with this handle
+            TrackedObject& o = it->second;
+            for (const auto& p : o.params)
+                unlink(p.second, handle);
+            for (OSPObject child : o.elements)
+                unlink(child, handle);
+
+            auto u = users.find(handle);
+            if (u != users.end())
+            {
+                for (const auto& user : u->second)
+                {
+                    auto uo = objects.find(user.first);
+                    if (uo == objects.end())
+                        continue;
+                    auto& params = uo->second.params;
+                    for (auto p = params.begin(); p != params.end(); )
+                        p = p->second == handle ? params.erase(p) : std::next(p);
+                    auto& elements = uo->second.elements;
+                    elements.erase(std::remove(elements.begin(), elements.end(), handle), elements.end());
+                }
+                users.erase(u);
+            }
+        }
+
+        TrackedObject& o = objects[handle];
+        o = TrackedObject();
+        return o;
+    }
+
+    // Remove the entry of handle if it has no references left, plus those 
+    // of the objects it referenced that become unused this way
+    void
+    remove_unused(OSPObject handle)
+    {
+        std::vector<OSPObject> check(1, handle);
+
+        while (!check.empty())
+        {
+            const OSPObject h = check.back();
+            check.pop_back();
+
+            auto it = objects.find(h);
+            if (it == objects.end() || it->second.refs > 0 || users.count(h) > 0)
+                continue;
+
+            for (const auto& p : it->second.params)
+            {
+                unlink(p.second, h);
+                check.push_back(p.second);
+            }
+            for (OSPObject child : it->second.elements)
+            {
+                unlink(child, h);
+                check.push_back(child);
+            }
+
+            objects.erase(it);
+        }
+    }
+
+    uint64_t
+    primitive_count(OSPObject handle)
+    {
+        auto it = objects.find(handle);
+        if (it == objects.end())
+            return 0;
+        const TrackedObject& o = it->second;
+
+        for (const PrimitiveParam& pp : PRIMITIVE_PARAMS)
+        {
+            if (pp.type != o.type || o.subtype != pp.subtype)
+                continue;
+            auto p = o.params.find(pp.param);
+            if (p == o.params.end())
+                continue;
+            auto d = objects.find(p->second);
+            if (d == objects.end() || d->second.data_type == OSP_UNKNOWN)
+                continue;
+            const uint64_t *n = d->second.num_items;
+            return n[0] * n[1] * n[2] / pp.items_per_primitive;
+        }
+
+        return 0;
+    }
+
+    void
+    add_element(OSPObject handle, TrackedObject& o, OSPObject child)
+    {
+        if (child == nullptr)
+            return;
+        o.elements.push_back(child);
+        users[child][handle]++;
+    }
+
+    void
+    remove_reference(OSPObject handle, TrackedObject& o, const char *name)
+    {
+        auto it = o.params.find(name);
+        if (it == o.params.end())
+            return;
+        unlink(it->second, handle);
+        o.params.erase(it);
+    }
+
+    void
+    unlink(OSPObject child, OSPObject user)
+    {
+        auto it = users.find(child);
+        if (it == users.end())
+            return;
+        auto u = it->second.find(user);
+        if (u != it->second.end() && --u->second == 0)
+            it->second.erase(u);
+        if (it->second.empty())
+            users.erase(it);
+    }
+
+    // Object arrays pass this on to their own users
+    void
+    mark_users_dirty(OSPObject handle)
+    {
+        auto it = users.find(handle);
+        if (it == users.end())
+            return;
+        for (const auto& u : it->second)
+        {
+            TrackedObject& o = objects[u.first];
+            if (o.data_type != OSP_UNKNOWN)
+                mark_users_dirty(u.first);
+            else
+                o.dirty = true;
+        }
+    }
+
+    std::atomic<bool>                                   enabled;
+    std::mutex                                          mutex;
+    std::unordered_map<OSPObject, TrackedObject>        objects;
+
+    // Per object the objects referencing it, with reference counts
+    std::unordered_map<OSPObject, std::unordered_map<OSPObject, int>>  users;
+};
+
+inline ObjectTracker&
+object_tracker()
+{
+    static ObjectTracker tracker;
+    return tracker;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef UNSTRUCTURED_H
+#define UNSTRUCTURED_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "parallel.h"
+#include "ingest.h"
+
+// Packing of VTK-style cell arrays into the arrays of an 'unstructured'
+// volume. The cell type values are the same for VTK and OSPRay.
+
+const uint8_t CELL_TETRAHEDRON = 10;
+const uint8_t CELL_HEXAHEDRON = 12;
+const uint8_t CELL_WEDGE = 13;
+const uint8_t CELL_PYRAMID = 14;
+
+// Number of vertices of a cell type, or -1 if not supported by OSPRay
+inline int
+cell_vertex_count(uint8_t type)
+{
+    switch (type)
+    {
+      case CELL_TETRAHEDRON : return 4;
+      case CELL_HEXAHEDRON  : return 8;
+      case CELL_WEDGE       : return 6;
+      case CELL_PYRAMID     : return 5;
+      default               : return -1;
+    }
+}
+
+// Convert n indices to type O, checking that each is in [0, bound)
+template<typename I, typename O>
+void
+pack_indices(const I *src, size_t n, uint64_t bound, O *dst, const char *name, unsigned nthreads=0)
+{
+    parallel_for(n, [=](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const I v = src[i];
+            if (v < 0 || (uint64_t)v >= bound)
+                throw std::invalid_argument(std::string(name) + " value " + std::to_string((long long)v) +
+                    " at position " + std::to_string(i) + " out of range");
+            dst[i] = (O)v;
+        }
+    }, nthreads, INGEST_MIN_PER_THREAD);
+}
+
+// Convert n cell types to uint8, checking that OSPRay supports each
+template<typename I>
+void
+pack_cell_types(const I *src, size_t n, uint8_t *dst, unsigned nthreads=0)
+{
+    parallel_for(n, [=](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const I v = src[i];
+            if (v < 0 || v > 255 || cell_vertex_count((uint8_t)v) < 0)
+                throw std::invalid_argument("unsupported cell type " + std::to_string((long long)v) +
+                    " for cell " + std::to_string(i) + " (only tetrahedra, hexahedra, wedges and pyramids)");
+            dst[i] = (uint8_t)v;
+        }
+    }, nthreads, INGEST_MIN_PER_THREAD);
+}
+
+// Check that each cell's offset range matches its type's vertex count.
+// The last cell ends at num_indices.
+template<typename O>
+void
+validate_cells(const uint8_t *types, const O *offsets, size_t ncells, size_t num_indices, unsigned nthreads=0)
+{
+    parallel_for(ncells, [=](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const uint64_t next = i+1 < ncells ? (uint64_t)offsets[i+1] : (uint64_t)num_indices;
+            if (next < (uint64_t)offsets[i] || next - offsets[i] != (uint64_t)cell_vertex_count(types[i]))
+                throw std::invalid_argument("cell " + std::to_string(i) + " has " +
+                    std::to_string((long long)(next - offsets[i])) + " vertices, expected " +
+                    std::to_string(cell_vertex_count(types[i])) + " for its cell type");
+        }
+    }, nthreads, INGEST_MIN_PER_THREAD);
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef VDB_H
+#define VDB_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "parallel.h"
+#include "ingest.h"
+
+// Conversion of a dense volume into the leaf nodes of a sparse 'vdb' volume.
+// Only leaf level nodes are produced, each covering a brick of 8^3 voxels.
+// Bricks with no visible values are dropped (and so read as background,
+// i.e. 0), bricks with a single value become tiles, all others are
+// stored as dense leaves.
+
+const int       VDB_LEAF_LEVEL = 3;
+const size_t    VDB_LEAF_RES = 8;
+const size_t    VDB_LEAF_VOXELS = VDB_LEAF_RES*VDB_LEAF_RES*VDB_LEAF_RES;
+
+// Same values as OSPVolumeFormat
+const uint32_t  VDB_FORMAT_TILE = 0;
+const uint32_t  VDB_FORMAT_DENSE_ZYX = 1;
+
+// Decides which bricks to keep, based on their value range
+struct BrickCulling
+{
+    enum Mode { NONE, VALUE, OPACITY };
+
+    Mode            mode;
+
+    // VALUE: keep bricks with a value > threshold
+    float           threshold;
+
+    // OPACITY: keep bricks with a value mapping to an opacity > threshold,
+    // given a transfer function opacity LUT over [lo, hi]
+    const float     *opacities;
+    size_t          num_opacities;
+    float           lo, hi;
+
+    BrickCulling(): mode(NONE), threshold(0.0f), opacities(nullptr), num_opacities(0), lo(0.0f), hi(1.0f) {}
+
+    bool
+    visible(float bmin, float bmax) const
+    {
+        if (mode == NONE)
+            return true;
+        else if (mode == VALUE)
+            return bmax > threshold;
+
+        // Maximum opacity of all LUT entries overlapping [bmin, bmax]
+        const float scale = hi > lo ? (num_opacities - 1) / (hi - lo) : 0.0f;
+        const float f0 = (bmin - lo) * scale;
+        const float f1 = (bmax - lo) * scale;
+        const size_t last = num_opacities - 1;
+        const size_t i0 = f0 <= 0.0f ? 0 : std::min((size_t)f0, last);
+        const size_t i1 = f1 <= 0.0f ? 0 : std::min((size_t)f1 + 1, last);
+
+        for (size_t i = i0; i <= i1; i++)
+        {
+            if (opacities[i] > threshold)
+                return true;
+        }
+
+        return false;
+    }
+};
+
+struct VDBLeaves
+{
+    // Per node
+    std::vector<uint32_t>   levels;
+    std::vector<int32_t>    origins;        // (x, y, z) triplets
+    std::vector<uint32_t>   formats;
+    std::vector<size_t>     offsets;        // Into values
+
+    // 1 value per tile, VDB_LEAF_VOXELS values per dense leaf (z fastest)
+    std::vector<float>      values;
+
+    size_t                  num_bricks;
+    size_t                  num_dense;
+    size_t                  num_tiles;
+
+    size_t size() const { return levels.size(); }
+};
+
+// Convert the dense volume src (x fastest) to vdb leaf nodes, in parallel.
+// Bricks are processed in two passes: classification from the brick
+// value range, then copying of the kept bricks. Bricks at the upper
+// boundaries that extend outside the volume get the nearest voxel
+// values (i.e. clamp to edge).
+template<typename T>
+void
+dense_to_vdb_leaves(const T *src, size_t nx, size_t ny, size_t nz, const BrickCulling& culling,
+    unsigned nthreads, VDBLeaves& res)
+{
+    const size_t R = VDB_LEAF_RES;
+    const size_t bx = (nx + R - 1) / R, by = (ny + R - 1) / R, bz = (nz + R - 1) / R;
+    const size_t nbricks = bx * by * bz;
+
+    // 0 = dropped, 1 = tile, 2 = dense
+    std::vector<uint8_t> kind(nbricks);
+    std::vector<float> tile_value(nbricks);
+
+    parallel_for(nbricks, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t b = begin; b < end; b++)
+        {
+            const size_t x0 = (b % bx) * R, y0 = ((b / bx) % by) * R, z0 = (b / (bx*by)) * R;
+            const size_t x1 = std::min(x0 + R, nx), y1 = std::min(y0 + R, ny), z1 = std::min(z0 + R, nz);
+            const float first = convert_value<float>(src[x0 + nx*(y0 + ny*z0)]);
+            float bmin = first, bmax = first;
+
+            for (size_t z = z0; z < z1; z++)
+            {
+                for (size_t y = y0; y < y1; y++)
+                {
+                    const T *row = src + nx*(y + ny*z);
+                    for (size_t x = x0; x < x1; x++)
+                    {
+                        const float v = convert_value<float>(row[x]);
+                        bmin = std::min(bmin, v);
+                        bmax = std::max(bmax, v);
+                    }
+                }
+            }
+
+            if (!culling.visible(bmin, bmax))
+                kind[b] = 0;
+            else if (bmin == bmax)
+                kind[b] = 1;
+            else
+                kind[b] = 2;
+
+            tile_value[b] = first;
+        }
+    }, nthreads, 64);
+
+    // Node order follows brick order, so the offsets are a prefix sum
+    res = VDBLeaves();
+    res.num_bricks = nbricks;
+
+    for (size_t b = 0; b < nbricks; b++)
+    {
+        if (kind[b] == 0)
+            continue;
+
+        res.levels.push_back(VDB_LEAF_LEVEL);
+        res.origins.push_back((int32_t)((b % bx) * R));
+        res.origins.push_back((int32_t)(((b / bx) % by) * R));
+        res.origins.push_back((int32_t)((b / (bx*by)) * R));
+        res.offsets.push_back(res.num_tiles + res.num_dense*VDB_LEAF_VOXELS);
+
+        if (kind[b] == 1)
+        {
+            res.formats.push_back(VDB_FORMAT_TILE);
+            res.num_tiles++;
+        }
+        else
+        {
+            res.formats.push_back(VDB_FORMAT_DENSE_ZYX);
+            res.num_dense++;
+        }
+    }
+
+    res.values.resize(res.num_tiles + res.num_dense*VDB_LEAF_VOXELS);
+
+    const size_t nnodes = res.size();
+    float *values = res.values.data();
+    const size_t *offsets = res.offsets.data();
+    const int32_t *origins = res.origins.data();
+    const uint32_t *formats = res.formats.data();
+
+    parallel_for(nnodes, [&](size_t begin, size_t end, unsigned /*chunk*/) {
+        for (size_t n = begin; n < end; n++)
+        {
+            const size_t x0 = origins[3*n+0], y0 = origins[3*n+1], z0 = origins[3*n+2];
+            float *out = values + offsets[n];
+
+            if (formats[n] == VDB_FORMAT_TILE)
+            {
+                const size_t b = x0/R + bx*(y0/R + by*(z0/R));
+                out[0] = tile_value[b];
+                continue;
+            }
+
+            // Dense leaf data has z varying fastest
+            for (size_t i = 0; i < R; i++)
+            {
+                const size_t x = std::min(x0 + i, nx - 1);
+                for (size_t j = 0; j < R; j++)
+                {
+                    const size_t y = std::min(y0 + j, ny - 1);
+                    for (size_t k = 0; k < R; k++)
+                    {
+                        const size_t z = std::min(z0 + k, nz - 1);
+                        *out++ = convert_value<float>(src[x + nx*(y + ny*z)]);
+                    }
+                }
+            }
+        }
+    }, nthreads, 16);
+}
+
+#endif
@@ -0,0 +1,609 @@
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "parallel.h"
+
+// Minimum number of voxels handled per thread, to avoid spinning up
+// threads for small arrays
+const size_t VOLUME_MIN_PER_THREAD = 1 << 16;
+
+// Statistics over all (non-NaN) values of a volume
+
+struct VolumeStatistics
+{
+    double                  min, max, mean;
+    uint64_t                count;          // Number of values used, i.e. excluding NaNs
+    uint64_t                nan_count;
+
+    double                  hist_min, hist_max;
+    std::vector<uint64_t>   histogram;
+
+    std::vector<double>     percentiles;    // Requested percentiles, in [0,100]
+    std::vector<double>     percentile_values;
+
+    VolumeStatistics():
+        min(0), max(0), mean(0), count(0), nan_count(0), hist_min(0), hist_max(0)
+    {}
+};
+
+template<typename T>
+inline bool
+is_nan_value(T v, std::true_type /*floating point*/)
+{
+    return std::isnan(v);
+}
+
+template<typename T>
+inline bool
+is_nan_value(T /*v*/, std::false_type)
+{
+    return false;
+}
+
+template<typename T>
+inline bool
+is_nan_value(T v)
+{
+    return is_nan_value(v, typename std::is_floating_point<T>::type());
+}
+
+// Histogram bin for value v, or -1 when v is outside of [lo, hi].
+// Same convention as numpy.histogram(), i.e. the last bin is closed.
+inline long
+histogram_bin(double v, double lo, double hi, double scale, long bins)
+{
+    if (v < lo || v > hi)
+        return -1;
+    if (v == hi)
+        return bins - 1;
+
+    long b = (long)((v - lo) * scale);
+
+    return b < bins ? b : bins - 1;
+}
+
+// Estimate percentiles from a histogram by interpolating linearly within
+// the bin that contains the requested rank
+inline void
+percentiles_from_histogram(VolumeStatistics& stats)
+{
+    const size_t bins = stats.histogram.size();
+    uint64_t total = 0;
+
+    for (size_t b = 0; b < bins; b++)
+        total += stats.histogram[b];
+
+    stats.percentile_values.resize(stats.percentiles.size());
+
+    const double bin_width = (stats.hist_max - stats.hist_min) / bins;
+
+    for (size_t i = 0; i < stats.percentiles.size(); i++)
+    {
+        if (total == 0)
+        {
+            stats.percentile_values[i] = std::numeric_limits<double>::quiet_NaN();
+            continue;
+        }
+
+        const double rank = stats.percentiles[i] / 100.0 * total;
+        uint64_t cum = 0;
+        size_t b = 0;
+
+        while (b < bins-1 && cum + stats.histogram[b] < rank)
+            cum += stats.histogram[b++];
+
+        const double f = stats.histogram[b] > 0 ? (rank - cum) / stats.histogram[b] : 0.0;
+
+        stats.percentile_values[i] = stats.hist_min + (b + std::min(std::max(f, 0.0), 1.0)) * bin_width;
+    }
+}
+
+// 8- and 16-bit integer values: a single pass counting all possible values,
+// from which everything else is derived exactly
+
+template<typename T>
+void
+compute_statistics_small_int(const T *data, size_t n, long bins, bool have_range, double lo, double hi,
+    unsigned nthreads, VolumeStatistics& stats)
+{
+    const size_t NV = (size_t)1 << (8*sizeof(T));
+    const int64_t imin = (int64_t)std::numeric_limits<T>::min();
+    const double vmin = (double)imin;
+
+    const unsigned chunks = num_chunks(n, nthreads, VOLUME_MIN_PER_THREAD);
+    std::vector<std::vector<uint64_t>> counts(chunks);
+
+    parallel_for(n, [&](size_t begin, size_t end, unsigned c) {
+        std::vector<uint64_t>& cnt = counts[c];
+        cnt.assign(NV, 0);
+        for (size_t i = begin; i < end; i++)
+            cnt[(size_t)((int64_t)data[i] - imin)]++;
+    }, nthreads, VOLUME_MIN_PER_THREAD);
+
+    std::vector<uint64_t> total(NV, 0);
+    for (unsigned c = 0; c < chunks; c++)
+        for (size_t v = 0; v < NV; v++)
+            total[v] += counts[c][v];
+
+    size_t first = NV, last = 0;
+    double sum = 0.0;
+    uint64_t count = 0;
+
+    for (size_t v = 0; v < NV; v++)
+    {
+        if (total[v] == 0)
+            continue;
+        if (first == NV)
+            first = v;
+        last = v;
+        sum += total[v] * (vmin + v);
+        count += total[v];
+    }
+
+    stats.count = count;
+    stats.nan_count = 0;
+    stats.min = count > 0 ? vmin + first : 0.0;
+    stats.max = count > 0 ? vmin + last : 0.0;
+    stats.mean = count > 0 ? sum / count : 0.0;
+
+    stats.hist_min = have_range ? lo : stats.min;
+    stats.hist_max = have_range ? hi : stats.max;
+    if (stats.hist_max == stats.hist_min)
+    {
+        stats.hist_min -= 0.5;
+        stats.hist_max += 0.5;
+    }
+
+    const double scale = bins / (stats.hist_max - stats.hist_min);
+    stats.histogram.assign(bins, 0);
+
+    for (size_t v = 0; v < NV; v++)
+    {
+        if (total[v] == 0)
+            continue;
+        const long b = histogram_bin(vmin + v, stats.hist_min, stats.hist_max, scale, bins);
+        if (b >= 0)
+            stats.histogram[b] += total[v];
+    }
+
+    // Exact percentiles, based on the value counts
+    stats.percentile_values.resize(stats.percentiles.size());
+    for (size_t i = 0; i < stats.percentiles.size(); i++)
+    {
+        if (count == 0)
+        {
+            stats.percentile_values[i] = std::numeric_limits<double>::quiet_NaN();
+            continue;
+        }
+
+        const double rank = stats.percentiles[i] / 100.0 * (count - 1);
+        uint64_t cum = 0;
+        size_t v = first;
+
+        while (v < last && cum + total[v] <= (uint64_t)rank)
+            cum += total[v++];
+
+        stats.percentile_values[i] = vmin + v;
+    }
+}
+
+// Other types: one pass for min/max/mean, plus a histogram pass when
+// no value range is given (as the bins can't be determined beforehand)
+
+template<typename T>
+void
+compute_statistics_generic(const T *data, size_t n, long bins, bool have_range, double lo, double hi,
+    unsigned nthreads, VolumeStatistics& stats)
+{
+    struct Partial
+    {
+        double      min, max, sum;
+        uint64_t    count, nan_count;
+        std::vector<uint64_t> histogram;
+    };
+
+    const unsigned chunks = num_chunks(n, nthreads, VOLUME_MIN_PER_THREAD);
+    std::vector<Partial> partials(chunks);
+
+    double scale = have_range && hi > lo ? bins / (hi - lo) : 0.0;
+
+    parallel_for(n, [&](size_t begin, size_t end, unsigned c) {
+        Partial& p = partials[c];
+        p.min = std::numeric_limits<double>::infinity();
+        p.max = -std::numeric_limits<double>::infinity();
+        p.sum = 0.0;
+        p.count = p.nan_count = 0;
+        if (have_range)
+            p.histogram.assign(bins, 0);
+
+        for (size_t i = begin; i < end; i++)
+        {
+            const T v = data[i];
+            if (is_nan_value(v))
+            {
+                p.nan_count++;
+                continue;
+            }
+            const double d = (double)v;
+            if (d < p.min) p.min = d;
+            if (d > p.max) p.max = d;
+            p.sum += d;
+            p.count++;
+            if (have_range)
+            {
+                const long b = histogram_bin(d, lo, hi, scale, bins);
+                if (b >= 0)
+                    p.histogram[b]++;
+            }
+        }
+    }, nthreads, VOLUME_MIN_PER_THREAD);
+
+    double vmin = std::numeric_limits<double>::infinity();
+    double vmax = -std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+    uint64_t count = 0, nan_count = 0;
+
+    for (unsigned c = 0; c < chunks; c++)
+    {
+        vmin = std::min(vmin, partials[c].min);
+        vmax = std::max(vmax, partials[c].max);
+        sum += partials[c].sum;
+        count += partials[c].count;
+        nan_count += partials[c].nan_count;
+    }
+
+    stats.count = count;
+    stats.nan_count = nan_count;
+    stats.min = count > 0 ? vmin : 0.0;
+    stats.max = count > 0 ? vmax : 0.0;
+    stats.mean = count > 0 ? sum / count : 0.0;
+
+    stats.hist_min = have_range ? lo : stats.min;
+    stats.hist_max = have_range ? hi : stats.max;
+    if (stats.hist_max == stats.hist_min)
+    {
+        stats.hist_min -= 0.5;
+        stats.hist_max += 0.5;
+    }
+
+    stats.histogram.assign(bins, 0);
+
+    if (have_range && hi > lo)
+    {
+        for (unsigned c = 0; c < chunks; c++)
+            for (long b = 0; b < bins; b++)
+                stats.histogram[b] += partials[c].histogram[b];
+    }
+    else
+    {
+        // Second pass, now that the range is known
+        const double hmin = stats.hist_min, hmax = stats.hist_max;
+        scale = bins / (hmax - hmin);
+
+        parallel_for(n, [&](size_t begin, size_t end, unsigned c) {
+            std::vector<uint64_t>& h = partials[c].histogram;
+            h.assign(bins, 0);
+            for (size_t i = begin; i < end; i++)
+            {
+                const T v = data[i];
+                if (is_nan_value(v))
+                    continue;
+                const long b = histogram_bin((double)v, hmin, hmax, scale, bins);
+                if (b >= 0)
+                    h[b]++;
+            }
+        }, nthreads, VOLUME_MIN_PER_THREAD);
+
+        for (unsigned c = 0; c < chunks; c++)
+            for (long b = 0; b < bins; b++)
+                stats.histogram[b] += partials[c].histogram[b];
+    }
+
+    percentiles_from_histogram(stats);
+}
+
+template<typename T>
+void
+compute_statistics_dispatch(const T *data, size_t n, long bins, bool have_range, double lo, double hi,
+    unsigned nthreads, VolumeStatistics& stats, std::true_type /*small int*/)
+{
+    compute_statistics_small_int(data, n, bins, have_range, lo, hi, nthreads, stats);
+}
+
+template<typename T>
+void
+compute_statistics_dispatch(const T *data, size_t n, long bins, bool have_range, double lo, double hi,
+    unsigned nthreads, VolumeStatistics& stats, std::false_type)
+{
+    compute_statistics_generic(data, n, bins, have_range, lo, hi, nthreads, stats);
+}
+
+// Compute statistics over n values. If have_range is false the histogram
+// covers [min, max] of the data. Percentiles are exact for 8/16-bit
+// integer data, and estimated from the histogram otherwise.
+template<typename T>
+void
+compute_statistics(const T *data, size_t n, long bins, bool have_range, double lo, double hi,
+    unsigned nthreads, VolumeStatistics& stats)
+{
+    if (bins < 1)
+        throw std::invalid_argument("number of histogram bins needs to be at least 1");
+    if (have_range && hi < lo)
+        throw std::invalid_argument("invalid histogram value range");
+
+    for (size_t i = 0; i < stats.percentiles.size(); i++)
+    {
+        if (stats.percentiles[i] < 0.0 || stats.percentiles[i] > 100.0)
+            throw std::invalid_argument("percentiles need to be in range [0, 100]");
+    }
+
+    compute_statistics_dispatch(data, n, bins, have_range, lo, hi, nthreads, stats,
+        std::integral_constant<bool, std::is_integral<T>::value && sizeof(T) <= 2>());
+}
+
+// Downsampling
+
+enum DownsampleMode
+{
+    DOWNSAMPLE_AVERAGE,
+    DOWNSAMPLE_MIN,
+    DOWNSAMPLE_MAX
+};
+
+inline DownsampleMode
+downsample_mode_from_string(const std::string& mode)
+{
+    if (mode == "average")
+        return DOWNSAMPLE_AVERAGE;
+    else if (mode == "min")
+        return DOWNSAMPLE_MIN;
+    else if (mode == "max")
+        return DOWNSAMPLE_MAX;
+
+    throw std::invalid_argument("unknown downsample mode '" + mode + "', should be one of average, min, max");
+}
+
+// Dimension after downsampling by a factor of 2, an odd last voxel ends
+// up in a smaller box of its own
+inline size_t
+downsampled_dimension(size_t n)
+{
+    return (n + 1) / 2;
+}
+
+template<typename T>
+inline T
+average_to(double sum, int count, std::true_type /*integral*/)
+{
+    return (T)std::floor(sum / count + 0.5);
+}
+
+template<typename T>
+inline T
+average_to(double sum, int count, std::false_type)
+{
+    return (T)(sum / count);
+}
+
+// Downsample a volume of nx*ny*nz voxels (x fastest, i.e. OSPRay's layout)
+// by a factor of 2 along each axis, reducing each 2x2x2 box of voxels to 
+// their average, minimum or maximum. Output slices are processed in parallel.
+template<typename T>
+void
+downsample_volume(const T *src, size_t nx, size_t ny, size_t nz, T *dst, DownsampleMode mode, unsigned nthreads)
+{
+    const size_t mx = downsampled_dimension(nx);
+    const size_t my = downsampled_dimension(ny);
+    const size_t mz = downsampled_dimension(nz);
+    const size_t sxy = nx*ny;
+
+    parallel_for(mz, [&](size_t zbegin, size_t zend, unsigned /*chunk*/) {
+        for (size_t z = zbegin; z < zend; z++)
+        {
+            const size_t z0 = 2*z, z1 = std::min(2*z+1, nz-1);
+
+            for (size_t y = 0; y < my; y++)
+            {
+                const size_t y0 = 2*y, y1 = std::min(2*y+1, ny-1);
+                T *out = dst + (z*my + y)*mx;
+
+                // The (up to) 4 input rows contributing to this output row
+                const T *used[4];
+                int nrows = 0;
+                for (size_t zz = z0; zz <= z1; zz++)
+                    for (size_t yy = y0; yy <= y1; yy++)
+                        used[nrows++] = src + zz*sxy + yy*nx;
+
+                for (size_t x = 0; x < mx; x++)
+                {
+                    const size_t x0 = 2*x, x1 = std::min(2*x+1, nx-1);
+
+                    if (mode == DOWNSAMPLE_AVERAGE)
+                    {
+                        double sum = 0.0;
+                        for (int r = 0; r < nrows; r++)
+                            sum += (double)used[r][x0] + (x1 > x0 ? (double)used[r][x1] : 0.0);
+                        out[x] = average_to<T>(sum, nrows * (x1 > x0 ? 2 : 1), typename std::is_integral<T>::type());
+                    }
+                    else if (mode == DOWNSAMPLE_MIN)
+                    {
+                        T v = used[0][x0];
+                        for (int r = 0; r < nrows; r++)
+                            v = std::min(v, std::min(used[r][x0], used[r][x1]));
+                        out[x] = v;
+                    }
+                    else
+                    {
+                        T v = used[0][x0];
+                        for (int r = 0; r < nrows; r++)
+                            v = std::max(v, std::max(used[r][x0], used[r][x1]));
+                        out[x] = v;
+                    }
+                }
+            }
+        }
+    }, nthreads, 1);
+}
+
+// Quick preview of downsampling levels times: every 2^levels-th voxel 
+// along each axis, giving the same dimensions as applying 
+// downsample_volume() levels times. Only reads the voxels taken.
+template<typename T>
+void
+subsample_volume(const T *src, size_t nx, size_t ny, size_t nz, int levels, T *dst)
+{
+    size_t mx = nx, my = ny, mz = nz;
+    for (int l = 0; l < levels; l++)
+    {
+        mx = downsampled_dimension(mx);
+        my = downsampled_dimension(my);
+        mz = downsampled_dimension(mz);
+    }
+
+    for (size_t z = 0; z < mz; z++)
+        for (size_t y = 0; y < my; y++)
+        {
+            const T *row = src + ((z << levels)*ny + (y << levels))*nx;
+            T *out = dst + (z*my + y)*mx;
+            for (size_t x = 0; x < mx; x++)
+                out[x] = row[x << levels];
+        }
+}
+
+// Quantization
+
+// Linear mapping of [lo, hi] onto the integer range [0, 2^bits-1], i.e.
+// q = round((v - lo) * scale) and v ~= q / scale + lo
+struct QuantizationInfo
+{
+    int     bits;
+    double  lo, hi;
+    double  scale;
+    double  max_error;      // Over all values, including clamped ones
+    double  rms_error;
+    uint64_t clamped;       // Number of values outside of [lo, hi]
+
+    QuantizationInfo(): bits(8), lo(0), hi(1), scale(1), max_error(0), rms_error(0), clamped(0) {}
+
+    double
+    quantize(double v) const
+    {
+        const double maxq = (double)((1u << bits) - 1);
+        const double q = std::floor((v - lo) * scale + 0.5);
+        return q < 0.0 ? 0.0 : (q > maxq ? maxq : q);
+    }
+
+    double
+    dequantize(double q) const
+    {
+        return q / scale + lo;
+    }
+};
+
+// Parallel min/max over n values, ignoring NaNs
+template<typename T>
+void
+compute_value_range(const T *data, size_t n, unsigned nthreads, double& lo, double& hi)
+{
+    const unsigned chunks = num_chunks(n, nthreads, VOLUME_MIN_PER_THREAD);
+    std::vector<double> mins(chunks, std::numeric_limits<double>::infinity());
+    std::vector<double> maxs(chunks, -std::numeric_limits<double>::infinity());
+
+    parallel_for(n, [&](size_t begin, size_t end, unsigned c) {
+        double vmin = mins[c], vmax = maxs[c];
+        for (size_t i = begin; i < end; i++)
+        {
+            if (is_nan_value(data[i]))
+                continue;
+            const double d = (double)data[i];
+            if (d < vmin) vmin = d;
+            if (d > vmax) vmax = d;
+        }
+        mins[c] = vmin;
+        maxs[c] = vmax;
+    }, nthreads, VOLUME_MIN_PER_THREAD);
+
+    lo = *std::min_element(mins.begin(), mins.end());
+    hi = *std::max_element(maxs.begin(), maxs.end());
+
+    if (lo > hi)
+        lo = hi = 0.0;
+}
+
+// Quantize n values to type Q (uint8_t or uint16_t), using info.lo/hi as
+// value range. NaNs are mapped to 0. The quantization error is computed
+// in the same pass and stored in info.
+template<typename T, typename Q>
+void
+quantize_values(const T *src, size_t n, Q *dst, unsigned nthreads, QuantizationInfo& info)
+{
+    if (info.hi < info.lo)
+        throw std::invalid_argument("invalid quantization value range");
+
+    info.bits = 8*sizeof(Q);
+    const double maxq = (double)((1u << info.bits) - 1);
+    info.scale = info.hi > info.lo ? maxq / (info.hi - info.lo) : 1.0;
+
+    struct Partial
+    {
+        double      max_error, sum_sq_error;
+        uint64_t    count, clamped;
+    };
+
+    const unsigned chunks = num_chunks(n, nthreads, VOLUME_MIN_PER_THREAD);
+    std::vector<Partial> partials(chunks);
+    const QuantizationInfo q = info;
+
+    parallel_for(n, [&](size_t begin, size_t end, unsigned c) {
+        Partial p = { 0.0, 0.0, 0, 0 };
+
+        for (size_t i = begin; i < end; i++)
+        {
+            if (is_nan_value(src[i]))
+            {
+                dst[i] = 0;
+                continue;
+            }
+
+            const double v = (double)src[i];
+            const double qv = q.quantize(v);
+            const double err = std::fabs(q.dequantize(qv) - v);
+
+            dst[i] = (Q)qv;
+            if (v < q.lo || v > q.hi)
+                p.clamped++;
+            if (err > p.max_error)
+                p.max_error = err;
+            p.sum_sq_error += err*err;
+            p.count++;
+        }
+
+        partials[c] = p;
+    }, nthreads, VOLUME_MIN_PER_THREAD);
+
+    double sum_sq = 0.0;
+    uint64_t count = 0;
+
+    info.max_error = 0.0;
+    info.clamped = 0;
+
+    for (unsigned c = 0; c < chunks; c++)
+    {
+        info.max_error = std::max(info.max_error, partials[c].max_error);
+        info.clamped += partials[c].clamped;
+        sum_sq += partials[c].sum_sq_error;
+        count += partials[c].count;
+    }
+
+    info.rms_error = count > 0 ? std::sqrt(sum_sq / count) : 0.0;
+}
+
+#endif